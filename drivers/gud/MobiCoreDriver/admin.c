@@ -31,6 +31,8 @@
 #include <linux/sched/signal.h>	/* signal_pending */
 #endif
 #include <linux/freezer.h>
+#include <linux/debugfs.h>
+#include <linux/sizes.h>
 
 #include "mc_user.h"
 #include "mc_admin.h"
@@ -49,8 +51,24 @@ static struct {
 	void (*tee_stop_cb)(void);
 	int last_tee_ret;
 	struct notifier_block tee_stop_notifier;
+	/* TA objects cache, most recently used first */
+	struct mutex objects_mutex;	/* Protects objects and objects_size */
+	struct list_head objects;
+	size_t objects_size;
+	u32 objects_max_size;		/* Set to 0 to disable the cache */
 } l_ctx;
 
+/* Default maximum total size of the TA objects cache */
+#define TEE_OBJECTS_CACHE_SIZE	SZ_4M
+
+/* TA object got from the daemon, kept for the next opens of the same TA */
+struct tee_object_entry {
+	struct list_head	list;
+	struct mc_uuid_t	uuid;
+	bool			is_gp;
+	struct tee_object	*obj;
+};
+
 static struct mc_admin_driver_request {
 	/* Global */
 	struct mutex mutex;		/* Protects access to this struct */
@@ -176,16 +194,120 @@ static struct tee_object *tee_object_alloc(bool is_sp_trustlet, size_t length)
 		return NULL;
 
 	/* A non-zero header_length indicates that we have a SP trustlet */
+	kref_init(&obj->kref);
 	obj->header_length = (u32)header_length;
 	obj->length = (u32)length;
 	return obj;
 }
 
-void tee_object_free(struct tee_object *obj)
+static void tee_object_release(struct kref *kref)
 {
+	struct tee_object *obj = container_of(kref, struct tee_object, kref);
+
 	vfree(obj);
 }
 
+void tee_object_free(struct tee_object *obj)
+{
+	kref_put(&obj->kref, tee_object_release);
+}
+
+static inline size_t tee_object_size(const struct tee_object *obj)
+{
+	return sizeof(*obj) + obj->header_length + obj->length;
+}
+
+static void tee_object_entry_free(struct tee_object_entry *entry)
+{
+	l_ctx.objects_size -= tee_object_size(entry->obj);
+	list_del(&entry->list);
+	tee_object_free(entry->obj);
+	kfree(entry);
+}
+
+/* Returns a new reference to the cached object, or NULL if not found */
+static struct tee_object *tee_object_cache_get(const struct mc_uuid_t *uuid,
+					       bool is_gp)
+{
+	struct tee_object_entry *entry;
+	struct tee_object *obj = NULL;
+
+	mutex_lock(&l_ctx.objects_mutex);
+	list_for_each_entry(entry, &l_ctx.objects, list) {
+		if (entry->is_gp == is_gp &&
+		    !memcmp(&entry->uuid, uuid, sizeof(*uuid))) {
+			/* Move to head of the LRU list */
+			list_move(&entry->list, &l_ctx.objects);
+			kref_get(&entry->obj->kref);
+			obj = entry->obj;
+			break;
+		}
+	}
+	mutex_unlock(&l_ctx.objects_mutex);
+	return obj;
+}
+
+/*
+ * Adds object to the cache, evicting the least recently used objects to
+ * make room. If another thread got the same object first, the cached one is
+ * returned instead of obj, which is freed.
+ */
+static struct tee_object *tee_object_cache_add(const struct mc_uuid_t *uuid,
+					       bool is_gp,
+					       struct tee_object *obj)
+{
+	size_t size = tee_object_size(obj);
+	struct tee_object_entry *entry;
+
+	mutex_lock(&l_ctx.objects_mutex);
+	if (size > l_ctx.objects_max_size)
+		goto end;
+
+	list_for_each_entry(entry, &l_ctx.objects, list) {
+		if (entry->is_gp == is_gp &&
+		    !memcmp(&entry->uuid, uuid, sizeof(*uuid))) {
+			list_move(&entry->list, &l_ctx.objects);
+			kref_get(&entry->obj->kref);
+			tee_object_free(obj);
+			obj = entry->obj;
+			goto end;
+		}
+	}
+
+	entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+	if (!entry)
+		goto end;
+
+	while (!list_empty(&l_ctx.objects) &&
+	       (l_ctx.objects_size + size > l_ctx.objects_max_size))
+		tee_object_entry_free(list_last_entry(&l_ctx.objects,
+						      struct tee_object_entry,
+						      list));
+
+	memcpy(&entry->uuid, uuid, sizeof(*uuid));
+	entry->is_gp = is_gp;
+	kref_get(&obj->kref);
+	entry->obj = obj;
+	list_add(&entry->list, &l_ctx.objects);
+	l_ctx.objects_size += size;
+	mc_dev_devel("cached object of size %zu, total %zu", size,
+		     l_ctx.objects_size);
+end:
+	mutex_unlock(&l_ctx.objects_mutex);
+	return obj;
+}
+
+/* Objects may be in use: they are only freed when their last user is done */
+static void tee_object_cache_flush(void)
+{
+	struct tee_object_entry *entry, *next;
+
+	mutex_lock(&l_ctx.objects_mutex);
+	list_for_each_entry_safe(entry, next, &l_ctx.objects, list)
+		tee_object_entry_free(entry);
+	mutex_unlock(&l_ctx.objects_mutex);
+}
+
 static inline void client_state_change(enum client_state state)
 {
 	mutex_lock(&g_request.states_mutex);
@@ -561,6 +683,7 @@ static int tee_stop_notifier_fn(struct notifier_block *nb, unsigned long event,
 {
 	mc_admin_sendcrashdump();
 	l_ctx.last_tee_ret = -EHOSTUNREACH;
+	tee_object_cache_flush();
 	return 0;
 }
 
@@ -698,6 +821,17 @@ struct tee_object *tee_object_get(const struct mc_uuid_t *uuid, bool is_gp)
 	struct tee_object *obj;
 	u32 spid = 0;
 
+	/* Objects are read-only once made, so they can be shared */
+	obj = tee_object_cache_get(uuid, is_gp);
+	if (obj) {
+		mc_dev_devel("object found in cache");
+		return obj;
+	}
+
+#ifdef MC_SWD_SIMULATOR
+	/* The simulated TAs are built into the SWd, no daemon to ask */
+	return ERR_PTR(-ENOENT);
+#endif
 	/* admin_get_trustlet creates the right object based on service type */
 	obj = admin_get_trustlet(uuid, is_gp, &spid);
 	if (IS_ERR(obj))
@@ -720,7 +854,7 @@ struct tee_object *tee_object_get(const struct mc_uuid_t *uuid, bool is_gp)
 		}
 	}
 
-	return obj;
+	return tee_object_cache_add(uuid, is_gp, obj);
 }
 
 static inline int load_driver(struct tee_client *client,
@@ -743,6 +877,9 @@ static inline int load_driver(struct tee_client *client,
 	else
 		info.type = TEE_MC_DRIVER_UUID;
 
+	/* Registry may have changed along with the driver */
+	tee_object_cache_flush();
+
 	/* Create DCI in case it's needed */
 	ret = client_cbuf_create(client, info.tci_len, &info.tci_va, NULL);
 	if (ret)
@@ -1094,6 +1231,8 @@ static int admin_release(struct inode *inode, struct file *file)
 	mutex_unlock(&g_request.states_mutex);
 	mc_dev_info("daemon connection closed, TGID %d", l_ctx.admin_tgid);
 	l_ctx.admin_tgid = 0;
+	/* A new daemon may serve a different registry */
+	tee_object_cache_flush();
 
 	/*
 	 * ret is quite irrelevant here as most apps don't care about the
@@ -1161,6 +1300,12 @@ int mc_admin_init(struct cdev *cdev, int (*tee_start_cb)(void),
 		  void (*tee_stop_cb)(void))
 {
 	mutex_init(&l_ctx.admin_tgid_mutex);
+	/* TA objects cache */
+	mutex_init(&l_ctx.objects_mutex);
+	INIT_LIST_HEAD(&l_ctx.objects);
+	l_ctx.objects_max_size = TEE_OBJECTS_CACHE_SIZE;
+	debugfs_create_u32("objects_cache_max_size", 0600, g_ctx.debug_dir,
+			   &l_ctx.objects_max_size);
 	/* Requests from driver to daemon */
 	mutex_init(&g_request.mutex);
 	mutex_init(&g_request.states_mutex);
@@ -1183,4 +1328,6 @@ void mc_admin_exit(void)
 	nq_unregister_tee_stop_notifier(&l_ctx.tee_stop_notifier);
 	if (!l_ctx.last_tee_ret)
 		l_ctx.tee_stop_cb();
+
+	tee_object_cache_flush();
 }
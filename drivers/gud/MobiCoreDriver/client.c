@@ -20,11 +20,20 @@
 #include <linux/sched.h>	/* struct task_struct */
 #include <linux/version.h>
 #if KERNEL_VERSION(4, 11, 0) <= LINUX_VERSION_CODE
-#include <linux/sched/mm.h>	/* get_task_mm */
+#include <linux/sched/mm.h>	/* mmget */
 #include <linux/sched/task.h>	/* put_task_struct */
 #endif
 #include <net/sock.h>		/* sockfd_lookup */
 #include <linux/file.h>		/* fput */
+#include <linux/mmu_notifier.h>
+#include <linux/workqueue.h>
+#include <linux/wait.h>
+#include <linux/poll.h>
+#if KERNEL_VERSION(5, 8, 0) <= LINUX_VERSION_CODE
+#include <linux/kthread.h>	/* kthread_use_mm */
+#else
+#include <linux/mmu_context.h>	/* use_mm */
+#endif
 
 #include "mc_user.h"
 #include "mc_admin.h"
@@ -34,8 +43,34 @@
 #include "session.h"
 #include "client.h"
 
+/*
+ * Keep the MMUs of the temporary buffers of user clients, so that the same
+ * buffers mapped for each command are only pinned once. The interval notifier
+ * sequence tells whether the mapping changed since the MMU was created, and
+ * MMUs whose mapping changed are released without waiting for a re-use.
+ */
+#if defined(CONFIG_MMU_NOTIFIER) && \
+	KERNEL_VERSION(5, 10, 0) <= LINUX_VERSION_CODE
+#define MC_PERSISTENT_MMUS
+#endif
+
+/* Maximum number of temporary buffers MMUs kept per client */
+#define CMMUS_MAX			8
+
+/* Maximum number of asynchronous GP invocations not reaped per client */
+#define ASYNCS_MAX			MC_GP_ASYNC_BATCH_MAX
+
+/* Maximum number of asynchronous GP invocations running, for all clients */
+#define ASYNCS_ACTIVE_MAX		8
+
+/* On close, cancellation of running invocations is retried this often */
+#define ASYNCS_CANCEL_PERIOD_MS		1000
+#define ASYNCS_CANCEL_TRIES		5
+
 /* Client/context */
 struct tee_client {
+	/* Unique for the driver's lifetime, never reused */
+	u64			id;
 	/* PID of task that opened the device, 0 if kernel */
 	pid_t			pid;
 	/* Command for task*/
@@ -57,6 +92,22 @@ struct tee_client {
 	struct list_head	cwsms;
 	/* List of GP operation for a client */
 	struct list_head	operations;
+	/* MMUs kept for re-use, most recently used first */
+	struct list_head	cmmus;
+	struct mutex		cmmus_lock;	/* lock for the cmmus list */
+	int			nr_cmmus;
+	/* Releases the MMUs whose mapping changed */
+	struct work_struct	cmmus_work;
+	/* Asynchronous GP invocations, running and completed */
+	struct list_head	asyncs_running;
+	struct list_head	asyncs_done;
+	spinlock_t		asyncs_lock;	/* lock for the asyncs lists */
+	wait_queue_head_t	asyncs_wq;
+	int			nr_asyncs;
+	/* Set on close: pending invocations are dropped, not run */
+	bool			asyncs_cancelled;
+	/* Set if close gave up waiting: workers free their invocation */
+	bool			asyncs_abandoned;
 	/* The list entry to attach to "ctx.clients" list */
 	struct list_head	list;
 	/* task_struct for the client application, if going through a proxy */
@@ -71,6 +122,10 @@ static struct client_ctx {
 	/* Clients waiting for their last cbuf to be released */
 	struct mutex		closing_clients_lock;
 	struct list_head	closing_clients;
+	/* Runs asynchronous GP invocations, a few at a time */
+	struct workqueue_struct	*async_wq;
+	/* Last client ID given */
+	atomic64_t		last_id;
 } client_ctx;
 
 /* Buffer shared with SWd at client level */
@@ -115,6 +170,73 @@ struct cbuf {
 	bool			api_freed;
 };
 
+#ifdef MC_PERSISTENT_MMUS
+/* Persistent MMU of a temporary buffer, re-used until the mapping changes */
+struct cmmu {
+	/* Invalidated when the buffer's mapping changes */
+	struct mmu_interval_notifier	notifier;
+	/* Notifier sequence when the MMU was created */
+	unsigned long			seq;
+	/* Buffer info */
+	uintptr_t			va;
+	u32				len;
+	u32				flags;
+	/* MMU table */
+	struct tee_mmu			*mmu;
+	/* Client this MMU belongs to */
+	struct tee_client		*client;
+	/* The list entry for the client to list its MMUs */
+	struct list_head		list;
+};
+#endif
+
+/* GP invocation submitted asynchronously by a user client */
+struct client_gp_async {
+	/* Client this invocation belongs to */
+	struct tee_client			*client;
+	/* Address space of the submitter, to map temporary buffers */
+	struct mm_struct			*mm;
+	/* Invocation, completed with the results */
+	struct mc_ioctl_gp_async_command	command;
+	/* Worker running the invocation */
+	struct work_struct			work;
+	/* The list entry for the client to list its invocations */
+	struct list_head			list;
+};
+
+static void client_gp_async_worker(struct work_struct *work);
+
+/*
+ * Like get_task_mm(current), but also for the workers running asynchronous
+ * invocations, which borrow the submitter's mm. Other kernel threads get none,
+ * even while they use an mm.
+ */
+static inline struct mm_struct *client_current_mm(void)
+{
+	struct mm_struct *mm = current->mm;
+
+	if (!mm)
+		return NULL;
+
+	if (current->flags & PF_KTHREAD) {
+#if KERNEL_VERSION(4, 17, 0) <= LINUX_VERSION_CODE
+		struct work_struct *work = current_work();
+
+		if (!work || work->func != client_gp_async_worker)
+			return NULL;
+#else
+		return NULL;
+#endif
+	}
+
+#if KERNEL_VERSION(4, 11, 0) <= LINUX_VERSION_CODE
+	mmget(mm);
+#else
+	atomic_inc(&mm->mm_users);
+#endif
+	return mm;
+}
+
 static inline void cbuf_get(struct cbuf *cbuf)
 {
 	kref_get(&cbuf->kref);
@@ -220,7 +342,7 @@ static struct cwsm *cwsm_create(struct tee_client *client,
 		if (client_is_kernel(client)) {
 			cwsm->mmu = tee_mmu_create(NULL, &buf);
 		} else {
-			struct mm_struct *mm = get_task_mm(current);
+			struct mm_struct *mm = client_current_mm();
 
 			if (!mm) {
 				ret = -EPERM;
@@ -395,6 +517,7 @@ struct tee_client *client_create(bool is_from_kernel)
 	/* Increment debug counter */
 	atomic_inc(&g_ctx.c_clients);
 	/* initialize members */
+	client->id = atomic64_inc_return(&client_ctx.last_id);
 	client->pid = is_from_kernel ? 0 : current->pid;
 	memcpy(client->comm, current->comm, sizeof(client->comm));
 	kref_init(&client->kref);
@@ -408,6 +531,13 @@ struct tee_client *client_create(bool is_from_kernel)
 	mutex_init(&client->cwsm_release_lock);
 	INIT_LIST_HEAD(&client->cwsms);
 	INIT_LIST_HEAD(&client->operations);
+	INIT_LIST_HEAD(&client->cmmus);
+	mutex_init(&client->cmmus_lock);
+	client_init_cmmus(client);
+	INIT_LIST_HEAD(&client->asyncs_running);
+	INIT_LIST_HEAD(&client->asyncs_done);
+	spin_lock_init(&client->asyncs_lock);
+	init_waitqueue_head(&client->asyncs_wq);
 	/* Add client to list of clients */
 	mutex_lock(&client_ctx.clients_lock);
 	list_add_tail(&client->list, &client_ctx.clients);
@@ -460,6 +590,11 @@ bool client_has_sessions(struct tee_client *client)
 	return ret;
 }
 
+u64 client_id(struct tee_client *client)
+{
+	return client->id;
+}
+
 static inline void client_put_session(struct tee_client *client,
 				      struct tee_session *session)
 {
@@ -539,6 +674,189 @@ static void client_release_cwsms(struct tee_client *client)
 	}
 }
 
+#ifdef MC_PERSISTENT_MMUS
+/*
+ * The notifier cannot be removed from its own callback, which may also not be
+ * allowed to sleep: the MMU is released from a work, so that its pages do not
+ * stay pinned after the buffer is unmapped.
+ */
+static bool cmmu_invalidate(struct mmu_interval_notifier *notifier,
+			    const struct mmu_notifier_range *range,
+			    unsigned long cur_seq)
+{
+	struct cmmu *cmmu = container_of(notifier, struct cmmu, notifier);
+
+	mmu_interval_set_seq(notifier, cur_seq);
+	schedule_work(&cmmu->client->cmmus_work);
+	return true;
+}
+
+static const struct mmu_interval_notifier_ops cmmu_notifier_ops = {
+	.invalidate = cmmu_invalidate,
+};
+
+/* Must be called with cmmus_lock held */
+static void cmmu_free(struct tee_client *client, struct cmmu *cmmu)
+{
+	list_del(&cmmu->list);
+	client->nr_cmmus--;
+	mmu_interval_notifier_remove(&cmmu->notifier);
+	tee_mmu_put(cmmu->mmu);
+	kfree(cmmu);
+}
+
+/* Returns a new reference to the MMU if buffer is unchanged, or NULL */
+static struct tee_mmu *cmmu_find(struct tee_client *client,
+				 struct mm_struct *mm,
+				 const struct mc_ioctl_buffer *buf)
+{
+	struct cmmu *cmmu, *next;
+	struct tee_mmu *mmu = NULL;
+
+	mutex_lock(&client->cmmus_lock);
+	list_for_each_entry_safe(cmmu, next, &client->cmmus, list) {
+		if (cmmu->notifier.mm != mm || cmmu->va != buf->va ||
+		    cmmu->len != buf->len || cmmu->flags != buf->flags)
+			continue;
+
+		if (mmu_interval_check_retry(&cmmu->notifier, cmmu->seq)) {
+			mc_dev_devel("buffer %llx changed, re-map", buf->va);
+			cmmu_free(client, cmmu);
+			break;
+		}
+
+		list_move(&cmmu->list, &client->cmmus);
+		mmu = cmmu->mmu;
+		tee_mmu_get(mmu);
+		break;
+	}
+	mutex_unlock(&client->cmmus_lock);
+	return mmu;
+}
+
+/*
+ * Must be called before the pages are pinned: any change of the mapping from
+ * here on, including while pinning, makes the first re-use fail.
+ */
+static struct cmmu *cmmu_prepare(struct tee_client *client,
+				 struct mm_struct *mm,
+				 const struct mc_ioctl_buffer *buf)
+{
+	struct cmmu *cmmu;
+	uintptr_t start = buf->va & PAGE_MASK;
+
+	cmmu = kzalloc(sizeof(*cmmu), GFP_KERNEL);
+	if (!cmmu)
+		return NULL;
+
+	cmmu->client = client;
+
+	if (mmu_interval_notifier_insert(&cmmu->notifier, mm, start,
+					 PAGE_ALIGN(buf->va + buf->len) - start,
+					 &cmmu_notifier_ops)) {
+		kfree(cmmu);
+		return NULL;
+	}
+
+	cmmu->seq = mmu_interval_read_begin(&cmmu->notifier);
+	cmmu->va = buf->va;
+	cmmu->len = buf->len;
+	cmmu->flags = buf->flags;
+	return cmmu;
+}
+
+static void cmmu_cancel(struct cmmu *cmmu)
+{
+	mmu_interval_notifier_remove(&cmmu->notifier);
+	kfree(cmmu);
+}
+
+static void cmmu_add(struct tee_client *client, struct cmmu *cmmu,
+		     struct tee_mmu *mmu)
+{
+	/* Changed while pinning: not worth keeping */
+	if (mmu_interval_check_retry(&cmmu->notifier, cmmu->seq)) {
+		cmmu_cancel(cmmu);
+		return;
+	}
+
+	cmmu->mmu = mmu;
+	tee_mmu_get(mmu);
+	mutex_lock(&client->cmmus_lock);
+	if (client->nr_cmmus == CMMUS_MAX)
+		cmmu_free(client, list_last_entry(&client->cmmus, struct cmmu,
+						  list));
+
+	list_add(&cmmu->list, &client->cmmus);
+	client->nr_cmmus++;
+	mutex_unlock(&client->cmmus_lock);
+}
+
+/* Release the MMUs whose buffer was unmapped or changed since */
+static void client_cmmus_worker(struct work_struct *work)
+{
+	struct tee_client *client =
+		container_of(work, struct tee_client, cmmus_work);
+	struct cmmu *cmmu, *next;
+
+	mutex_lock(&client->cmmus_lock);
+	list_for_each_entry_safe(cmmu, next, &client->cmmus, list)
+		if (mmu_interval_check_retry(&cmmu->notifier, cmmu->seq))
+			cmmu_free(client, cmmu);
+	mutex_unlock(&client->cmmus_lock);
+}
+
+static void client_init_cmmus(struct tee_client *client)
+{
+	INIT_WORK(&client->cmmus_work, client_cmmus_worker);
+}
+
+/* Client is closing: release the MMUs kept for re-use */
+static void client_release_cmmus(struct tee_client *client)
+{
+	mutex_lock(&client->cmmus_lock);
+	while (!list_empty(&client->cmmus))
+		cmmu_free(client, list_first_entry(&client->cmmus, struct cmmu,
+						   list));
+	mutex_unlock(&client->cmmus_lock);
+	/* No notifier left to schedule it again */
+	cancel_work_sync(&client->cmmus_work);
+}
+#else
+struct cmmu;
+
+static inline struct tee_mmu *cmmu_find(struct tee_client *client,
+					struct mm_struct *mm,
+					const struct mc_ioctl_buffer *buf)
+{
+	return NULL;
+}
+
+static inline struct cmmu *cmmu_prepare(struct tee_client *client,
+					struct mm_struct *mm,
+					const struct mc_ioctl_buffer *buf)
+{
+	return NULL;
+}
+
+static inline void cmmu_cancel(struct cmmu *cmmu)
+{
+}
+
+static inline void cmmu_add(struct tee_client *client, struct cmmu *cmmu,
+			    struct tee_mmu *mmu)
+{
+}
+
+static inline void client_init_cmmus(struct tee_client *client)
+{
+}
+
+static inline void client_release_cmmus(struct tee_client *client)
+{
+}
+#endif
+
 /* Client is closing: make sure all cancelled operations are gone */
 static void client_release_gp_operations(struct tee_client *client)
 {
@@ -555,6 +873,81 @@ static void client_release_gp_operations(struct tee_client *client)
 	mutex_unlock(&client->quick_lock);
 }
 
+static inline bool client_gp_asyncs_idle(struct tee_client *client)
+{
+	bool ret;
+
+	spin_lock(&client->asyncs_lock);
+	ret = list_empty(&client->asyncs_running);
+	spin_unlock(&client->asyncs_lock);
+	return ret;
+}
+
+/* Must be called with asyncs_lock held */
+static int client_gp_asyncs_started(struct tee_client *client, u32 *started)
+{
+	struct client_gp_async *async;
+	int nr_started = 0;
+
+	list_for_each_entry(async, &client->asyncs_running, list)
+		started[nr_started++] = async->command.command.operation.started;
+
+	return nr_started;
+}
+
+/*
+ * Drop the pending asynchronous GP invocations, cancel the running ones and
+ * wait for them, then drop the completions never reaped. A TA may not return
+ * on cancellation: after a while, the invocations still running are left to
+ * finish on their own and their workers free them.
+ */
+static void client_release_asyncs(struct tee_client *client)
+{
+	struct client_gp_async *async;
+	u32 started[ASYNCS_MAX];
+	int i, nr_started, tries = 0;
+
+	spin_lock(&client->asyncs_lock);
+	client->asyncs_cancelled = true;
+	spin_unlock(&client->asyncs_lock);
+
+	/*
+	 * An invocation may be about to register its operation, or share its
+	 * started value with another one: cancellation is requested again
+	 * until all are gone.
+	 */
+	do {
+		spin_lock(&client->asyncs_lock);
+		nr_started = client_gp_asyncs_started(client, started);
+		spin_unlock(&client->asyncs_lock);
+		if (!nr_started)
+			break;
+
+		for (i = 0; i < nr_started; i++)
+			client_gp_request_cancellation(client, started[i]);
+	} while (++tries < ASYNCS_CANCEL_TRIES &&
+		 !wait_event_timeout(client->asyncs_wq,
+				     client_gp_asyncs_idle(client),
+				     msecs_to_jiffies(ASYNCS_CANCEL_PERIOD_MS)));
+
+	spin_lock(&client->asyncs_lock);
+	if (!list_empty(&client->asyncs_running)) {
+		mc_dev_err(-ETIME, "client %p: asynchronous invocations stuck",
+			   client);
+		client->asyncs_abandoned = true;
+	}
+
+	while (!list_empty(&client->asyncs_done)) {
+		async = list_first_entry(&client->asyncs_done,
+					 struct client_gp_async, list);
+		list_del(&async->list);
+		kfree(async);
+	}
+
+	client->nr_asyncs = 0;
+	spin_unlock(&client->asyncs_lock);
+}
+
 /*
  * Release a client and the session+cbuf objects it contains.
  * @param client_t client
@@ -569,10 +962,15 @@ void client_close(struct tee_client *client)
 	mutex_unlock(&client_ctx.closing_clients_lock);
 	mutex_unlock(&client_ctx.clients_lock);
 	client_close_kernel_cbufs(client);
+	/* Finish asynchronous invocations, they keep references to sessions */
+	client_release_asyncs(client);
 	/* Close all remaining sessions */
 	client_close_sessions(client);
+	/* And those parked for the client to reuse */
+	iwp_pool_close_owner(client->id);
 	/* Release all cwsms, no need to lock as sessions are closed */
 	client_release_cwsms(client);
+	client_release_cmmus(client);
 	client_release_gp_operations(client);
 	client_put(client);
 	mc_dev_devel("client %p closed", client);
@@ -1099,6 +1497,166 @@ void client_gp_request_cancellation(struct tee_client *client, u64 started)
 		session_gp_request_cancellation(slot);
 }
 
+static void client_gp_async_worker(struct work_struct *work)
+{
+	struct client_gp_async *async =
+		container_of(work, struct client_gp_async, work);
+	struct tee_client *client = async->client;
+	struct mc_ioctl_gp_invoke_command *command = &async->command.command;
+	bool abandoned;
+
+	if (READ_ONCE(client->asyncs_cancelled)) {
+		/* Client is closing, do not even start */
+		async->command.result = iwp_set_ret(-ECANCELED, &command->ret);
+		goto done;
+	}
+
+	/* Temporary buffers are mapped from the submitter's address space */
+#if KERNEL_VERSION(5, 8, 0) <= LINUX_VERSION_CODE
+	kthread_use_mm(async->mm);
+#else
+	use_mm(async->mm);
+#endif
+	async->command.result = client_gp_invoke_command(client,
+							 command->session_id,
+							 command->command_id,
+							 &command->operation,
+							 &command->ret);
+#if KERNEL_VERSION(5, 8, 0) <= LINUX_VERSION_CODE
+	kthread_unuse_mm(async->mm);
+#else
+	unuse_mm(async->mm);
+#endif
+done:
+	mmput(async->mm);
+
+	spin_lock(&client->asyncs_lock);
+	abandoned = client->asyncs_abandoned;
+	if (abandoned)
+		list_del(&async->list);
+	else
+		list_move_tail(&async->list, &client->asyncs_done);
+	spin_unlock(&client->asyncs_lock);
+	if (abandoned)
+		kfree(async);
+	else
+		wake_up_all(&client->asyncs_wq);
+
+	client_put(client);
+}
+
+/*
+ * Queue GP invocations to be run in the background, possibly in parallel when
+ * targeting different sessions. Returns the number of invocations queued,
+ * which is less than nr_commands if too many are pending.
+ */
+int client_gp_invoke_submit(struct tee_client *client,
+			    const struct mc_ioctl_gp_async_command *commands,
+			    u32 nr_commands)
+{
+	struct client_gp_async *async;
+	u32 i;
+
+	if (!current->mm)
+		return -EPERM;
+
+	for (i = 0; i < nr_commands; i++) {
+		async = kzalloc(sizeof(*async), GFP_KERNEL);
+		if (!async)
+			break;
+
+		async->command = commands[i];
+		INIT_WORK(&async->work, client_gp_async_worker);
+		spin_lock(&client->asyncs_lock);
+		if (client->nr_asyncs >= ASYNCS_MAX) {
+			spin_unlock(&client->asyncs_lock);
+			kfree(async);
+			break;
+		}
+
+		client->nr_asyncs++;
+		list_add_tail(&async->list, &client->asyncs_running);
+		spin_unlock(&client->asyncs_lock);
+
+		async->client = client;
+		client_get(client);
+		async->mm = client_current_mm();
+		queue_work(client_ctx.async_wq, &async->work);
+	}
+
+	if (!i && nr_commands)
+		return -EAGAIN;
+
+	mc_dev_devel("client %p, queued %u/%u invocations", client, i,
+		     nr_commands);
+	return i;
+}
+
+static inline bool client_gp_has_completions(struct tee_client *client)
+{
+	bool ret;
+
+	spin_lock(&client->asyncs_lock);
+	ret = !list_empty(&client->asyncs_done);
+	spin_unlock(&client->asyncs_lock);
+	return ret;
+}
+
+/*
+ * Get completed asynchronous GP invocations, waiting for at least one for
+ * timeout ms (-1 for ever, 0 to not wait). Returns the number of completions.
+ */
+int client_gp_invoke_reap(struct tee_client *client,
+			  struct mc_ioctl_gp_async_command *completions,
+			  u32 nr_completions, s32 timeout)
+{
+	struct client_gp_async *async;
+	int ret;
+	u32 i = 0;
+
+	if (!nr_completions)
+		return 0;
+
+	if (timeout < 0) {
+		ret = wait_event_interruptible(client->asyncs_wq,
+					       client_gp_has_completions(client));
+		if (ret)
+			return ret;
+	} else if (timeout > 0) {
+		ret = wait_event_interruptible_timeout(client->asyncs_wq,
+					       client_gp_has_completions(client),
+					       msecs_to_jiffies(timeout));
+		if (ret < 0)
+			return ret;
+	}
+
+	spin_lock(&client->asyncs_lock);
+	while (i < nr_completions && !list_empty(&client->asyncs_done)) {
+		async = list_first_entry(&client->asyncs_done,
+					 struct client_gp_async, list);
+		list_del(&async->list);
+		client->nr_asyncs--;
+		completions[i++] = async->command;
+		kfree(async);
+	}
+	spin_unlock(&client->asyncs_lock);
+
+	if (!i)
+		return timeout > 0 ? -ETIME : -EAGAIN;
+
+	return i;
+}
+
+/*
+ * Poll for completed asynchronous GP invocations
+ */
+bool client_gp_invoke_poll(struct tee_client *client, struct file *file,
+			   poll_table *wait)
+{
+	poll_wait(file, &client->asyncs_wq, wait);
+	return client_gp_has_completions(client);
+}
+
 /*
  * This callback is called on remap
  */
@@ -1316,6 +1874,7 @@ struct tee_mmu *client_mmu_create(struct tee_client *client,
 	struct mc_ioctl_buffer buf = *buf_in;
 	struct cbuf *cbuf = cbuf_get_by_addr(client, buf.va);
 	struct mm_struct *mm = NULL;
+	struct cmmu *cmmu = NULL;
 	struct tee_mmu *mmu;
 
 	*cbuf_p = cbuf;
@@ -1336,15 +1895,33 @@ struct tee_mmu *client_mmu_create(struct tee_client *client,
 			return ERR_PTR(-EINVAL);
 		}
 	} else if (!client_is_kernel(client)) {
-		mm = get_task_mm(current);
+		mm = client_current_mm();
 		if (!mm) {
 			mc_dev_err(-EPERM, "can't get mm");
 			return ERR_PTR(-EPERM);
 		}
 	}
 
+	/* Re-use MMU table if buffer was already mapped and is unchanged */
+	if (mm && !(buf.flags & MMU_ION_BUF)) {
+		mmu = cmmu_find(client, mm, &buf);
+		if (mmu) {
+			mmput(mm);
+			return mmu;
+		}
+
+		cmmu = cmmu_prepare(client, mm, &buf);
+	}
+
 	/* Build MMU table for buffer */
 	mmu = tee_mmu_create(mm, &buf);
+	if (cmmu) {
+		if (!IS_ERR_OR_NULL(mmu))
+			cmmu_add(client, cmmu, mmu);
+		else
+			cmmu_cancel(cmmu);
+	}
+
 	if (mm)
 		mmput(mm);
 
@@ -1354,13 +1931,26 @@ struct tee_mmu *client_mmu_create(struct tee_client *client,
 	return mmu;
 }
 
-void client_init(void)
+int client_init(void)
 {
 	INIT_LIST_HEAD(&client_ctx.clients);
 	mutex_init(&client_ctx.clients_lock);
 
 	INIT_LIST_HEAD(&client_ctx.closing_clients);
 	mutex_init(&client_ctx.closing_clients_lock);
+
+	/* Invocations blocked in the TEE only hold a few workers */
+	client_ctx.async_wq = alloc_workqueue("tee_gp_async", WQ_UNBOUND,
+					      ASYNCS_ACTIVE_MAX);
+	if (!client_ctx.async_wq)
+		return -ENOMEM;
+
+	return 0;
+}
+
+void client_exit(void)
+{
+	destroy_workqueue(client_ctx.async_wq);
 }
 
 static inline int cbuf_debug_structs(struct kasnprintf_buf *buf,
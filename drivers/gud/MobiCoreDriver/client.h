@@ -18,6 +18,7 @@
 
 #include <linux/list.h>
 #include <linux/sched.h>	/* TASK_COMM_LEN */
+#include <linux/poll.h>		/* poll_table */
 
 #include "mc_user.h"	/* many types */
 
@@ -31,6 +32,7 @@ struct tee_client *client_create(bool is_from_kernel);
 void client_get(struct tee_client *client);
 int client_put(struct tee_client *client);
 bool client_has_sessions(struct tee_client *client);
+u64 client_id(struct tee_client *client);
 void client_close(struct tee_client *client);
 void client_cleanup(void);
 
@@ -84,6 +86,14 @@ int client_gp_invoke_command_domu(struct tee_client *client, u32 session_id,
 				  struct tee_mmu **mmus,
 				  struct gp_return *gp_ret);
 void client_gp_request_cancellation(struct tee_client *client, u64 started);
+int client_gp_invoke_submit(struct tee_client *client,
+			    const struct mc_ioctl_gp_async_command *commands,
+			    u32 nr_commands);
+int client_gp_invoke_reap(struct tee_client *client,
+			  struct mc_ioctl_gp_async_command *completions,
+			  u32 nr_completions, s32 timeout);
+bool client_gp_invoke_poll(struct tee_client *client, struct file *file,
+			   poll_table *wait);
 
 /* Contiguous buffer */
 int client_cbuf_create(struct tee_client *client, u32 len, uintptr_t *addr,
@@ -118,7 +128,8 @@ u32 client_get_cwsm_sva(struct tee_client *client,
 void client_put_cwsm_sva(struct tee_client *client, u32 sva);
 
 /* Global */
-void client_init(void);
+int client_init(void);
+void client_exit(void);
 
 /* Debug */
 int clients_debug_structs(struct kasnprintf_buf *buf);
@@ -28,6 +28,10 @@
 #include <linux/freezer.h>
 #include <asm/barrier.h>
 #include <linux/irq.h>
+#include <linux/bitops.h>
+#include <linux/percpu.h>
+#include <linux/uaccess.h>
+#include <linux/workqueue.h>
 #include <linux/version.h>
 #if KERNEL_VERSION(4, 11, 0) <= LINUX_VERSION_CODE
 #include <linux/sched/clock.h>	/* local_clock */
@@ -60,25 +64,46 @@
 /* Parameter number */
 #define _TEEC_PARAMETER_NUMBER	4
 
-struct iws {
-	struct list_head list;
-	u64 slot;
+/* Slots are offsets in the IWS buffer, allocated from a bitmap of indexes */
+#define IWS_SLOT_SIZE		sizeof(struct interworld_session)
+
+/* Where to start looking for a free slot on each CPU, to spread contention */
+static DEFINE_PER_CPU(unsigned int, iws_slot_hint);
+
+/* Session pool: parked sessions, TAs allowed and default idle time */
+#define POOL_SESSIONS_MAX	8
+#define POOL_UUIDS_MAX		16
+#define POOL_IDLE_MS		30000
+
+/* GP session closed by its client but kept open in the SWd for reuse */
+struct iwp_pooled_session {
+	struct list_head	list;
+	struct mc_uuid_t	uuid;
+	struct identity		identity;
+	u64			owner;
+	u32			sid;
+	u64			slot;
+	unsigned long		parked;		/* jiffies */
 };
 
 static struct {
 	bool iwp_dead;
 	struct interworld_session *iws;
-	/* Interworld lists lock */
-	struct mutex		iws_list_lock;
-	/* InterWorld lists */
-	struct iws		*iws_list_pool;
-	struct list_head	free_iws;
-	struct list_head	allocd_iws;
+	/* InterWorld slots in use */
+	DECLARE_BITMAP(iws_slots, MAX_IW_SESSION);
 	/* Sessions */
 	struct mutex		sessions_lock;
 	struct list_head	sessions;
 	/* TEE bad state detection */
 	struct notifier_block	tee_stop_notifier;
+	/* Session pool */
+	struct mutex		pool_lock;
+	struct list_head	pool;
+	int			pool_count;
+	struct mc_uuid_t	pool_uuids[POOL_UUIDS_MAX];
+	int			pool_nr_uuids;
+	u32			pool_idle_ms;
+	struct delayed_work	pool_work;
 	/* Log of last commands */
 #define LAST_CMDS_SIZE 256
 	struct mutex		last_cmds_mutex;	/* Log protection */
@@ -126,6 +151,7 @@ static void iwp_notif_handler(u32 id, u32 payload)
 	mc_dev_devel("IWP: iwp_session [%p] id [%08x] slot [%08x]",
 		     iwp_session, id, payload);
 	nq_session_state_update(&iwp_session->nq_session, NQ_NOTIF_RECEIVED);
+	WRITE_ONCE(iwp_session->notif_clk, local_clock());
 	complete(&iwp_session->completion);
 }
 
@@ -140,55 +166,73 @@ void iwp_session_init(struct iwp_session *iwp_session,
 	init_completion(&iwp_session->completion);
 	mutex_init(&iwp_session->iws_lock);
 	iwp_session->state = IWP_SESSION_RUNNING;
+	iwp_session->lat = NULL;
+	iwp_session->failed = false;
+	iwp_session->owner = 0;
 	if (identity)
 		iwp_session->client_identity = *identity;
 }
 
+/* Lock-free: a bit is only ever owned by whoever managed to set it */
 static u64 iws_slot_get(void)
 {
-	struct iws *iws;
+	unsigned int hint, index;
 	u64 slot = INVALID_IWS_SLOT;
 
 	if (is_xen_domu())
-		return (uintptr_t)kzalloc(sizeof(*iws), GFP_KERNEL);
-
-	mutex_lock(&l_ctx.iws_list_lock);
-	if (!list_empty(&l_ctx.free_iws)) {
-		iws = list_first_entry(&l_ctx.free_iws, struct iws, list);
-		slot = iws->slot;
-		list_move(&iws->list, &l_ctx.allocd_iws);
-		atomic_inc(&g_ctx.c_slots);
-		mc_dev_devel("got slot %llu", slot);
-	}
-	mutex_unlock(&l_ctx.iws_list_lock);
+		return (uintptr_t)kzalloc(IWS_SLOT_SIZE, GFP_KERNEL);
+
+	hint = this_cpu_read(iws_slot_hint);
+	index = hint;
+	do {
+		index = find_next_zero_bit(l_ctx.iws_slots, MAX_IW_SESSION,
+					   index);
+		if (index >= MAX_IW_SESSION) {
+			/* Wrap around once */
+			if (!hint)
+				break;
+
+			index = find_next_zero_bit(l_ctx.iws_slots, hint, 0);
+			if (index >= hint)
+				break;
+
+			hint = 0;
+		}
+
+		if (!test_and_set_bit_lock(index, l_ctx.iws_slots)) {
+			slot = (u64)index * IWS_SLOT_SIZE;
+			this_cpu_write(iws_slot_hint,
+				       (index + 1) % MAX_IW_SESSION);
+			atomic_inc(&g_ctx.c_slots);
+			mc_dev_devel("got slot %llu", slot);
+			break;
+		}
+	} while (true);
+
 	return slot;
 }
 
 /* Passing INVALID_IWS_SLOT is supported */
 static void iws_slot_put(u64 slot)
 {
-	struct iws *iws;
-	bool found = false;
+	u64 index = slot / IWS_SLOT_SIZE;
 
 	if (is_xen_domu()) {
 		kfree((void *)(uintptr_t)slot);
 		return;
 	}
 
-	mutex_lock(&l_ctx.iws_list_lock);
-	list_for_each_entry(iws, &l_ctx.allocd_iws, list) {
-		if (slot == iws->slot) {
-			list_move(&iws->list, &l_ctx.free_iws);
-			atomic_dec(&g_ctx.c_slots);
-			found = true;
-			mc_dev_devel("put slot %llu", slot);
-			break;
-		}
+	if (slot % IWS_SLOT_SIZE || index >= MAX_IW_SESSION ||
+	    !test_bit(index, l_ctx.iws_slots)) {
+		mc_dev_err(-EINVAL, "slot %llu not found", slot);
+		return;
 	}
-	mutex_unlock(&l_ctx.iws_list_lock);
 
-	if (!found)
-		mc_dev_err(-EINVAL, "slot %llu not found", slot);
+	/* Give the slot back to the next allocation on this CPU */
+	this_cpu_write(iws_slot_hint, (unsigned int)index);
+	clear_bit_unlock(index, l_ctx.iws_slots);
+	atomic_dec(&g_ctx.c_slots);
+	mc_dev_devel("put slot %llu", slot);
 }
 
 static inline struct interworld_session *slot_to_iws(u64 slot)
@@ -257,6 +301,9 @@ static int iwp_cmd(struct iwp_session *iwp_session, u32 id,
 		return ret;
 	}
 
+	if (iwp_session->lat)
+		lat_end(iwp_session->lat, LAT_NOTIFY);
+
 	/* Update MCP log */
 	mutex_lock(&l_ctx.last_cmds_mutex);
 	cmd_info->state = SENT;
@@ -284,6 +331,12 @@ static int iwp_cmd(struct iwp_session *iwp_session, u32 id,
 		wait_for_completion(&iwp_session->completion);
 	}
 
+	if (iwp_session->lat) {
+		iwp_session->lat->clk[LAT_SWD + 1] =
+			READ_ONCE(iwp_session->notif_clk);
+		lat_end(iwp_session->lat, LAT_WAKEUP);
+	}
+
 	if (l_ctx.iwp_dead)
 		return -EHOSTUNREACH;
 
@@ -727,6 +780,8 @@ int iwp_open_session(
 	struct mcp_buffer_map obj_map;
 	int ret;
 
+	iwp_session->uuid = *uuid;
+
 	/* Operation is NULL when called from Xen BE */
 	if (operation) {
 		/* Login info */
@@ -869,7 +924,196 @@ static void iwp_session_release(
 	mutex_unlock(&l_ctx.sessions_lock);
 
 	nq_session_exit(&iwp_session->nq_session);
-	iws_slot_put(iwp_session->slot);
+	if (iwp_session->slot != INVALID_IWS_SLOT)
+		iws_slot_put(iwp_session->slot);
+}
+
+static inline bool iwp_pool_uuid_allowed(const struct mc_uuid_t *uuid)
+{
+	int i;
+
+	for (i = 0; i < l_ctx.pool_nr_uuids; i++)
+		if (!memcmp(&l_ctx.pool_uuids[i], uuid, sizeof(*uuid)))
+			return true;
+
+	return false;
+}
+
+/*
+ * Keep the SWd session for the next matching open by the same client, if its
+ * TA is allowed. Public and kernel logins do not tell clients apart in the
+ * SWd, so their sessions are never kept.
+ */
+static bool iwp_session_park(struct iwp_session *iwp_session)
+{
+	struct iwp_pooled_session *pooled = NULL;
+	u32 login_type = iwp_session->client_identity.login_type;
+
+	if (iwp_session->state != IWP_SESSION_RUNNING ||
+	    iwp_session->sid == SID_INVALID || iwp_session->failed ||
+	    !iwp_session->owner || l_ctx.iwp_dead ||
+	    login_type == LOGIN_PUBLIC || login_type == TEEC_TT_LOGIN_KERNEL)
+		return false;
+
+	mutex_lock(&l_ctx.pool_lock);
+	if (l_ctx.pool_count < POOL_SESSIONS_MAX &&
+	    iwp_pool_uuid_allowed(&iwp_session->uuid))
+		pooled = kzalloc(sizeof(*pooled), GFP_KERNEL);
+
+	if (pooled) {
+		pooled->uuid = iwp_session->uuid;
+		pooled->identity = iwp_session->client_identity;
+		pooled->owner = iwp_session->owner;
+		pooled->sid = iwp_session->sid;
+		pooled->slot = iwp_session->slot;
+		pooled->parked = jiffies;
+		list_add(&pooled->list, &l_ctx.pool);
+		l_ctx.pool_count++;
+		schedule_delayed_work(&l_ctx.pool_work,
+				      msecs_to_jiffies(l_ctx.pool_idle_ms));
+	}
+	mutex_unlock(&l_ctx.pool_lock);
+	return pooled != NULL;
+}
+
+int iwp_open_session_pooled(
+	struct iwp_session *iwp_session,
+	const struct mc_uuid_t *uuid,
+	struct gp_operation *operation,
+	struct gp_return *gp_ret)
+{
+	struct iwp_pooled_session *pooled = NULL, *candidate;
+
+	/* Parameters are meant for the TA open entry point, not called here */
+	if (is_xen_domu() || operation->param_types || !iwp_session->owner)
+		return -ENOENT;
+
+	mutex_lock(&l_ctx.pool_lock);
+	list_for_each_entry(candidate, &l_ctx.pool, list) {
+		if (candidate->owner == iwp_session->owner &&
+		    !memcmp(&candidate->uuid, uuid, sizeof(*uuid)) &&
+		    !memcmp(&candidate->identity,
+			    &iwp_session->client_identity,
+			    sizeof(candidate->identity))) {
+			pooled = candidate;
+			list_del(&pooled->list);
+			l_ctx.pool_count--;
+			break;
+		}
+	}
+	mutex_unlock(&l_ctx.pool_lock);
+	if (!pooled)
+		return -ENOENT;
+
+	iwp_session->sid = pooled->sid;
+	iwp_session->slot = pooled->slot;
+	iwp_session->uuid = pooled->uuid;
+	kfree(pooled);
+
+	/* Add to local list of sessions so we can receive notifications */
+	mutex_lock(&l_ctx.sessions_lock);
+	list_add_tail(&iwp_session->list, &l_ctx.sessions);
+	mutex_unlock(&l_ctx.sessions_lock);
+	mc_dev_devel("reuse session %x", iwp_session->sid);
+	return iwp_set_ret(0, gp_ret);
+}
+
+static int iwp_session_close_swd(struct iwp_session *iwp_session)
+{
+	int ret;
+
+	mutex_lock(&iwp_session->iws_lock);
+	iwp_session->state = IWP_SESSION_CLOSE_REQUESTED;
+
+	/* Send IWP close command */
+	ret = iwp_cmd(iwp_session, SID_CLOSE_SESSION, NULL, false);
+	mutex_unlock(&iwp_session->iws_lock);
+	return ret;
+}
+
+static void iwp_pooled_session_close(struct iwp_pooled_session *pooled)
+{
+	/* Pseudo IWP session to close the SWd one */
+	struct iwp_session iwp_session;
+	int ret;
+
+	iwp_session_init(&iwp_session, &pooled->identity);
+	iwp_session.sid = pooled->sid;
+	iwp_session.slot = pooled->slot;
+	iwp_session.uuid = pooled->uuid;
+	mutex_lock(&l_ctx.sessions_lock);
+	list_add_tail(&iwp_session.list, &l_ctx.sessions);
+	mutex_unlock(&l_ctx.sessions_lock);
+	ret = iwp_session_close_swd(&iwp_session);
+	iwp_session_release(&iwp_session);
+	mc_dev_devel("close parked session %x ret %d", pooled->sid, ret);
+	kfree(pooled);
+}
+
+/* Close parked sessions idle for too long, or all of them */
+static void iwp_pool_close(bool all)
+{
+	unsigned long idle = msecs_to_jiffies(l_ctx.pool_idle_ms);
+	struct iwp_pooled_session *pooled, *next;
+	LIST_HEAD(expired);
+
+	mutex_lock(&l_ctx.pool_lock);
+	list_for_each_entry_safe(pooled, next, &l_ctx.pool, list) {
+		if (!all && time_before(jiffies, pooled->parked + idle))
+			continue;
+
+		list_move(&pooled->list, &expired);
+		l_ctx.pool_count--;
+	}
+
+	if (l_ctx.pool_count)
+		schedule_delayed_work(&l_ctx.pool_work, idle);
+
+	mutex_unlock(&l_ctx.pool_lock);
+
+	list_for_each_entry_safe(pooled, next, &expired, list)
+		iwp_pooled_session_close(pooled);
+}
+
+/* Client is closing: nobody else may reuse its parked sessions */
+void iwp_pool_close_owner(u64 owner)
+{
+	struct iwp_pooled_session *pooled, *next;
+	LIST_HEAD(expired);
+
+	mutex_lock(&l_ctx.pool_lock);
+	list_for_each_entry_safe(pooled, next, &l_ctx.pool, list) {
+		if (pooled->owner != owner)
+			continue;
+
+		list_move(&pooled->list, &expired);
+		l_ctx.pool_count--;
+	}
+	mutex_unlock(&l_ctx.pool_lock);
+
+	list_for_each_entry_safe(pooled, next, &expired, list)
+		iwp_pooled_session_close(pooled);
+}
+
+/* SWd is gone with the sessions it had: just forget the parked ones */
+static void iwp_pool_drop(void)
+{
+	struct iwp_pooled_session *pooled, *next;
+
+	mutex_lock(&l_ctx.pool_lock);
+	list_for_each_entry_safe(pooled, next, &l_ctx.pool, list) {
+		list_del(&pooled->list);
+		iws_slot_put(pooled->slot);
+		kfree(pooled);
+	}
+
+	l_ctx.pool_count = 0;
+	mutex_unlock(&l_ctx.pool_lock);
+}
+
+static void iwp_pool_worker(struct work_struct *work)
+{
+	iwp_pool_close(false);
 }
 
 /*
@@ -886,13 +1130,12 @@ int iwp_close_session(
 #ifdef TRUSTONIC_XEN_DOMU
 		ret = xen_gp_close_session(iwp_session);
 #endif
+	} else if (iwp_session_park(iwp_session)) {
+		/* The slot now belongs to the parked session */
+		iwp_session->slot = INVALID_IWS_SLOT;
+		mc_dev_devel("park session %x", iwp_session->sid);
 	} else {
-		mutex_lock(&iwp_session->iws_lock);
-		iwp_session->state = IWP_SESSION_CLOSE_REQUESTED;
-
-		/* Send IWP open command */
-		ret = iwp_cmd(iwp_session, SID_CLOSE_SESSION, NULL, false);
-		mutex_unlock(&iwp_session->iws_lock);
+		ret = iwp_session_close_swd(iwp_session);
 	}
 
 	iwp_session_release(iwp_session);
@@ -990,6 +1233,11 @@ int iwp_invoke_command(
 		gp_ret->value = iws->status;
 	}
 
+	/* Only errors from the TA itself leave the session fit for reuse */
+	if (ret && gp_ret->origin != TEEC_ORIGIN_TRUSTED_APP)
+		iwp_session->failed = true;
+
+	iwp_session->lat = NULL;
 	mutex_unlock(&iwp_session->iws_lock);
 	return ret;
 }
@@ -1149,6 +1397,98 @@ static const struct file_operations debug_last_cmds_ops = {
 	.release = debug_generic_release,
 };
 
+static int debug_session_pool(struct kasnprintf_buf *buf)
+{
+	struct iwp_pooled_session *pooled;
+	int i, ret = 0;
+
+	mutex_lock(&l_ctx.pool_lock);
+	for (i = 0; i < l_ctx.pool_nr_uuids; i++) {
+		ret = kasnprintf(buf, "allowed %*phN\n",
+				 (int)sizeof(l_ctx.pool_uuids[i].value),
+				 l_ctx.pool_uuids[i].value);
+		if (ret < 0)
+			goto out;
+	}
+
+	list_for_each_entry(pooled, &l_ctx.pool, list) {
+		ret = kasnprintf(buf, "parked  %*phN %5x login %x idle %ums\n",
+				 (int)sizeof(pooled->uuid.value),
+				 pooled->uuid.value, pooled->sid,
+				 pooled->identity.login_type,
+				 jiffies_to_msecs(jiffies - pooled->parked));
+		if (ret < 0)
+			goto out;
+	}
+
+out:
+	mutex_unlock(&l_ctx.pool_lock);
+	return ret;
+}
+
+static ssize_t debug_session_pool_read(struct file *file,
+				       char __user *user_buf, size_t count,
+				       loff_t *ppos)
+{
+	return debug_generic_read(file, user_buf, count, ppos,
+				  debug_session_pool);
+}
+
+/*
+ * Commands:
+ * - <UUID as 32 hex digits>: allow sessions to that TA to be parked
+ * - flush: close all parked sessions
+ * - reset: close all parked sessions and forget the allowed TAs
+ */
+static ssize_t debug_session_pool_write(struct file *file,
+					const char __user *user_buf,
+					size_t count, loff_t *ppos)
+{
+	struct mc_uuid_t uuid;
+	char cmd[40];
+	char *str;
+	int ret = 0;
+
+	if (count >= sizeof(cmd))
+		return -EINVAL;
+
+	if (copy_from_user(cmd, user_buf, count))
+		return -EFAULT;
+
+	cmd[count] = '\0';
+	str = strim(cmd);
+	if (!strcmp(str, "flush")) {
+		iwp_pool_close(true);
+	} else if (!strcmp(str, "reset")) {
+		mutex_lock(&l_ctx.pool_lock);
+		l_ctx.pool_nr_uuids = 0;
+		mutex_unlock(&l_ctx.pool_lock);
+		iwp_pool_close(true);
+	} else if (strlen(str) == 2 * sizeof(uuid.value) &&
+		   !hex2bin(uuid.value, str, sizeof(uuid.value))) {
+		mutex_lock(&l_ctx.pool_lock);
+		if (iwp_pool_uuid_allowed(&uuid))
+			ret = 0;
+		else if (l_ctx.pool_nr_uuids < POOL_UUIDS_MAX)
+			l_ctx.pool_uuids[l_ctx.pool_nr_uuids++] = uuid;
+		else
+			ret = -ENOSPC;
+		mutex_unlock(&l_ctx.pool_lock);
+	} else {
+		ret = -EINVAL;
+	}
+
+	return ret ? ret : count;
+}
+
+static const struct file_operations debug_session_pool_ops = {
+	.read = debug_session_pool_read,
+	.write = debug_session_pool_write,
+	.llseek = default_llseek,
+	.open = debug_generic_open,
+	.release = debug_generic_release,
+};
+
 static inline void mark_iwp_dead(void)
 {
 	struct iwp_session *session;
@@ -1165,30 +1505,20 @@ static int tee_stop_notifier_fn(struct notifier_block *nb, unsigned long event,
 				void *data)
 {
 	mark_iwp_dead();
+	iwp_pool_drop();
 	return 0;
 }
 
 int iwp_init(void)
 {
-	int i;
-
 	l_ctx.iws = nq_get_iwp_buffer();
-	INIT_LIST_HEAD(&l_ctx.free_iws);
-	INIT_LIST_HEAD(&l_ctx.allocd_iws);
-	l_ctx.iws_list_pool = kcalloc(MAX_IW_SESSION, sizeof(struct iws),
-				      GFP_KERNEL);
-	if (!l_ctx.iws_list_pool)
-		return -ENOMEM;
-
-	for (i = 0; i < MAX_IW_SESSION; i++) {
-		l_ctx.iws_list_pool[i].slot =
-			i * sizeof(struct interworld_session);
-		list_add(&l_ctx.iws_list_pool[i].list, &l_ctx.free_iws);
-	}
-
-	mutex_init(&l_ctx.iws_list_lock);
+	bitmap_zero(l_ctx.iws_slots, MAX_IW_SESSION);
 	INIT_LIST_HEAD(&l_ctx.sessions);
 	mutex_init(&l_ctx.sessions_lock);
+	mutex_init(&l_ctx.pool_lock);
+	INIT_LIST_HEAD(&l_ctx.pool);
+	l_ctx.pool_idle_ms = POOL_IDLE_MS;
+	INIT_DELAYED_WORK(&l_ctx.pool_work, iwp_pool_worker);
 	nq_register_notif_handler(iwp_notif_handler, true);
 	l_ctx.tee_stop_notifier.notifier_call = tee_stop_notifier_fn;
 	nq_register_tee_stop_notifier(&l_ctx.tee_stop_notifier);
@@ -1210,9 +1540,19 @@ int iwp_start(void)
 			    &debug_sessions_ops);
 	debugfs_create_file("last_iwp_commands", 0400, g_ctx.debug_dir, NULL,
 			    &debug_last_cmds_ops);
+	debugfs_create_file("gp_session_pool", 0600, g_ctx.debug_dir, NULL,
+			    &debug_session_pool_ops);
+	debugfs_create_u32("gp_session_pool_idle_ms", 0600, g_ctx.debug_dir,
+			   &l_ctx.pool_idle_ms);
 	return 0;
 }
 
 void iwp_stop(void)
 {
+	/* Close parked sessions while the SWd is still there */
+	mutex_lock(&l_ctx.pool_lock);
+	l_ctx.pool_nr_uuids = 0;
+	mutex_unlock(&l_ctx.pool_lock);
+	cancel_delayed_work_sync(&l_ctx.pool_work);
+	iwp_pool_close(true);
 }
@@ -20,6 +20,7 @@
 
 #include "nq.h"
 #include "mcp.h" /* mcp_buffer_map FIXME move to nq? */
+#include "latency.h"
 
 struct iwp_session {
 	/* Notification queue session */
@@ -46,6 +47,16 @@ struct iwp_session {
 	}			state;
 	/* GP TAs have login information */
 	struct identity		client_identity;
+	/* TA, for latency accounting */
+	struct mc_uuid_t	uuid;
+	/* Time of last notification */
+	u64			notif_clk;
+	/* Timestamps of the invocation in progress (protected by iws_lock) */
+	struct lat_clocks	*lat;
+	/* A command failed outside the TA, so the session cannot be pooled */
+	bool			failed;
+	/* Client which opened the session, the only one to reuse it parked */
+	u64			owner;
 };
 
 struct iwp_buffer_map {
@@ -86,6 +97,12 @@ int iwp_open_session_prepare(
 	struct gp_return *gp_ret);
 void iwp_open_session_abort(
 	struct iwp_session *iwp_session);
+/* Returns -ENOENT if no parked session matches */
+int iwp_open_session_pooled(
+	struct iwp_session *iwp_session,
+	const struct mc_uuid_t *uuid,
+	struct gp_operation *operation,
+	struct gp_return *gp_ret);
 int iwp_open_session(
 	struct iwp_session *iwp_session,
 	const struct mc_uuid_t *uuid,
@@ -96,6 +113,7 @@ int iwp_open_session(
 	struct gp_return *gp_ret);
 int iwp_close_session(
 	struct iwp_session *iwp_session);
+void iwp_pool_close_owner(u64 owner);
 int iwp_invoke_command_prepare(
 	struct iwp_session *iwp_session,
 	u32 command_id,
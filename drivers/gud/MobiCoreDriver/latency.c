@@ -0,0 +1,288 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (c) 2026 Motorola Mobility, LLC.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/uaccess.h>
+
+#include "main.h"
+#include "latency.h"
+
+#define CREATE_TRACE_POINTS
+#include "mc_trace.h"
+
+/*
+ * Log2 histograms: bucket 0 is below 1us, bucket n covers [2^(n-1), 2^n) us,
+ * the last one collecting everything above.
+ */
+#define LAT_BUCKETS		24
+/* Commands are keyed by TA, id and command, overflow goes to the last key */
+#define LAT_KEYS		64
+
+struct lat_hist {
+	u64	count;
+	u64	total_ns;
+	u32	buckets[LAT_BUCKETS];
+};
+
+struct lat_key {
+	struct mc_uuid_t	uuid;
+	u32			id;
+	u32			command_id;
+	struct lat_hist		phases[LAT_PHASES];
+};
+
+static const char *const lat_phase_names[LAT_PHASES] = {
+	"prepare", "notify", "swd", "wakeup", "unmap",
+};
+
+static struct {
+	struct mutex		lock;		/* Protects all below */
+	struct lat_key		keys[LAT_KEYS];
+	int			nr_keys;
+} l_ctx;
+
+/*
+ * SMCs into the SWd: N-SIQ and yield. Accounted from the scheduler for each
+ * SMC, so kept per CPU rather than under the lock.
+ */
+static DEFINE_PER_CPU(struct lat_hist[2], lat_swd_runs);
+
+static inline void lat_hist_add(struct lat_hist *hist, u64 ns)
+{
+	u64 us = div_u64(ns, NSEC_PER_USEC);
+	int bucket = us ? ilog2(us) + 1 : 0;
+
+	if (bucket >= LAT_BUCKETS)
+		bucket = LAT_BUCKETS - 1;
+
+	hist->count++;
+	hist->total_ns += ns;
+	hist->buckets[bucket]++;
+}
+
+/* Upper bound of the bucket where the percentile falls, in us */
+static u64 lat_hist_percentile(const struct lat_hist *hist, int percent)
+{
+	u64 target = div_u64(hist->count * percent + 99, 100);
+	u64 seen = 0;
+	int i;
+
+	if (!hist->count)
+		return 0;
+
+	for (i = 0; i < LAT_BUCKETS; i++) {
+		seen += hist->buckets[i];
+		if (seen >= target)
+			break;
+	}
+
+	return i < LAT_BUCKETS ? BIT_ULL(i) : BIT_ULL(LAT_BUCKETS);
+}
+
+static struct lat_key *lat_key_get(const struct mc_uuid_t *uuid, u32 id,
+				   u32 command_id)
+{
+	static const struct mc_uuid_t null_uuid;
+	struct lat_key *key;
+	int i;
+
+	if (!uuid)
+		uuid = &null_uuid;
+
+	for (i = 0; i < l_ctx.nr_keys; i++) {
+		key = &l_ctx.keys[i];
+		if (key->id == id && key->command_id == command_id &&
+		    !memcmp(&key->uuid, uuid, sizeof(*uuid)))
+			return key;
+	}
+
+	/* Last key is shared by all commands which did not fit */
+	if (l_ctx.nr_keys == LAT_KEYS)
+		return &l_ctx.keys[LAT_KEYS - 1];
+
+	key = &l_ctx.keys[l_ctx.nr_keys++];
+	if (l_ctx.nr_keys < LAT_KEYS) {
+		key->uuid = *uuid;
+		key->id = id;
+		key->command_id = command_id;
+	} else {
+		memset(&key->uuid, 0xff, sizeof(key->uuid));
+		key->id = U32_MAX;
+		key->command_id = U32_MAX;
+	}
+
+	return key;
+}
+
+void lat_record(const struct mc_uuid_t *uuid, u32 id, u32 command_id,
+		const struct lat_clocks *lat)
+{
+	static const struct mc_uuid_t null_uuid;
+	u64 ns[LAT_PHASES];
+	u64 prev = lat->clk[0];
+	struct lat_key *key;
+	int i;
+
+	/* A phase which was not reached lasted nothing */
+	for (i = 0; i < LAT_PHASES; i++) {
+		u64 clk = lat->clk[i + 1];
+
+		if (clk < prev)
+			clk = prev;
+
+		ns[i] = clk - prev;
+		prev = clk;
+	}
+
+	trace_mobicore_cmd(uuid ? uuid->value : null_uuid.value, id,
+			   command_id, ns);
+
+	mutex_lock(&l_ctx.lock);
+	key = lat_key_get(uuid, id, command_id);
+	for (i = 0; i < LAT_PHASES; i++)
+		lat_hist_add(&key->phases[i], ns[i]);
+
+	mutex_unlock(&l_ctx.lock);
+}
+
+void lat_swd_run(bool nsiq, u64 ns)
+{
+	struct lat_hist *hist;
+
+	trace_mobicore_swd_run(nsiq, ns);
+	hist = get_cpu_ptr(&lat_swd_runs[nsiq ? 0 : 1]);
+	lat_hist_add(hist, ns);
+	put_cpu_ptr(hist);
+}
+
+/* Sum of the per-CPU histograms, which may be updated meanwhile */
+static void lat_swd_runs_sum(struct lat_hist *sum)
+{
+	int cpu, i, j;
+
+	memset(sum, 0, 2 * sizeof(*sum));
+	for_each_possible_cpu(cpu) {
+		for (i = 0; i < 2; i++) {
+			const struct lat_hist *hist =
+				per_cpu_ptr(&lat_swd_runs[i], cpu);
+
+			sum[i].count += hist->count;
+			sum[i].total_ns += hist->total_ns;
+			for (j = 0; j < LAT_BUCKETS; j++)
+				sum[i].buckets[j] += hist->buckets[j];
+		}
+	}
+}
+
+static int lat_hist_show(struct kasnprintf_buf *buf, const char *name,
+			 const struct lat_hist *hist)
+{
+	return kasnprintf(buf, "\t%-8s %10llu %10llu %10llu %10llu\n", name,
+			  hist->count,
+			  hist->count ?
+			  div64_u64(hist->total_ns,
+				    hist->count * NSEC_PER_USEC) : 0,
+			  lat_hist_percentile(hist, 50),
+			  lat_hist_percentile(hist, 99));
+}
+
+static int debug_latency(struct kasnprintf_buf *buf)
+{
+	struct lat_hist swd_runs[2];
+	int i, j, ret;
+
+	lat_swd_runs_sum(swd_runs);
+	ret = kasnprintf(buf, "\t%-8s %10s %10s %10s %10s\n", "phase",
+			 "count", "avg(us)", "p50(us)", "p99(us)");
+	if (ret < 0)
+		return ret;
+
+	mutex_lock(&l_ctx.lock);
+	ret = kasnprintf(buf, "smc\n");
+	if (ret < 0)
+		goto out;
+
+	ret = lat_hist_show(buf, "nsiq", &swd_runs[0]);
+	if (ret < 0)
+		goto out;
+
+	ret = lat_hist_show(buf, "yield", &swd_runs[1]);
+	if (ret < 0)
+		goto out;
+
+	for (i = 0; i < l_ctx.nr_keys; i++) {
+		struct lat_key *key = &l_ctx.keys[i];
+
+		ret = kasnprintf(buf, "%*phN id %x cmd %x\n",
+				 (int)sizeof(key->uuid), key->uuid.value,
+				 key->id, key->command_id);
+		if (ret < 0)
+			goto out;
+
+		for (j = 0; j < LAT_PHASES; j++) {
+			ret = lat_hist_show(buf, lat_phase_names[j],
+					    &key->phases[j]);
+			if (ret < 0)
+				goto out;
+		}
+	}
+
+out:
+	mutex_unlock(&l_ctx.lock);
+	return ret;
+}
+
+static ssize_t debug_latency_read(struct file *file, char __user *user_buf,
+				  size_t count, loff_t *ppos)
+{
+	return debug_generic_read(file, user_buf, count, ppos,
+				  debug_latency);
+}
+
+/* Any write resets the statistics */
+static ssize_t debug_latency_write(struct file *file,
+				   const char __user *user_buf,
+				   size_t count, loff_t *ppos)
+{
+	int cpu;
+
+	mutex_lock(&l_ctx.lock);
+	memset(l_ctx.keys, 0, sizeof(l_ctx.keys));
+	l_ctx.nr_keys = 0;
+	mutex_unlock(&l_ctx.lock);
+	/* An SMC accounted meanwhile may survive the reset, or partly */
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(&lat_swd_runs, cpu), 0,
+		       sizeof(lat_swd_runs));
+	return count;
+}
+
+static const struct file_operations debug_latency_ops = {
+	.read = debug_latency_read,
+	.write = debug_latency_write,
+	.llseek = default_llseek,
+	.open = debug_generic_open,
+	.release = debug_generic_release,
+};
+
+void lat_init(void)
+{
+	mutex_init(&l_ctx.lock);
+	debugfs_create_file("latency", 0600, g_ctx.debug_dir, NULL,
+			    &debug_latency_ops);
+}
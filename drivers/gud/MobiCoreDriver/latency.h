@@ -0,0 +1,67 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright (c) 2026 Motorola Mobility, LLC.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _MC_LATENCY_H_
+#define _MC_LATENCY_H_
+
+#include <linux/string.h>
+#include <linux/types.h>
+#include <linux/version.h>
+#if KERNEL_VERSION(4, 11, 0) <= LINUX_VERSION_CODE
+#include <linux/sched/clock.h>	/* local_clock */
+#else
+#include <linux/sched.h>	/* local_clock */
+#endif
+
+#include "mc_user.h"		/* struct mc_uuid_t */
+
+/* Phases of a command, in order */
+enum lat_phase {
+	LAT_PREPARE,	/* Operation set up, buffers mapped */
+	LAT_NOTIFY,	/* Notification queued for the SWd */
+	LAT_SWD,	/* Until the SWd notified us back */
+	LAT_WAKEUP,	/* Until the waiter got to run again */
+	LAT_UNMAP,	/* Buffers unmapped */
+	LAT_PHASES,
+};
+
+/* Command timestamps: phase p runs from clk[p] to clk[p + 1] */
+struct lat_clocks {
+	u64	clk[LAT_PHASES + 1];
+};
+
+static inline void lat_start(struct lat_clocks *lat)
+{
+	memset(lat, 0, sizeof(*lat));
+	lat->clk[0] = local_clock();
+}
+
+static inline void lat_end(struct lat_clocks *lat, enum lat_phase phase)
+{
+	lat->clk[phase + 1] = local_clock();
+}
+
+/*
+ * Account a command, uuid may be NULL for commands without a TA. GP sessions
+ * are accounted as commands SID_OPEN_SESSION and SID_CLOSE_SESSION, with
+ * command_id 0.
+ */
+void lat_record(const struct mc_uuid_t *uuid, u32 id, u32 command_id,
+		const struct lat_clocks *lat);
+/* Account one SMC into the SWd, done by the scheduler */
+void lat_swd_run(bool nsiq, u64 ns);
+
+void lat_init(void);
+
+#endif /* _MC_LATENCY_H_ */
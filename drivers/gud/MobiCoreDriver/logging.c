@@ -18,6 +18,9 @@
 #include <linux/slab.h>
 #include <linux/device.h>
 #include <linux/debugfs.h>
+#include <linux/kfifo.h>
+#include <linux/ratelimit.h>
+#include <linux/uaccess.h>
 #include <linux/version.h>
 
 #include "main.h"
@@ -50,6 +53,9 @@
 #define LOG_CPUID_MASK            (0xF000)
 #define LOG_CPUID_SHIFT           12
 
+/* Number of raw log records kept for readers of swd_log, power of 2 */
+#define LOG_RING_SIZE			8192
+
 struct mc_logmsg {
 	u16	ctrl;		/* Type and format of data */
 	u16	source;		/* Unique value for each event source */
@@ -77,10 +83,16 @@ static struct logging_ctx {
 	u16	prev_source;		/* Previous Log source */
 	char	line[LOG_LINE_SIZE + 1];/* Log Line buffer */
 	u32	line_len;		/* Log Line buffer current length */
+	/* Raw records, decoded by the reader of swd_log, oldest dropped */
+	DECLARE_KFIFO(ring, struct mc_logmsg, LOG_RING_SIZE);
+	struct mutex ring_mutex;	/* Protect ring reads */
+	struct ratelimit_state printk_rs;
 #if KERNEL_VERSION(4, 4, 0) > LINUX_VERSION_CODE
 	u32	enabled;		/* Log can be disabled via debugfs */
+	u32	printk;			/* Log lines printed in kernel log */
 #else
 	bool	enabled;		/* Log can be disabled via debugfs */
+	bool	printk;			/* Log lines printed in kernel log */
 #endif
 	bool	dead;
 } log_ctx;
@@ -90,13 +102,18 @@ static inline void log_eol(u16 source, u32 cpuid)
 	if (!log_ctx.line_len)
 		return;
 
-	if (log_ctx.prev_source)
-		/* TEE user-space */
-		dev_info(g_ctx.mcd, "%03x(%u)|%s\n", log_ctx.prev_source,
-			 cpuid, log_ctx.line);
-	else
-		/* TEE kernel */
-		dev_info(g_ctx.mcd, "mtk(%u)|%s\n", cpuid, log_ctx.line);
+	/* TA log storms must not flood the kernel log */
+	if (__ratelimit(&log_ctx.printk_rs)) {
+		if (log_ctx.prev_source)
+			/* TEE user-space */
+			dev_info(g_ctx.mcd, "%03x(%u)|%s\n",
+				 log_ctx.prev_source, cpuid, log_ctx.line);
+		else
+			/* TEE kernel */
+			dev_info(g_ctx.mcd, "mtk(%u)|%s\n", cpuid,
+				 log_ctx.line);
+	}
+
 	log_ctx.line[0] = '\0';
 	log_ctx.line_len = 0;
 }
@@ -171,12 +188,40 @@ static inline int log_msg(void *data)
 	return sizeof(*msg);
 }
 
+/*
+ * Copy records to the ring, dropping the oldest ones if there is no room
+ */
+static void log_ring_in(const struct mc_logmsg *msgs, u32 count)
+{
+	if (count > LOG_RING_SIZE) {
+		msgs += count - LOG_RING_SIZE;
+		count = LOG_RING_SIZE;
+	}
+
+	if (kfifo_avail(&log_ctx.ring) < count) {
+		mutex_lock(&log_ctx.ring_mutex);
+		while (kfifo_avail(&log_ctx.ring) < count)
+			kfifo_skip(&log_ctx.ring);
+		mutex_unlock(&log_ctx.ring_mutex);
+	}
+
+	kfifo_in(&log_ctx.ring, msgs, count);
+}
+
 static void logging_worker(struct kthread_work *work)
 {
 	static DEFINE_MUTEX(local_mutex);
+	/* Messages are never split at the end of the buffer */
+	u32 end = rounddown(log_ctx.trace_buf->length,
+			    sizeof(struct mc_logmsg));
 
 	mutex_lock(&local_mutex);
 	while (log_ctx.trace_buf->head != log_ctx.tail) {
+		u32 head = READ_ONCE(log_ctx.trace_buf->head);
+		u32 chunk_end = head > log_ctx.tail ? head : end;
+		struct mc_logmsg *msgs;
+		u32 i, count;
+
 		if (log_ctx.trace_buf->version != MC_LOG_VERSION) {
 			mc_dev_err(-EINVAL, "Bad log data v%d (exp. v%d), stop",
 				   log_ctx.trace_buf->version, MC_LOG_VERSION);
@@ -184,7 +229,15 @@ static void logging_worker(struct kthread_work *work)
 			break;
 		}
 
-		log_ctx.tail += log_msg(&log_ctx.trace_buf->buff[log_ctx.tail]);
+		/* Take all contiguous messages in one go */
+		msgs = (struct mc_logmsg *)&log_ctx.trace_buf->buff[log_ctx.tail];
+		count = (chunk_end - log_ctx.tail) / sizeof(*msgs);
+		log_ring_in(msgs, count);
+		if (log_ctx.printk)
+			for (i = 0; i < count; i++)
+				log_msg(&msgs[i]);
+
+		log_ctx.tail += count * sizeof(*msgs);
 		/* Wrap over if no space left for a complete message */
 		if ((log_ctx.tail + sizeof(struct mc_logmsg)) >
 						log_ctx.trace_buf->length)
@@ -193,6 +246,29 @@ static void logging_worker(struct kthread_work *work)
 	mutex_unlock(&local_mutex);
 }
 
+/*
+ * Raw SWd log records (struct mc_logmsg), decoding is left to the reader
+ */
+static ssize_t debug_log_read(struct file *file, char __user *user_buf,
+			      size_t count, loff_t *ppos)
+{
+	unsigned int copied;
+	int ret;
+
+	mutex_lock(&log_ctx.ring_mutex);
+	ret = kfifo_to_user(&log_ctx.ring, user_buf, count, &copied);
+	mutex_unlock(&log_ctx.ring_mutex);
+	if (ret)
+		return ret;
+
+	return copied;
+}
+
+static const struct file_operations debug_log_ops = {
+	.read = debug_log_read,
+	.llseek = default_llseek,
+};
+
 /*
  * Wake up the log reader thread
  * This should be called from the places where calls into MobiCore have
@@ -242,10 +318,21 @@ int logging_init(phys_addr_t *buffer, u32 *size)
 
 	wake_up_process(log_ctx.thread);
 
-	/* Debugfs switch */
+	/* Raw log ring and kernel log forwarding */
+	INIT_KFIFO(log_ctx.ring);
+	mutex_init(&log_ctx.ring_mutex);
+	ratelimit_state_init(&log_ctx.printk_rs, DEFAULT_RATELIMIT_INTERVAL,
+			     DEFAULT_RATELIMIT_BURST);
+
+	/* Debugfs switches */
 	log_ctx.enabled = true;
+	log_ctx.printk = true;
 	debugfs_create_bool("swd_debug", 0600, g_ctx.debug_dir,
 			    &log_ctx.enabled);
+	debugfs_create_bool("swd_debug_printk", 0600, g_ctx.debug_dir,
+			    &log_ctx.printk);
+	debugfs_create_file("swd_log", 0400, g_ctx.debug_dir, NULL,
+			    &debug_log_ops);
 	return 0;
 }
 
@@ -32,9 +32,13 @@
 #include "admin.h"
 #include "user.h"
 #include "iwp.h"
+#include "latency.h"
 #include "mcp.h"
 #include "nq.h"
 #include "client.h"
+#include "session.h"
+#include "simulator.h"
+#include "mmu.h"
 #include "xen_be.h"
 #include "xen_fe.h"
 #include "build_tag.h"
@@ -618,9 +622,15 @@ static int mobicore_probe(struct platform_device *pdev)
 	/* Create debugfs info entries */
 	debugfs_create_file("structs_counters", 0400, g_ctx.debug_dir, NULL,
 			    &debug_struct_counters_ops);
+	lat_init();
+	simulator_init();
 
 	/* Initialize common API layer */
-	client_init();
+	ret = client_init();
+	if (ret)
+		goto fail_client_init;
+
+	session_init();
 
 	/* Initialize plenty of nice features */
 	ret = nq_init();
@@ -671,6 +681,8 @@ err_iwp:
 err_mcp:
 	nq_exit();
 fail_nq_init:
+	client_exit();
+fail_client_init:
 	debugfs_remove_recursive(g_ctx.debug_dir);
 	return ret;
 }
@@ -732,6 +744,9 @@ static void __exit mobicore_exit(void)
 	iwp_exit();
 	mcp_exit();
 	nq_exit();
+	session_exit();
+	client_exit();
+	tee_mmu_exit();
 	debugfs_remove_recursive(g_ctx.debug_dir);
 }
 
@@ -0,0 +1,84 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright (c) 2026 Motorola Mobility, LLC.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM mobicore
+
+#if !defined(_MC_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _MC_TRACE_H_
+
+#include <linux/tracepoint.h>
+
+/* Phase durations of an MCP or IWP command, in ns */
+TRACE_EVENT(mobicore_cmd,
+
+	TP_PROTO(const u8 *uuid, u32 id, u32 command_id, const u64 *ns),
+
+	TP_ARGS(uuid, id, command_id, ns),
+
+	TP_STRUCT__entry(
+		__array(u8,	uuid,		16)
+		__field(u32,	id)
+		__field(u32,	command_id)
+		__field(u64,	prepare)
+		__field(u64,	notify)
+		__field(u64,	swd)
+		__field(u64,	wakeup)
+		__field(u64,	unmap)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->uuid, uuid, 16);
+		__entry->id = id;
+		__entry->command_id = command_id;
+		__entry->prepare = ns[0];
+		__entry->notify = ns[1];
+		__entry->swd = ns[2];
+		__entry->wakeup = ns[3];
+		__entry->unmap = ns[4];
+	),
+
+	TP_printk("uuid=%s id=0x%x cmd=0x%x prepare=%llu notify=%llu swd=%llu wakeup=%llu unmap=%llu",
+		  __print_hex(__entry->uuid, 16), __entry->id,
+		  __entry->command_id, __entry->prepare, __entry->notify,
+		  __entry->swd, __entry->wakeup, __entry->unmap)
+);
+
+/* Time spent in one SMC into the SWd, in ns */
+TRACE_EVENT(mobicore_swd_run,
+
+	TP_PROTO(bool nsiq, u64 ns),
+
+	TP_ARGS(nsiq, ns),
+
+	TP_STRUCT__entry(
+		__field(bool,	nsiq)
+		__field(u64,	ns)
+	),
+
+	TP_fast_assign(
+		__entry->nsiq = nsiq;
+		__entry->ns = ns;
+	),
+
+	TP_printk("%s ns=%llu", __entry->nsiq ? "nsiq" : "yield", __entry->ns)
+);
+
+#endif /* _MC_TRACE_H_ */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE mc_trace
+#include <trace/define_trace.h>
@@ -17,7 +17,7 @@
 #define _MC_USER_H_
 
 #define MCDRVMODULEAPI_VERSION_MAJOR 7
-#define MCDRVMODULEAPI_VERSION_MINOR 0
+#define MCDRVMODULEAPI_VERSION_MINOR 1
 
 #include <linux/types.h>
 
@@ -40,6 +40,9 @@
 /* Max length for objects */
 #define OBJECT_LENGTH_MAX		0x8000000
 
+/* Max number of GP invoke commands submitted or reaped at once */
+#define MC_GP_ASYNC_BATCH_MAX		64
+
 /* Flags for buffers to map (aligned on GP) */
 #define MC_IO_MAP_INPUT			BIT(0)
 #define MC_IO_MAP_OUTPUT		BIT(1)
@@ -253,6 +256,36 @@ struct mc_ioctl_gp_invoke_command {
 	struct gp_return	ret;		/* return origin/value (out) */
 };
 
+/*
+ * GP invoke command run asynchronously, as submitted and as completed.
+ */
+struct mc_ioctl_gp_async_command {
+	__u64			user_data;	/* client cookie, kept as is */
+	struct mc_ioctl_gp_invoke_command command;
+	__s32			result;		/* invoke errno (out) */
+	__u32			reserved;
+};
+
+/*
+ * Data exchange structure of the MC_IO_GP_INVOKE_SUBMIT ioctl command.
+ */
+struct mc_ioctl_gp_invoke_submit {
+	__u64			commands;	/* mc_ioctl_gp_async_command[] */
+	__u32			nr_commands;	/* number of commands */
+	__u32			nr_submitted;	/* commands queued (out) */
+};
+
+/*
+ * Data exchange structure of the MC_IO_GP_INVOKE_REAP ioctl command.
+ */
+struct mc_ioctl_gp_invoke_reap {
+	__u64			completions;	/* mc_ioctl_gp_async_command[] */
+	__u32			nr_completions;	/* room in completions */
+	__u32			nr_reaped;	/* completions filled (out) */
+	__s32			timeout;	/* ms, -1 for ever, 0 no wait */
+	__u32			reserved;
+};
+
 /*
  * Data exchange structure of the MC_IO_GP_CANCEL ioctl command.
  */
@@ -303,5 +336,9 @@ struct mc_ioctl_gp_request_cancellation {
 	_IOWR(MC_IOC_MAGIC, 26, struct mc_ioctl_gp_invoke_command)
 #define MC_IO_GP_REQUEST_CANCELLATION \
 	_IOW(MC_IOC_MAGIC, 27, struct mc_ioctl_gp_request_cancellation)
+#define MC_IO_GP_INVOKE_SUBMIT \
+	_IOWR(MC_IOC_MAGIC, 28, struct mc_ioctl_gp_invoke_submit)
+#define MC_IO_GP_INVOKE_REAP \
+	_IOWR(MC_IOC_MAGIC, 29, struct mc_ioctl_gp_invoke_reap)
 
 #endif /* _MC_USER_H_ */
@@ -47,6 +47,7 @@
 #include "mmu.h"		/* MMU for 'blob' */
 #include "nq.h"
 #include "xen_fe.h"
+#include "latency.h"
 #include "mcp.h"
 
 /* respond timeout for MCP notification, in secs */
@@ -60,6 +61,7 @@ static struct {
 	struct completion complete;
 	bool mcp_dead;
 	struct mcp_session	mcp_session;	/* Pseudo session for MCP */
+	u64			notif_clk;	/* Time of last MCP notification */
 	/* Unexpected notification (during MCP open) */
 	struct mutex		unexp_notif_mutex;
 	struct notification	unexp_notif;
@@ -319,6 +321,9 @@ static int mcp_cmd(union mcp_message *cmd,
 	union mcp_message *msg;
 	enum cmd_id cmd_id = cmd->cmd_header.cmd_id;
 	struct command_info *cmd_info;
+	struct lat_clocks lat;
+
+	lat_start(&lat);
 
 	/* Initialize MCP log */
 	mutex_lock(&l_ctx.last_cmds_mutex);
@@ -354,10 +359,12 @@ static int mcp_cmd(union mcp_message *cmd,
 
 	/* Copy message to MCP buffer */
 	memcpy(msg, cmd, sizeof(*msg));
+	lat_end(&lat, LAT_PREPARE);
 
 	/* Send MCP notification, with cmd_id as payload for debug purpose */
 	nq_session_notify(&l_ctx.mcp_session.nq_session, l_ctx.mcp_session.sid,
 			  cmd_id);
+	lat_end(&lat, LAT_NOTIFY);
 
 	/* Update MCP log */
 	mutex_lock(&l_ctx.last_cmds_mutex);
@@ -367,6 +374,9 @@ static int mcp_cmd(union mcp_message *cmd,
 	if (ret)
 		goto out;
 
+	lat.clk[LAT_SWD + 1] = READ_ONCE(l_ctx.notif_clk);
+	lat_end(&lat, LAT_WAKEUP);
+
 	/* Check response ID */
 	if (msg->rsp_header.rsp_id != (cmd_id | FLAG_RESPONSE)) {
 		ret = -EBADE;
@@ -438,6 +448,8 @@ out:
 		return ret;
 	}
 
+	lat_record(uuid, SID_MCP, cmd_id, &lat);
+
 	if (err) {
 		if (cmd_id == MC_MCP_CMD_CLOSE_SESSION && err == -EAGAIN)
 			mc_dev_devel("%s: try again",
@@ -852,6 +864,7 @@ static void mcp_notif_handler(u32 id, u32 payload)
 	if (id == SID_MCP) {
 		/* MCP notification */
 		mc_dev_devel("notification from MCP");
+		WRITE_ONCE(l_ctx.notif_clk, local_clock());
 		complete(&l_ctx.complete);
 	} else {
 		/* Session notification */
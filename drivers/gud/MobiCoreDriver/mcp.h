@@ -16,6 +16,8 @@
 #ifndef _MC_MCP_H_
 #define _MC_MCP_H_
 
+#include <linux/kref.h>
+
 #include "mcloadformat.h"		/* struct identity */
 #include "nq.h"
 
@@ -44,6 +46,7 @@ struct mcp_open_info {
 
 /* Structure to hold the TA/driver descriptor to pass to MCP */
 struct tee_object {
+	struct kref	kref;	/* Shared by the objects cache and users */
 	u32	length;		/* Total length */
 	u32	header_length;	/* Length of header before payload */
 	u8	data[];		/* Header followed by payload */
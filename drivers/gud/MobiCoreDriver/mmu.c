@@ -22,6 +22,7 @@
 #include <linux/kthread.h>
 #include <linux/pagemap.h>
 #include <linux/device.h>
+#include <linux/spinlock.h>
 #include <linux/version.h>
 #ifdef CONFIG_DMA_SHARED_BUFFER
 #include <linux/dma-buf.h>
@@ -86,10 +87,6 @@
 #define MMU_EXT_TEX(x)		((x) << 6)	/* v5 */
 #define MMU_EXT_SHARED_32	BIT(10)		/* ARMv6 and higher */
 
-/* ION */
-/* Trustonic Specific flag to detect ION mem */
-#define MMU_ION_BUF		BIT(24)
-
 /*
  * Specific case for kernel 4.4.168 that does not have the same
  * get_user_pages() implementation
@@ -200,6 +197,99 @@ static inline long gup_local_repeat(struct mm_struct *mm, uintptr_t start,
 	return ret;
 }
 
+#if KERNEL_VERSION(5, 10, 0) <= LINUX_VERSION_CODE
+#define MMU_GUP_FAST
+static inline long gup_fast_local(uintptr_t start, unsigned long nr_pages,
+				  struct page **pages)
+{
+	return pin_user_pages_fast(start, nr_pages,
+				   FOLL_LONGTERM | FOLL_WRITE, pages);
+}
+
+static inline void gup_fast_release(struct page **pages, long nr_pages)
+{
+	unpin_user_pages(pages, nr_pages);
+}
+#elif KERNEL_VERSION(5, 4, 0) <= LINUX_VERSION_CODE
+#define MMU_GUP_FAST
+static inline long gup_fast_local(uintptr_t start, unsigned long nr_pages,
+				  struct page **pages)
+{
+	return get_user_pages_fast(start, nr_pages,
+				   FOLL_LONGTERM | FOLL_WRITE, pages);
+}
+
+static inline void gup_fast_release(struct page **pages, long nr_pages)
+{
+	release_pages(pages, nr_pages);
+}
+#endif
+
+#ifdef MMU_GUP_FAST
+/*
+ * Pin all pages of the current task's buffer read/write without taking the
+ * mmap lock. Returns -EAGAIN if the slow path must be used instead, which
+ * also deals with read-only buffers.
+ */
+static inline long gup_fast_all(uintptr_t start, unsigned long nr_pages,
+				struct page **pages)
+{
+	long ret = gup_fast_local(start, nr_pages, pages);
+
+	if (ret == nr_pages)
+		return ret;
+
+	if (ret > 0)
+		gup_fast_release(pages, ret);
+
+	return -EAGAIN;
+}
+#endif
+
+/*
+ * Pool of zeroed pages for the tables, to save the page allocator round trips
+ * when buffers are mapped and unmapped for every command.
+ */
+#define MMU_PAGES_POOL_SIZE	64
+
+static struct {
+	spinlock_t	lock;	/* Protects pages and nr_pages */
+	unsigned long	pages[MMU_PAGES_POOL_SIZE];
+	int		nr_pages;
+} pages_pool = {
+	.lock = __SPIN_LOCK_UNLOCKED(pages_pool.lock),
+};
+
+static unsigned long mmu_page_alloc(void)
+{
+	unsigned long page = 0;
+
+	spin_lock(&pages_pool.lock);
+	if (pages_pool.nr_pages)
+		page = pages_pool.pages[--pages_pool.nr_pages];
+	spin_unlock(&pages_pool.lock);
+
+	if (!page)
+		page = get_zeroed_page(GFP_KERNEL);
+
+	return page;
+}
+
+/* Only the first used bytes of the page need to be zeroed back */
+static void mmu_page_free(unsigned long page, size_t used)
+{
+	memset((void *)page, 0, min_t(size_t, used, PAGE_SIZE));
+	spin_lock(&pages_pool.lock);
+	if (pages_pool.nr_pages < MMU_PAGES_POOL_SIZE) {
+		pages_pool.pages[pages_pool.nr_pages++] = page;
+		page = 0;
+	}
+	spin_unlock(&pages_pool.lock);
+
+	if (page)
+		free_page(page);
+}
+
 /*
  * A table that could be either a pmd or pte
  */
@@ -313,12 +403,13 @@ static void tee_mmu_delete(struct tee_mmu *mmu)
 			mmu->pages_locked -= nr_pages;
 		}
 
-		free_page(pte_table->page);
+		mmu_page_free(pte_table->page, nr_pages * sizeof(u64));
 		mmu->pages_created--;
 	}
 
 	if (mmu->pmd_table.page) {
-		free_page(mmu->pmd_table.page);
+		mmu_page_free(mmu->pmd_table.page,
+			      mmu->nr_pmd_entries * sizeof(u64));
 		mmu->pages_created--;
 	}
 
@@ -374,7 +465,7 @@ static struct tee_mmu *tee_mmu_create_common(const struct mcp_buffer_map *b_map)
 		     mmu->nr_pages, mmu->nr_pmd_entries);
 
 	/* Allocate a page for the L1 table, always used for DomU */
-	mmu->pmd_table.page = get_zeroed_page(GFP_KERNEL);
+	mmu->pmd_table.page = mmu_page_alloc();
 	if (!mmu->pmd_table.page)
 		goto end;
 
@@ -475,7 +566,7 @@ struct tee_mmu *tee_mmu_create(struct mm_struct *mm,
 		}
 	}
 	/* Get a page to store page pointers */
-	pages_page = get_zeroed_page(GFP_KERNEL);
+	pages_page = mmu_page_alloc();
 	if (!pages_page) {
 		ret = -ENOMEM;
 		goto end;
@@ -494,7 +585,7 @@ struct tee_mmu *tee_mmu_create(struct mm_struct *mm,
 			nr_pages = PTE_ENTRIES_MAX;
 
 		/* Allocate a page to hold ptes that describe buffer pages */
-		mmu->pte_tables[chunk].page = get_zeroed_page(GFP_KERNEL);
+		mmu->pte_tables[chunk].page = mmu_page_alloc();
 		if (!mmu->pte_tables[chunk].page) {
 			ret = -ENOMEM;
 			goto end;
@@ -533,36 +624,46 @@ struct tee_mmu *tee_mmu_create(struct mm_struct *mm,
 			}
 			sg_miter_stop(&miter);
 		} else if (mm) {
-			long gup_ret;
+			long gup_ret = -EAGAIN;
 
+#ifdef MMU_GUP_FAST
+			/* Buffer of the current task: try lockless first */
+			if (mm == current->mm)
+				gup_ret = gup_fast_all((uintptr_t)reader,
+						       nr_pages, pages);
+#endif
 			/* Buffer was allocated in user space */
+			if (gup_ret == -EAGAIN) {
 #if KERNEL_VERSION(5, 7, 19) < LINUX_VERSION_CODE
-			down_read(&mm->mmap_lock);
+				down_read(&mm->mmap_lock);
 #else
-			down_read(&mm->mmap_sem);
+				down_read(&mm->mmap_sem);
 #endif
-			/*
-			 * Always try to map read/write from a Linux PoV, so
-			 * Linux creates (page faults) the underlying pages if
-			 * missing.
-			 */
-			gup_ret = gup_local_repeat(mm, (uintptr_t)reader,
-						   nr_pages, 1, pages);
-			if ((gup_ret == -EFAULT) && !writeable) {
 				/*
-				 * If mapping read/write fails, and the buffer
-				 * is to be shared as input only, try to map
-				 * again read-only.
+				 * Always try to map read/write from a Linux
+				 * PoV, so Linux creates (page faults) the
+				 * underlying pages if missing.
 				 */
 				gup_ret = gup_local_repeat(mm,
 							   (uintptr_t)reader,
-							   nr_pages, 0, pages);
-			}
+							   nr_pages, 1, pages);
+				if ((gup_ret == -EFAULT) && !writeable) {
+					/*
+					 * If mapping read/write fails, and the
+					 * buffer is to be shared as input only,
+					 * try to map again read-only.
+					 */
+					gup_ret = gup_local_repeat(mm,
+							(uintptr_t)reader,
+							nr_pages, 0, pages);
+				}
 #if KERNEL_VERSION(5, 7, 19) < LINUX_VERSION_CODE
-			up_read(&mm->mmap_lock);
+				up_read(&mm->mmap_lock);
 #else
-			up_read(&mm->mmap_sem);
+				up_read(&mm->mmap_sem);
 #endif
+			}
+
 			if (gup_ret < 0) {
 				ret = gup_ret;
 				mc_dev_err(ret, "failed to get user pages @%p",
@@ -624,7 +725,7 @@ struct tee_mmu *tee_mmu_create(struct mm_struct *mm,
 
 end:
 	if (pages_page) {
-		free_page(pages_page);
+		mmu_page_free(pages_page, PAGE_SIZE);
 		mmu->pages_created--;
 	}
 
@@ -665,7 +766,7 @@ struct tee_mmu *tee_mmu_wrap(struct tee_deleter *deleter, struct page **pages,
 		nr_pages_left -= nr_pages;
 
 		/* Allocate a page to hold ptes that describe buffer pages */
-		mmu->pte_tables[chunk].page = get_zeroed_page(GFP_KERNEL);
+		mmu->pte_tables[chunk].page = mmu_page_alloc();
 		if (!mmu->pte_tables[chunk].page) {
 			ret = -ENOMEM;
 			goto err;
@@ -745,6 +846,14 @@ void tee_mmu_buffer(struct tee_mmu *mmu, struct mcp_buffer_map *map)
 	map->mmu = mmu;
 }
 
+void tee_mmu_exit(void)
+{
+	spin_lock(&pages_pool.lock);
+	while (pages_pool.nr_pages)
+		free_page(pages_pool.pages[--pages_pool.nr_pages]);
+	spin_unlock(&pages_pool.lock);
+}
+
 int tee_mmu_debug_structs(struct kasnprintf_buf *buf, const struct tee_mmu *mmu)
 {
 	return kasnprintf(buf,
@@ -31,6 +31,9 @@
  */
 #define PMD_ENTRIES_MAX	512
 
+/* Trustonic Specific flag to detect ION mem */
+#define MMU_ION_BUF		BIT(24)
+
 struct tee_mmu;
 struct mcp_buffer_map;
 
@@ -73,6 +76,11 @@ void tee_mmu_put(struct tee_mmu *mmu);
  */
 void tee_mmu_buffer(struct tee_mmu *mmu, struct mcp_buffer_map *map);
 
+/*
+ * Release the pages kept for re-use by the MMU tables.
+ */
+void tee_mmu_exit(void);
+
 /*
  * Add info to debug buffer.
  */
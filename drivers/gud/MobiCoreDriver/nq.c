@@ -44,6 +44,7 @@
 #include "main.h"
 #include "clock.h"
 #include "fastcall.h"
+#include "latency.h"
 #include "logging.h"
 #include "nq.h"
 
@@ -103,13 +104,13 @@ static struct {
 	struct completion	idle_complete;	/* Unblock scheduler thread */
 	struct completion	sleep_complete;	/* Wait for sleep status */
 	struct mutex		sleep_mutex;	/* Protect sleep request */
+	/*
+	 * Pending request, an enum sched_command only ever raised by callers
+	 * and consumed by the scheduler, so notifiers never block on each
+	 * other nor on the scheduler.
+	 */
+	atomic_t		request;
 	struct mutex		request_mutex;	/* Protect all below */
-	/* The order of this enum matters */
-	enum sched_command {
-		NONE,		/* No specific request */
-		YIELD,		/* Run the SWd */
-		NSIQ,		/* Schedule the SWd */
-	}			request;
 	bool			suspended;
 
 	/* Logging */
@@ -120,6 +121,13 @@ static struct {
 	struct mutex cpumask_mutex; /* protect cpumask access */
 } l_ctx;
 
+/* The order of this enum matters */
+enum sched_command {
+	NONE,		/* No specific request */
+	YIELD,		/* Run the SWd */
+	NSIQ,		/* Schedule the SWd */
+};
+
 static inline bool is_iwp_id(u32 id)
 {
 	return (id & SID_IWP_NOTIFICATION) != 0;
@@ -201,16 +209,24 @@ static inline bool nq_notifications_flush(void)
 
 static int nq_scheduler_command(enum sched_command command)
 {
+	int request;
+
 	if (IS_ERR_OR_NULL(l_ctx.tee_scheduler_thread))
 		return -EFAULT;
 
-	mutex_lock(&l_ctx.request_mutex);
-	if (l_ctx.request < command) {
-		l_ctx.request = command;
-		complete(&l_ctx.idle_complete);
+	/* Only wake the scheduler up if the request was raised */
+	request = atomic_read(&l_ctx.request);
+	while (request < command) {
+		int old = atomic_cmpxchg(&l_ctx.request, request, command);
+
+		if (old == request) {
+			complete(&l_ctx.idle_complete);
+			break;
+		}
+
+		request = old;
 	}
 
-	mutex_unlock(&l_ctx.request_mutex);
 	return 0;
 }
 
@@ -298,6 +314,14 @@ static irqreturn_t irq_handler(int intr, void *arg)
 	return IRQ_HANDLED;
 }
 
+#ifdef MC_SWD_SIMULATOR
+/* The simulated SWd has no interrupt line, it raises its S-SIQ directly */
+void nq_simulator_ssiq(void)
+{
+	irq_handler(0, NULL);
+}
+#endif
+
 void nq_session_init(struct nq_session *session, bool is_gp)
 {
 	session->id = SID_INVALID;
@@ -779,10 +803,15 @@ static inline bool tee_sleep(s32 timeout_ms)
 /*
  * This thread, and only this thread, schedules the SWd. Hence, reading the idle
  * status and its associated timeout is safe from race conditions.
+ *
+ * There is no per-CPU or multi-worker mode: MCI has a single notification
+ * queue pair and a single mcp_flags area, and the TEE advertises no support
+ * for yields from several NWd threads at once.
  */
 static int tee_scheduler(void *arg)
 {
 	bool swd_notify = false;
+	u64 swd_clk;
 	int ret = 0;
 
 	/* Enable TEE clock */
@@ -839,8 +868,7 @@ static int tee_scheduler(void *arg)
 			break;
 
 		/* Get requested command if any */
-		mutex_lock(&l_ctx.request_mutex);
-		switch (l_ctx.request) {
+		switch (atomic_xchg(&l_ctx.request, NONE)) {
 		case NONE:
 			break;
 		case YIELD:
@@ -851,15 +879,14 @@ static int tee_scheduler(void *arg)
 			break;
 		}
 
-		l_ctx.request = NONE;
 		nq_update_time();
-		mutex_unlock(&l_ctx.request_mutex);
 
 		/* Reset timeout so we don't loop if SWd halted */
 		mutex_lock(&l_ctx.buffer_mutex);
 		l_ctx.mcp_buffer->flags.timeout_ms = -1;
 		mutex_unlock(&l_ctx.buffer_mutex);
 
+		swd_clk = local_clock();
 		if (swd_notify) {
 			u32 session_id = 0;
 			u32 payload = 0;
@@ -869,9 +896,11 @@ static int tee_scheduler(void *arg)
 
 			/* Call SWd scheduler */
 			fc_nsiq(session_id, payload);
+			lat_swd_run(true, local_clock() - swd_clk);
 		} else {
 			/* Resume SWd from where it was */
 			fc_yield(0);
+			lat_swd_run(false, local_clock() - swd_clk);
 		}
 
 		/* Always flush log buffer after the SWd has run */
@@ -950,6 +979,7 @@ int nq_resume(void)
 int nq_start(void)
 {
 	int ret;
+#ifndef MC_SWD_SIMULATOR
 	/* Make sure we have the interrupt before going on */
 #if defined(CONFIG_OF)
 	l_ctx.irq = irq_of_parse_and_map(g_ctx.mcd->of_node, 0);
@@ -969,6 +999,7 @@ int nq_start(void)
 			  "trustonic", NULL);
 	if (ret)
 		return ret;
+#endif
 
 	/*
 	 * Initialize the time structure for SWd
@@ -1019,7 +1050,9 @@ void nq_stop(void)
 	l_ctx.irq_bh_thread_run = false;
 	complete(&l_ctx.irq_bh_complete);
 	kthread_stop(l_ctx.irq_bh_thread);
+#ifndef MC_SWD_SIMULATOR
 	free_irq(l_ctx.irq, NULL);
+#endif
 }
 
 void add_core_to_mask(unsigned int cpu_id)
@@ -1147,6 +1180,7 @@ int nq_init(void)
 	/* Scheduler */
 	init_completion(&l_ctx.boot_complete);
 	init_completion(&l_ctx.idle_complete);
+	atomic_set(&l_ctx.request, NONE);
 	mutex_init(&l_ctx.request_mutex);
 	mutex_init(&l_ctx.cpumask_mutex);
 	mutex_lock(&l_ctx.cpumask_mutex);
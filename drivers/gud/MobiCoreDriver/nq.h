@@ -67,6 +67,9 @@ int nq_register_tee_stop_notifier(struct notifier_block *nb);
 int nq_unregister_tee_stop_notifier(struct notifier_block *nb);
 ssize_t nq_get_stop_message(char __user *buffer, size_t size);
 void nq_signal_tee_hung(void);
+#ifdef MC_SWD_SIMULATOR
+void nq_simulator_ssiq(void);
+#endif
 
 /* SWd suspend/resume */
 void add_core_to_mask(unsigned int cpu);
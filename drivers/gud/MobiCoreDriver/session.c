@@ -25,6 +25,8 @@
 #include <linux/scatterlist.h>
 #include <linux/file.h>
 #include <linux/fs.h>
+#include <linux/fs_struct.h>
+#include <linux/dcache.h>
 #include <linux/net.h>
 #include <net/sock.h>		/* sockfd_lookup */
 #include <linux/version.h>
@@ -75,6 +77,7 @@ static inline bool gid_lt(kgid_t left, kgid_t right)
 #include "client.h"		/* *cbuf* */
 #include "session.h"
 #include "mcimcp.h"		/* WSM_INVALID */
+#include "mciiwp.h"		/* SID_INVOKE_COMMAND */
 
 #define SHA1_HASH_SIZE       20
 
@@ -150,13 +153,147 @@ static void wsm_free(struct tee_session *session, struct tee_wsm *wsm)
 }
 
 #if KERNEL_VERSION(4, 6, 0) <= LINUX_VERSION_CODE
-static int hash_path_and_data(struct task_struct *task, u8 *hash,
-			      const void *data, unsigned int data_len)
+/* Number of executables for which the path hash state is kept */
+#define IDENTITY_CACHE_SIZE	8
+
+/*
+ * The cache holds no references, so nothing in the key is a pointer that could
+ * be freed and re-used for another object. An executable is identified by its
+ * device, inode number and generation; a rename or new hard link of the file
+ * changes its ctime, a rewrite its mtime. The root it is resolved from
+ * (chroot) is identified the same way.
+ */
+struct identity_key {
+	dev_t				dev;
+	unsigned long			ino;
+	u32				generation;
+	s64				mtime_sec;
+	long				mtime_nsec;
+	s64				ctime_sec;
+	long				ctime_nsec;
+	dev_t				root_dev;
+	unsigned long			root_ino;
+	u32				root_generation;
+};
+
+/* SHA1 state after hashing the path of an executable */
+struct identity_entry {
+	/* Executable file identification */
+	struct identity_key		key;
+	/* Exported hash state, valid if in_use */
+	void				*state;
+	bool				in_use;
+	/* Last use, to find the entry to replace */
+	u64				last_used;
+};
+
+static struct {
+	struct mutex		lock;	/* Protects all of the below */
+	struct crypto_shash	*tfm;
+	struct shash_desc	*desc;
+	struct identity_entry	entries[IDENTITY_CACHE_SIZE];
+	u64			uses;
+} identity_ctx;
+
+/* Must be called with identity_ctx.lock held */
+static int identity_tfm_alloc(void)
 {
-	struct file *exe_file;
 	struct crypto_shash *tfm;
 	struct shash_desc *desc;
-	size_t desc_size;
+	unsigned int state_size;
+	int i;
+
+	tfm = crypto_alloc_shash("sha1", 0, 0);
+	if (IS_ERR(tfm)) {
+		mc_dev_err((int)PTR_ERR(tfm), "cannot allocate shash");
+		return PTR_ERR(tfm);
+	}
+
+	desc = kzalloc(crypto_shash_descsize(tfm) + sizeof(*desc), GFP_KERNEL);
+	if (!desc)
+		goto err;
+
+	state_size = crypto_shash_statesize(tfm);
+	for (i = 0; i < IDENTITY_CACHE_SIZE; i++) {
+		identity_ctx.entries[i].state = kzalloc(state_size, GFP_KERNEL);
+		if (!identity_ctx.entries[i].state)
+			goto err_state;
+	}
+
+	desc->tfm = tfm;
+	identity_ctx.tfm = tfm;
+	identity_ctx.desc = desc;
+	return 0;
+
+err_state:
+	for (i = 0; i < IDENTITY_CACHE_SIZE; i++) {
+		kfree(identity_ctx.entries[i].state);
+		identity_ctx.entries[i].state = NULL;
+	}
+
+	kfree(desc);
+err:
+	crypto_free_shash(tfm);
+	return -ENOMEM;
+}
+
+static void identity_key_init(struct identity_key *key,
+			      const struct file *exe_file,
+			      const struct path *root)
+{
+	const struct inode *inode = file_inode(exe_file);
+	const struct inode *root_inode = d_inode(root->dentry);
+
+	memset(key, 0, sizeof(*key));
+	key->dev = inode->i_sb->s_dev;
+	key->ino = inode->i_ino;
+	key->generation = inode->i_generation;
+	key->mtime_sec = inode->i_mtime.tv_sec;
+	key->mtime_nsec = inode->i_mtime.tv_nsec;
+	key->ctime_sec = inode->i_ctime.tv_sec;
+	key->ctime_nsec = inode->i_ctime.tv_nsec;
+	key->root_dev = root_inode->i_sb->s_dev;
+	key->root_ino = root_inode->i_ino;
+	key->root_generation = root_inode->i_generation;
+}
+
+/* Must be called with identity_ctx.lock held */
+static struct identity_entry *
+identity_entry_find(const struct identity_key *key)
+{
+	int i;
+
+	for (i = 0; i < IDENTITY_CACHE_SIZE; i++) {
+		struct identity_entry *entry = &identity_ctx.entries[i];
+
+		if (entry->in_use &&
+		    !memcmp(&entry->key, key, sizeof(*key))) {
+			entry->last_used = ++identity_ctx.uses;
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+/* Must be called with identity_ctx.lock held, replaces the oldest entry */
+static struct identity_entry *identity_entry_new(const struct identity_key *key)
+{
+	struct identity_entry *entry = &identity_ctx.entries[0];
+	int i;
+
+	for (i = 1; i < IDENTITY_CACHE_SIZE; i++)
+		if (identity_ctx.entries[i].last_used < entry->last_used)
+			entry = &identity_ctx.entries[i];
+
+	memcpy(&entry->key, key, sizeof(*key));
+	entry->last_used = ++identity_ctx.uses;
+	return entry;
+}
+
+/* Must be called with identity_ctx.lock held */
+static int hash_path(struct file *exe_file, struct shash_desc *desc)
+{
 	char *buf;
 	char *path;
 	unsigned int path_len;
@@ -166,12 +303,6 @@ static int hash_path_and_data(struct task_struct *task, u8 *hash,
 	if (!buf)
 		return -ENOMEM;
 
-	exe_file = get_task_exe_file(task);
-	if (!exe_file) {
-		ret = -ENOENT;
-		goto end;
-	}
-
 	path = d_path(&exe_file->f_path, buf, PAGE_SIZE);
 	if (IS_ERR(path)) {
 		ret = PTR_ERR(path);
@@ -189,38 +320,91 @@ static int hash_path_and_data(struct task_struct *task, u8 *hash,
 	path_len = (unsigned int)strnlen(path, PAGE_SIZE);
 	mc_dev_devel("path_len = %u", path_len);
 	/* Compute hash of path */
-	tfm = crypto_alloc_shash("sha1", 0, 0);
-	if (IS_ERR(tfm)) {
-		ret = PTR_ERR(tfm);
-		mc_dev_err(ret, "cannot allocate shash");
-		goto end;
+	crypto_shash_init(desc);
+	crypto_shash_update(desc, (u8 *)path, path_len);
+end:
+	free_page((unsigned long)buf);
+	return ret;
+}
+
+/*
+ * The hash state after the path only depends on the executable, so it is kept
+ * and re-used for the next sessions opened by the same program.
+ */
+static int hash_path_and_data(struct task_struct *task, u8 *hash,
+			      const void *data, unsigned int data_len)
+{
+	struct file *exe_file;
+	struct identity_key key;
+	struct identity_entry *entry;
+	struct shash_desc *desc;
+	struct path root;
+	int ret = 0;
+
+	exe_file = get_task_exe_file(task);
+	if (!exe_file)
+		return -ENOENT;
+
+	/* d_path() resolves from the root of the current task */
+	get_fs_root(current->fs, &root);
+	identity_key_init(&key, exe_file, &root);
+	path_put(&root);
+	mutex_lock(&identity_ctx.lock);
+	if (!identity_ctx.desc) {
+		ret = identity_tfm_alloc();
+		if (ret)
+			goto end;
 	}
 
-	desc_size = crypto_shash_descsize(tfm) + sizeof(*desc);
-	desc = kzalloc(desc_size, GFP_KERNEL);
-	if (!desc) {
-		ret = -ENOMEM;
-		goto err_desc;
+	desc = identity_ctx.desc;
+	entry = identity_entry_find(&key);
+	if (entry) {
+		mc_dev_devel("path hash found in cache");
+		ret = crypto_shash_import(desc, entry->state);
+	} else {
+		ret = hash_path(exe_file, desc);
+		if (!ret) {
+			entry = identity_entry_new(&key);
+			ret = crypto_shash_export(desc, entry->state);
+			entry->in_use = !ret;
+		}
 	}
 
-	desc->tfm = tfm;
-	crypto_shash_init(desc);
-	crypto_shash_update(desc, (u8 *)path, path_len);
+	if (ret)
+		goto end;
+
 	if (data) {
 		mc_dev_devel("hashing additional data");
 		crypto_shash_update(desc, data, data_len);
 	}
 
 	crypto_shash_final(desc, hash);
-	shash_desc_zero(desc);
-	kfree(desc);
-err_desc:
-	crypto_free_shash(tfm);
 end:
-	free_page((unsigned long)buf);
-
+	mutex_unlock(&identity_ctx.lock);
+	fput(exe_file);
 	return ret;
 }
+
+void session_init(void)
+{
+	mutex_init(&identity_ctx.lock);
+}
+
+void session_exit(void)
+{
+	int i;
+
+	if (!identity_ctx.desc)
+		return;
+
+	for (i = 0; i < IDENTITY_CACHE_SIZE; i++)
+		kfree(identity_ctx.entries[i].state);
+
+	shash_desc_zero(identity_ctx.desc);
+	kfree(identity_ctx.desc);
+	crypto_free_shash(identity_ctx.tfm);
+	identity_ctx.desc = NULL;
+}
 #else
 static int hash_path_and_data(struct task_struct *task, u8 *hash,
 			      const void *data, unsigned int data_len)
@@ -285,6 +469,14 @@ end:
 
 	return ret;
 }
+
+void session_init(void)
+{
+}
+
+void session_exit(void)
+{
+}
 #endif
 
 #if KERNEL_VERSION(4, 9, 0) <= LINUX_VERSION_CODE
@@ -455,6 +647,7 @@ struct tee_session *session_create(struct tee_client *client,
 	if (identity) {
 		session->is_gp = true;
 		iwp_session_init(&session->iwp_session, &mcp_identity);
+		session->iwp_session.owner = client_id(client);
 	} else {
 		session->is_gp = false;
 		mcp_session_init(&session->mcp_session);
@@ -610,7 +803,16 @@ int session_close(struct tee_session *session)
 	int ret;
 
 	if (session->is_gp) {
+		struct lat_clocks lat;
+
+		/* A parked session is only accounted in the last phase */
+		lat_start(&lat);
+		session->iwp_session.lat = &lat;
 		ret = iwp_close_session(&session->iwp_session);
+		session->iwp_session.lat = NULL;
+		lat_end(&lat, LAT_UNMAP);
+		lat_record(&session->iwp_session.uuid, SID_CLOSE_SESSION, 0,
+			   &lat);
 		if (!ret)
 			mc_dev_devel("closed GP session %x",
 				     session->iwp_session.sid);
@@ -827,8 +1029,18 @@ int session_gp_open_session(struct tee_session *session,
 	struct iwp_buffer_map maps[MC_MAP_MAX];
 	struct gp_shared_memory *parents[MC_MAP_MAX] = { NULL };
 	struct client_gp_operation client_operation;
+	struct lat_clocks lat;
 	int ret = 0;
 
+	lat_start(&lat);
+	/* Take over a session parked for the same TA and login, if any */
+	if (!iwp_open_session_pooled(&session->iwp_session, uuid, operation,
+				     gp_ret)) {
+		lat_end(&lat, LAT_PREPARE);
+		lat_record(uuid, SID_OPEN_SESSION, 0, &lat);
+		return 0;
+	}
+
 	ret = iwp_open_session_prepare(&session->iwp_session, operation, bufs,
 				       parents, gp_ret);
 	if (ret)
@@ -850,12 +1062,17 @@ int session_gp_open_session(struct tee_session *session,
 		return iwp_set_ret(-ECANCELED, gp_ret);
 	}
 
-	/* Open/call TA */
+	/* Open/call TA, the session is not visible to others yet */
+	lat_end(&lat, LAT_PREPARE);
+	session->iwp_session.lat = &lat;
 	ret = iwp_open_session(&session->iwp_session, uuid, operation, maps,
 			       NULL, NULL, gp_ret);
+	session->iwp_session.lat = NULL;
 	/* Cleanup */
 	client_gp_operation_remove(session->client, &client_operation);
 	unmap_gp_bufs(session, maps);
+	lat_end(&lat, LAT_UNMAP);
+	lat_record(uuid, SID_OPEN_SESSION, 0, &lat);
 	return ret;
 }
 
@@ -900,8 +1117,10 @@ int session_gp_invoke_command(struct tee_session *session, u32 command_id,
 	struct iwp_buffer_map maps[MC_MAP_MAX];
 	struct gp_shared_memory *parents[MC_MAP_MAX] = { NULL };
 	struct client_gp_operation client_operation;
+	struct lat_clocks lat;
 	int ret = 0;
 
+	lat_start(&lat);
 	ret = iwp_invoke_command_prepare(&session->iwp_session, command_id,
 					 operation, bufs, parents, gp_ret);
 	if (ret)
@@ -923,12 +1142,17 @@ int session_gp_invoke_command(struct tee_session *session, u32 command_id,
 		return iwp_set_ret(-ECANCELED, gp_ret);
 	}
 
-	/* Call TA */
+	/* Call TA, iws_lock is held until it returns */
+	lat_end(&lat, LAT_PREPARE);
+	session->iwp_session.lat = &lat;
 	ret = iwp_invoke_command(&session->iwp_session, operation, maps, NULL,
 				 NULL, gp_ret);
 	/* Cleanup */
 	client_gp_operation_remove(session->client, &client_operation);
 	unmap_gp_bufs(session, maps);
+	lat_end(&lat, LAT_UNMAP);
+	lat_record(&session->iwp_session.uuid, SID_INVOKE_COMMAND, command_id,
+		   &lat);
 	return ret;
 }
 
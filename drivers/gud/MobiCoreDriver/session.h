@@ -68,6 +68,9 @@ struct tee_session {
 	int			is_gp;
 };
 
+void session_init(void);
+void session_exit(void);
+
 struct tee_session *session_create(struct tee_client *client,
 				   const struct mc_identity *identity);
 static inline void session_get(struct tee_session *session)
@@ -0,0 +1,464 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (c) 2026 Motorola Mobility, LLC.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Simulated SWd, replacing the fastcalls when built with MC_SWD_SIMULATOR.
+ *
+ * The SWd only runs from the N-SIQ and yield fastcalls, i.e. in the TEE
+ * scheduler thread, as it would on a real device. Each run consumes the NWd
+ * notification queue, answers MCP commands and IWP operations for the built-in
+ * TAs, then raises an S-SIQ if it sent notifications back.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/delay.h>
+#include <linux/device.h>
+#include <linux/io.h>		/* phys_to_virt */
+#include <linux/string.h>
+
+#include "tee_client_api.h"	/* GP error codes/origins */
+#include "mc_user.h"
+#include "mcimcp.h"
+#include "mcifc.h"
+#include "mcinq.h"
+#include "mciiwp.h"
+
+#include "main.h"
+#include "fastcall.h"
+#include "nq.h"
+#include "simulator.h"
+
+#define _TEEC_GET_PARAM_TYPE(t, i) (((t) >> (4 * (i))) & 0xF)
+#define _TEEC_PARAMETER_NUMBER	4
+
+/* Sessions of the simulated SWd, index + 1 is the session handle/ID */
+#define SIM_SESSIONS_MAX	MAX_IW_SESSION
+/* First SWd address given to mapped buffers */
+#define SIM_SVA_BASE		0x100000
+
+enum sim_ta {
+	SIM_TA_NONE,
+	SIM_TA_ECHO,
+	SIM_TA_COMPUTE,
+	/* Legacy TA opened through MCP, echoes notifications */
+	SIM_TA_MC,
+};
+
+static const struct {
+	struct teec_uuid	uuid;
+	enum sim_ta		ta;
+} sim_tas[] = {
+	{ SIM_TA_ECHO_UUID, SIM_TA_ECHO },
+	{ SIM_TA_COMPUTE_UUID, SIM_TA_COMPUTE },
+};
+
+static struct {
+	/* MCI buffers, as given by fc_init */
+	struct notification_queue	*nq_in;
+	struct notification_queue	*nq_out;
+	struct mcp_buffer		*mcp_buffer;
+	struct interworld_session	*iws;
+	u32				status;
+	/* TA of each session */
+	u8				sessions[SIM_SESSIONS_MAX];
+	u32				next_sva;
+	/* Fixed SWd run time added to each command, in us */
+	u32				run_time_us;
+	/* Statistics */
+	u32				nr_nsiqs;
+	u32				nr_yields;
+	u32				nr_notifs;
+} l_ctx;
+
+static inline void sim_run_time(u32 us)
+{
+	if (!us)
+		return;
+
+	if (us < 10)
+		udelay(us);
+	else
+		usleep_range(us, us + us / 8);
+}
+
+static u32 sim_session_open(enum sim_ta ta)
+{
+	u32 i;
+
+	for (i = 0; i < SIM_SESSIONS_MAX; i++)
+		if (l_ctx.sessions[i] == SIM_TA_NONE) {
+			l_ctx.sessions[i] = ta;
+			return i + 1;
+		}
+
+	return 0;
+}
+
+static enum sim_ta sim_session_ta(u32 session_id)
+{
+	if (!session_id || session_id > SIM_SESSIONS_MAX)
+		return SIM_TA_NONE;
+
+	return l_ctx.sessions[session_id - 1];
+}
+
+static void sim_session_close(u32 session_id)
+{
+	if (session_id && session_id <= SIM_SESSIONS_MAX)
+		l_ctx.sessions[session_id - 1] = SIM_TA_NONE;
+}
+
+static inline bool sim_notify_full(void)
+{
+	struct notification_queue_header *hdr = &l_ctx.nq_out->hdr;
+
+	return (hdr->write_cnt - hdr->read_cnt) == hdr->queue_size;
+}
+
+static void sim_notify(u32 session_id, s32 payload)
+{
+	struct notification_queue_header *hdr = &l_ctx.nq_out->hdr;
+	u32 i = hdr->write_cnt % hdr->queue_size;
+
+	l_ctx.nq_out->notification[i].session_id = session_id;
+	l_ctx.nq_out->notification[i].payload = payload;
+	/* Ensure notification[] is written before we update the counter */
+	smp_mb();
+	hdr->write_cnt++;
+	l_ctx.nr_notifs++;
+}
+
+static void sim_mcp_command(void)
+{
+	union mcp_message *msg = &l_ctx.mcp_buffer->message;
+	enum cmd_id cmd_id = msg->cmd_header.cmd_id;
+	enum mcp_result result = MC_MCP_RET_OK;
+
+	switch (cmd_id) {
+	case MC_MCP_CMD_GET_MOBICORE_VERSION: {
+		struct mc_version_info *info =
+			&msg->rsp_get_version.version_info;
+
+		memset(info, 0, sizeof(*info));
+		strscpy(info->product_id, "t-base-SIMULATOR",
+			sizeof(info->product_id));
+		info->version_mci = MC_VERSION(1, 7);
+		break;
+	}
+	case MC_MCP_CMD_OPEN_SESSION: {
+		u32 session_id = sim_session_open(SIM_TA_MC);
+
+		if (!session_id)
+			result = MC_MCP_RET_ERR_NO_MORE_SESSIONS;
+
+		msg->rsp_open.session_id = session_id;
+		break;
+	}
+	case MC_MCP_CMD_CLOSE_SESSION:
+		if (sim_session_ta(msg->cmd_close.session_id) != SIM_TA_MC)
+			result = MC_MCP_RET_ERR_INVALID_SESSION;
+		else
+			sim_session_close(msg->cmd_close.session_id);
+
+		break;
+	case MC_MCP_CMD_MAP: {
+		u32 ofs = msg->cmd_map.ofs_buffer;
+
+		if (msg->cmd_map.len_buffer > MCP_MAP_MAX) {
+			result = MC_MCP_RET_ERR_INVALID_MAPPING_LENGTH;
+			break;
+		}
+
+		/* Every buffer gets its own MCP_MAP_MAX window */
+		msg->rsp_map.secure_va = SIM_SVA_BASE +
+			(l_ctx.next_sva++ % 0x1000) * MCP_MAP_MAX + ofs;
+		break;
+	}
+	case MC_MCP_CMD_SUSPEND:
+		l_ctx.mcp_buffer->flags.sleep_mode.ready_to_sleep =
+			MC_STATE_READY_TO_SLEEP;
+		break;
+	case MC_MCP_CMD_RESUME:
+		l_ctx.mcp_buffer->flags.sleep_mode.ready_to_sleep =
+			MC_STATE_NORMAL_EXECUTION;
+		break;
+	case MC_MCP_CMD_UNMAP:
+	case MC_MCP_CMD_CLOSE_MCP:
+	case MC_MCP_CMD_LOAD_TOKEN:
+	case MC_MCP_CMD_CHECK_LOAD_TA:
+	case MC_MCP_CMD_LOAD_SYSENC_KEY_SO:
+		break;
+	default:
+		result = MC_MCP_RET_ERR_UNKNOWN_COMMAND;
+	}
+
+	msg->rsp_header.rsp_id = cmd_id | FLAG_RESPONSE;
+	msg->rsp_header.result = result;
+	sim_notify(SID_MCP, 0);
+}
+
+static void sim_ta_invoke(enum sim_ta ta, struct interworld_session *iws)
+{
+	union interworld_parameter *params = iws->params;
+	int i;
+
+	iws->status = TEEC_SUCCESS;
+	iws->return_origin = TEEC_ORIGIN_TRUSTED_APP;
+	sim_run_time(l_ctx.run_time_us);
+
+	if (ta == SIM_TA_ECHO) {
+		for (i = 0; i < _TEEC_PARAMETER_NUMBER; i++) {
+			switch (_TEEC_GET_PARAM_TYPE(iws->param_types, i)) {
+			case TEEC_VALUE_OUTPUT:
+			case TEEC_VALUE_INOUT:
+				params[i].value.b = params[i].value.a;
+				break;
+			}
+		}
+
+		return;
+	}
+
+	switch (iws->command_id) {
+	case SIM_CMD_ECHO:
+		break;
+	case SIM_CMD_ADD:
+		params[1].value.a = params[0].value.a + params[0].value.b;
+		break;
+	case SIM_CMD_SPIN:
+		sim_run_time(params[0].value.a);
+		break;
+	default:
+		iws->status = TEEC_ERROR_NOT_SUPPORTED;
+	}
+}
+
+static void sim_iwp_command(u32 id, u32 slot)
+{
+	struct interworld_session *iws;
+
+	iws = (void *)((uintptr_t)l_ctx.iws + slot);
+	switch (id) {
+	case SID_OPEN_SESSION:
+	case SID_OPEN_TA: {
+		/* The operation is in the slot given in command_id */
+		struct interworld_session *op_iws =
+			(void *)((uintptr_t)l_ctx.iws + iws->command_id);
+		enum sim_ta ta = SIM_TA_NONE;
+		size_t i;
+
+		for (i = 0; i < ARRAY_SIZE(sim_tas); i++)
+			if (!memcmp(&op_iws->target_uuid, &sim_tas[i].uuid,
+				    sizeof(op_iws->target_uuid)))
+				ta = sim_tas[i].ta;
+
+		iws->return_origin = TEEC_ORIGIN_TEE;
+		if (ta == SIM_TA_NONE) {
+			iws->status = TEEC_ERROR_ITEM_NOT_FOUND;
+			break;
+		}
+
+		iws->session_handle = sim_session_open(ta);
+		if (!iws->session_handle) {
+			iws->status = TEEC_ERROR_OUT_OF_MEMORY;
+			break;
+		}
+
+		/* Operation is returned in the main slot */
+		iws->param_types = op_iws->param_types;
+		memcpy(iws->params, op_iws->params, sizeof(iws->params));
+		iws->status = TEEC_SUCCESS;
+		iws->return_origin = TEEC_ORIGIN_TRUSTED_APP;
+		break;
+	}
+	case SID_INVOKE_COMMAND: {
+		enum sim_ta ta = sim_session_ta(iws->session_handle);
+
+		if (ta == SIM_TA_ECHO || ta == SIM_TA_COMPUTE) {
+			sim_ta_invoke(ta, iws);
+		} else {
+			iws->status = TEEC_ERROR_BAD_PARAMETERS;
+			iws->return_origin = TEEC_ORIGIN_TEE;
+		}
+
+		break;
+	}
+	case SID_CLOSE_SESSION:
+		sim_session_close(iws->session_handle);
+		iws->status = TEEC_SUCCESS;
+		break;
+	default:
+		/* Nothing to cancel, operations complete within one SWd run */
+		break;
+	}
+
+	sim_notify(id, slot);
+}
+
+/*
+ * Run the simulated SWd: consume all notifications, as long as there is room
+ * for the answers.
+ */
+static void sim_run(void)
+{
+	struct notification_queue_header *hdr = &l_ctx.nq_in->hdr;
+	bool notified = false;
+
+	while (hdr->write_cnt != hdr->read_cnt && !sim_notify_full()) {
+		struct notification nf;
+
+		nf = l_ctx.nq_in->notification[hdr->read_cnt %
+					       hdr->queue_size];
+		smp_mb();
+		hdr->read_cnt++;
+		notified = true;
+
+		if (nf.session_id == SID_MCP)
+			sim_mcp_command();
+		else if (nf.session_id & SID_IWP_NOTIFICATION)
+			sim_iwp_command(nf.session_id, nf.payload);
+		else if (sim_session_ta(nf.session_id) == SIM_TA_MC)
+			/* Legacy TA: answer straight away */
+			sim_notify(nf.session_id, 0);
+		else
+			sim_notify(nf.session_id, ERR_INVALID_SID);
+	}
+
+	/* Nothing left to do until next notification */
+	l_ctx.mcp_buffer->flags.schedule = MC_FLAG_SCHEDULE_IDLE;
+	l_ctx.mcp_buffer->flags.timeout_ms = -1;
+
+	/* S-SIQ */
+	if (notified)
+		nq_simulator_ssiq();
+}
+
+int fc_init(uintptr_t addr, ptrdiff_t off, size_t q_len, size_t buf_len)
+{
+	void *mci = phys_to_virt(addr);
+
+	if (l_ctx.status != MC_STATUS_NOT_INITIALIZED)
+		return -EBUSY;
+
+	l_ctx.nq_in = mci;
+	l_ctx.nq_out = mci + sizeof(struct notification_queue_header) +
+		l_ctx.nq_in->hdr.queue_size * sizeof(struct notification);
+	l_ctx.mcp_buffer = mci + off;
+	mc_dev_info("simulated SWd, MCI at %p", mci);
+	return 0;
+}
+
+int fc_info(u32 ext_info_id, u32 *state, u32 *ext_info)
+{
+	if (state)
+		*state = l_ctx.status;
+
+	if (ext_info) {
+		if (ext_info_id == MC_EXT_INFO_ID_MCI_VERSION)
+			*ext_info = MC_VERSION(1, 7);
+		else
+			*ext_info = 0;
+	}
+
+	return 0;
+}
+
+int fc_trace_init(phys_addr_t buffer, u32 size)
+{
+	/* The simulated SWd does not log */
+	return 0;
+}
+
+int fc_trace_deinit(void)
+{
+	return fc_trace_init(0, 0);
+}
+
+int fc_nsiq(u32 session_id, u32 payload)
+{
+	l_ctx.nr_nsiqs++;
+	if (!l_ctx.mcp_buffer)
+		return -EINVAL;
+
+	/* First N-SIQ: MCI set up */
+	if (l_ctx.status == MC_STATUS_NOT_INITIALIZED) {
+		struct init_values *iv = &l_ctx.mcp_buffer->message.init_values;
+
+		if (!(iv->flags & MC_IV_FLAG_IWP)) {
+			l_ctx.status = MC_STATUS_BAD_INIT;
+			return 0;
+		}
+
+		l_ctx.iws = (void *)((uintptr_t)l_ctx.nq_in + iv->iws_buf_ofs);
+		l_ctx.status = MC_STATUS_INITIALIZED;
+		l_ctx.mcp_buffer->flags.timeout_ms = -1;
+		return 0;
+	}
+
+	sim_run();
+	return 0;
+}
+
+int fc_yield(u32 timeslice)
+{
+	l_ctx.nr_yields++;
+	if (l_ctx.status == MC_STATUS_INITIALIZED)
+		sim_run();
+
+	return 0;
+}
+
+int mc_fastcall_debug_smclog(struct kasnprintf_buf *buf)
+{
+	return kasnprintf(buf, "simulated SWd: %u N-SIQs %u yields %u notifs\n",
+			  l_ctx.nr_nsiqs, l_ctx.nr_yields, l_ctx.nr_notifs);
+}
+
+static ssize_t debug_bench_read(struct file *file, char __user *user_buf,
+				size_t count, loff_t *ppos)
+{
+	return debug_generic_read(file, user_buf, count, ppos,
+				  simulator_bench);
+}
+
+static const struct file_operations debug_bench_ops = {
+	.read = debug_bench_read,
+	.llseek = default_llseek,
+	.open = debug_generic_open,
+	.release = debug_generic_release,
+};
+
+static ssize_t debug_bench_mt_read(struct file *file, char __user *user_buf,
+				   size_t count, loff_t *ppos)
+{
+	return debug_generic_read(file, user_buf, count, ppos,
+				  simulator_bench_concurrent);
+}
+
+static const struct file_operations debug_bench_mt_ops = {
+	.read = debug_bench_mt_read,
+	.llseek = default_llseek,
+	.open = debug_generic_open,
+	.release = debug_generic_release,
+};
+
+void simulator_init(void)
+{
+	debugfs_create_u32("sim_run_time_us", 0600, g_ctx.debug_dir,
+			   &l_ctx.run_time_us);
+	debugfs_create_file("sim_bench", 0400, g_ctx.debug_dir, NULL,
+			    &debug_bench_ops);
+	debugfs_create_file("sim_bench_mt", 0400, g_ctx.debug_dir, NULL,
+			    &debug_bench_mt_ops);
+}
@@ -0,0 +1,49 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright (c) 2026 Motorola Mobility, LLC.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+#ifndef _MC_SIMULATOR_H_
+#define _MC_SIMULATOR_H_
+
+#include "tee_client_types.h"	/* struct teec_uuid */
+
+/* GP TAs built into the simulated SWd */
+#define SIM_TA_ECHO_UUID { 0x51e0ec40, 0x0000, 0x4000, \
+			   { 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01 } }
+#define SIM_TA_COMPUTE_UUID { 0x51e0c0de, 0x0000, 0x4000, \
+			   { 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02 } }
+
+/*
+ * Commands of the simulated TAs:
+ * - echo: value b = value a for all value parameters, memrefs are untouched
+ * - compute add: params[1].value.a = params[0].value.a + params[0].value.b
+ * - compute spin: run for params[0].value.a us in the SWd
+ */
+#define SIM_CMD_ECHO		0
+#define SIM_CMD_ADD		1
+#define SIM_CMD_SPIN		2
+
+#ifdef MC_SWD_SIMULATOR
+/* Simulated SWd */
+void simulator_init(void);
+
+/* Benchmark of the NWd stack, against the simulated SWd */
+int simulator_bench(struct kasnprintf_buf *buf);
+int simulator_bench_concurrent(struct kasnprintf_buf *buf);
+#else
+static inline void simulator_init(void)
+{
+}
+#endif
+
+#endif /* _MC_SIMULATOR_H_ */
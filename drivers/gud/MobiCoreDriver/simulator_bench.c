@@ -0,0 +1,308 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Copyright (c) 2026 Motorola Mobility, LLC.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Benchmark of the NWd stack through the kernel GP client API, against the
+ * simulated SWd: reading the sim_bench debugfs file runs it from one thread,
+ * reading sim_bench_mt runs it from one thread per CPU at once, each with its
+ * own context, to show the contention on the shared NWd paths.
+ */
+
+#include <linux/atomic.h>
+#include <linux/completion.h>
+#include <linux/cpumask.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/limits.h>
+#include <linux/math64.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+
+#include "tee_client_api.h"
+
+#include "main.h"
+#include "simulator.h"
+
+/* Number of sessions opened, and of each invocation per session */
+#define BENCH_SESSIONS		16
+#define BENCH_INVOKES		256
+/* Size of the temporary buffer mapped for each invocation */
+#define BENCH_MAP_SIZE		SZ_16K
+/* Maximum number of threads of the concurrent run */
+#define BENCH_THREADS_MAX	8
+
+enum bench_phase {
+	BENCH_OPEN,
+	BENCH_INVOKE,
+	BENCH_INVOKE_MAP,
+	BENCH_CLOSE,
+	BENCH_PHASES,
+};
+
+static const char *const bench_phase_names[BENCH_PHASES] = {
+	"open", "invoke", "invoke+map", "close",
+};
+
+struct bench_stat {
+	u64	count;
+	u64	total_ns;
+	u64	min_ns;
+	u64	max_ns;
+	u32	errors;
+};
+
+/* One thread of the concurrent run */
+struct bench_thread {
+	struct bench_stat	stats[BENCH_PHASES];
+	int			nr_sessions;
+	u32			ret;
+	struct completion	*start;
+	atomic_t		*running;
+	struct completion	*done;
+};
+
+static inline void bench_stats_init(struct bench_stat *stats)
+{
+	int i;
+
+	for (i = 0; i < BENCH_PHASES; i++) {
+		memset(&stats[i], 0, sizeof(stats[i]));
+		stats[i].min_ns = U64_MAX;
+	}
+}
+
+static inline void bench_stat_add(struct bench_stat *stat, u64 start_ns,
+				  u32 ret)
+{
+	u64 ns = ktime_get_ns() - start_ns;
+
+	if (ret != TEEC_SUCCESS) {
+		stat->errors++;
+		return;
+	}
+
+	stat->count++;
+	stat->total_ns += ns;
+	if (ns < stat->min_ns)
+		stat->min_ns = ns;
+
+	if (ns > stat->max_ns)
+		stat->max_ns = ns;
+}
+
+static inline void bench_stat_merge(struct bench_stat *stat,
+				    const struct bench_stat *from)
+{
+	stat->count += from->count;
+	stat->total_ns += from->total_ns;
+	stat->errors += from->errors;
+	if (from->min_ns < stat->min_ns)
+		stat->min_ns = from->min_ns;
+
+	if (from->max_ns > stat->max_ns)
+		stat->max_ns = from->max_ns;
+}
+
+/* Open sessions in a new context and invoke the echo TA in each */
+static u32 bench_run(struct bench_stat *stats, int nr_sessions)
+{
+	static const struct teec_uuid uuid = SIM_TA_ECHO_UUID;
+	struct teec_context context;
+	struct teec_session session;
+	struct teec_operation operation;
+	void *map_buf;
+	u64 start_ns;
+	u32 ret;
+	int i, j;
+
+	map_buf = kzalloc(BENCH_MAP_SIZE, GFP_KERNEL);
+	if (!map_buf)
+		return TEEC_ERROR_OUT_OF_MEMORY;
+
+	ret = teec_initialize_context(NULL, &context);
+	if (ret != TEEC_SUCCESS) {
+		kfree(map_buf);
+		return ret;
+	}
+
+	for (i = 0; i < nr_sessions; i++) {
+		start_ns = ktime_get_ns();
+		ret = teec_open_session(&context, &session, &uuid,
+					TEEC_LOGIN_PUBLIC, NULL, NULL, NULL);
+		bench_stat_add(&stats[BENCH_OPEN], start_ns, ret);
+		if (ret != TEEC_SUCCESS)
+			continue;
+
+		for (j = 0; j < BENCH_INVOKES; j++) {
+			memset(&operation, 0, sizeof(operation));
+			operation.param_types = TEEC_PARAM_TYPES(
+				TEEC_VALUE_INOUT, TEEC_NONE, TEEC_NONE,
+				TEEC_NONE);
+			operation.params[0].value.a = j;
+			start_ns = ktime_get_ns();
+			ret = teec_invoke_command(&session, SIM_CMD_ECHO,
+						  &operation, NULL);
+			if (ret == TEEC_SUCCESS &&
+			    operation.params[0].value.b != j)
+				ret = TEEC_ERROR_GENERIC;
+
+			bench_stat_add(&stats[BENCH_INVOKE], start_ns, ret);
+
+			memset(&operation, 0, sizeof(operation));
+			operation.param_types = TEEC_PARAM_TYPES(
+				TEEC_MEMREF_TEMP_INOUT, TEEC_NONE, TEEC_NONE,
+				TEEC_NONE);
+			operation.params[0].tmpref.buffer = map_buf;
+			operation.params[0].tmpref.size = BENCH_MAP_SIZE;
+			start_ns = ktime_get_ns();
+			ret = teec_invoke_command(&session, SIM_CMD_ECHO,
+						  &operation, NULL);
+			bench_stat_add(&stats[BENCH_INVOKE_MAP], start_ns, ret);
+		}
+
+		start_ns = ktime_get_ns();
+		teec_close_session(&session);
+		bench_stat_add(&stats[BENCH_CLOSE], start_ns, TEEC_SUCCESS);
+	}
+
+	teec_finalize_context(&context);
+	kfree(map_buf);
+	return TEEC_SUCCESS;
+}
+
+static int bench_print(struct kasnprintf_buf *buf,
+		       const struct bench_stat *stats, u64 run_ns)
+{
+	int i, err;
+
+	err = kasnprintf(buf, "%-12s %8s %6s %10s %10s %10s\n", "phase",
+			 "count", "errors", "min(ns)", "avg(ns)", "max(ns)");
+	if (err < 0)
+		return err;
+
+	for (i = 0; i < BENCH_PHASES; i++) {
+		const struct bench_stat *stat = &stats[i];
+
+		err = kasnprintf(buf, "%-12s %8llu %6u %10llu %10llu %10llu\n",
+				 bench_phase_names[i], stat->count,
+				 stat->errors,
+				 stat->count ? stat->min_ns : 0,
+				 stat->count ?
+				 div64_u64(stat->total_ns, stat->count) : 0,
+				 stat->max_ns);
+		if (err < 0)
+			return err;
+	}
+
+	return kasnprintf(buf, "%llu invocations/s\n",
+			  div64_u64((stats[BENCH_INVOKE].count +
+				     stats[BENCH_INVOKE_MAP].count) *
+				    NSEC_PER_SEC, run_ns ? run_ns : 1));
+}
+
+int simulator_bench(struct kasnprintf_buf *buf)
+{
+	struct bench_stat stats[BENCH_PHASES];
+	u64 run_ns;
+	u32 ret;
+
+	bench_stats_init(stats);
+	run_ns = ktime_get_ns();
+	ret = bench_run(stats, BENCH_SESSIONS);
+	run_ns = ktime_get_ns() - run_ns;
+	if (ret != TEEC_SUCCESS)
+		return kasnprintf(buf, "context init failed: 0x%08x\n", ret);
+
+	return bench_print(buf, stats, run_ns);
+}
+
+static int bench_thread_fn(void *data)
+{
+	struct bench_thread *thread = data;
+
+	bench_stats_init(thread->stats);
+	wait_for_completion(thread->start);
+	thread->ret = bench_run(thread->stats, thread->nr_sessions);
+	/* Last access to the caller's data */
+	if (atomic_dec_and_test(thread->running))
+		complete(thread->done);
+
+	return 0;
+}
+
+int simulator_bench_concurrent(struct kasnprintf_buf *buf)
+{
+	struct bench_stat stats[BENCH_PHASES];
+	struct bench_thread *threads;
+	struct task_struct *task;
+	DECLARE_COMPLETION_ONSTACK(start);
+	DECLARE_COMPLETION_ONSTACK(done);
+	atomic_t running;
+	int nr_threads = min_t(int, num_online_cpus(), BENCH_THREADS_MAX);
+	int i, err;
+	u64 run_ns;
+
+	threads = kcalloc(nr_threads, sizeof(*threads), GFP_KERNEL);
+	if (!threads)
+		return -ENOMEM;
+
+	/* Same total work as the sequential run */
+	atomic_set(&running, 1);
+	for (i = 0; i < nr_threads; i++) {
+		threads[i].nr_sessions =
+			DIV_ROUND_UP(BENCH_SESSIONS, nr_threads);
+		threads[i].start = &start;
+		threads[i].running = &running;
+		threads[i].done = &done;
+		atomic_inc(&running);
+		task = kthread_run(bench_thread_fn, &threads[i], "tee_bench/%d",
+				   i);
+		if (IS_ERR(task)) {
+			atomic_dec(&running);
+			threads[i].ret = TEEC_ERROR_OUT_OF_MEMORY;
+		}
+	}
+
+	run_ns = ktime_get_ns();
+	complete_all(&start);
+	if (!atomic_dec_and_test(&running))
+		wait_for_completion(&done);
+
+	run_ns = ktime_get_ns() - run_ns;
+
+	bench_stats_init(stats);
+	for (i = 0; i < nr_threads; i++) {
+		int j;
+
+		if (threads[i].ret != TEEC_SUCCESS) {
+			err = kasnprintf(buf, "thread %d failed: 0x%08x\n", i,
+					 threads[i].ret);
+			if (err < 0)
+				goto end;
+
+			continue;
+		}
+
+		for (j = 0; j < BENCH_PHASES; j++)
+			bench_stat_merge(&stats[j], &threads[i].stats[j]);
+	}
+
+	err = kasnprintf(buf, "%d threads\n", nr_threads);
+	if (err >= 0)
+		err = bench_print(buf, stats, run_ns);
+
+end:
+	kfree(threads);
+	return err;
+}
@@ -18,6 +18,8 @@
 #include <linux/export.h>
 #include <linux/fs.h>
 #include <linux/mm_types.h>	/* struct vm_area_struct */
+#include <linux/poll.h>
+#include <linux/slab.h>
 #include <linux/uaccess.h>
 
 #include "mc_user.h"
@@ -365,6 +367,82 @@ static long user_ioctl(struct file *file, unsigned int id, unsigned long arg)
 		}
 		break;
 	}
+	case MC_IO_GP_INVOKE_SUBMIT: {
+		struct mc_ioctl_gp_invoke_submit submit;
+		struct mc_ioctl_gp_async_command *commands;
+
+		if (copy_from_user(&submit, uarg, sizeof(submit))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		if (!submit.nr_commands ||
+		    submit.nr_commands > MC_GP_ASYNC_BATCH_MAX) {
+			ret = -EINVAL;
+			break;
+		}
+
+		/* One copy for the whole batch */
+		commands = memdup_user(
+			(void __user *)(uintptr_t)submit.commands,
+			submit.nr_commands * sizeof(*commands));
+		if (IS_ERR(commands)) {
+			ret = PTR_ERR(commands);
+			break;
+		}
+
+		ret = client_gp_invoke_submit(client, commands,
+					      submit.nr_commands);
+		kfree(commands);
+		if (ret < 0)
+			break;
+
+		submit.nr_submitted = ret;
+		ret = 0;
+		if (copy_to_user(uarg, &submit, sizeof(submit))) {
+			ret = -EFAULT;
+			break;
+		}
+		break;
+	}
+	case MC_IO_GP_INVOKE_REAP: {
+		struct mc_ioctl_gp_invoke_reap reap;
+		struct mc_ioctl_gp_async_command *completions;
+
+		if (copy_from_user(&reap, uarg, sizeof(reap))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		if (reap.nr_completions > MC_GP_ASYNC_BATCH_MAX)
+			reap.nr_completions = MC_GP_ASYNC_BATCH_MAX;
+
+		completions = kcalloc(reap.nr_completions, sizeof(*completions),
+				      GFP_KERNEL);
+		if (!completions) {
+			ret = -ENOMEM;
+			break;
+		}
+
+		ret = client_gp_invoke_reap(client, completions,
+					    reap.nr_completions, reap.timeout);
+		if (ret < 0) {
+			kfree(completions);
+			break;
+		}
+
+		reap.nr_reaped = ret;
+		ret = 0;
+		if (copy_to_user((void __user *)(uintptr_t)reap.completions,
+				 completions,
+				 reap.nr_reaped * sizeof(*completions)) ||
+		    copy_to_user(uarg, &reap, sizeof(reap)))
+			/* Completions are lost, as for a failed invoke copy */
+			ret = -EFAULT;
+
+		kfree(completions);
+		break;
+	}
 	case MC_IO_GP_REQUEST_CANCELLATION: {
 		struct mc_ioctl_gp_request_cancellation cancel;
 
@@ -405,6 +483,27 @@ static int user_mmap(struct file *file, struct vm_area_struct *vmarea)
 				  NULL, vmarea);
 }
 
+/*
+ * Callback for system poll()
+ * Readable when asynchronous GP invocations have completed
+ */
+#if KERNEL_VERSION(4, 16, 0) <= LINUX_VERSION_CODE
+static __poll_t user_poll(struct file *file, poll_table *wait)
+#else
+static unsigned int user_poll(struct file *file, poll_table *wait)
+#endif
+{
+	struct tee_client *client = get_client(file);
+
+	if (!client)
+		return POLLERR;
+
+	if (client_gp_invoke_poll(client, file, wait))
+		return POLLIN | POLLRDNORM;
+
+	return 0;
+}
+
 static const struct file_operations mc_user_fops = {
 	.owner = THIS_MODULE,
 	.open = user_open,
@@ -414,6 +513,7 @@ static const struct file_operations mc_user_fops = {
 	.compat_ioctl = user_ioctl,
 #endif
 	.mmap = user_mmap,
+	.poll = user_poll,
 };
 
 int mc_user_init(struct cdev *cdev)
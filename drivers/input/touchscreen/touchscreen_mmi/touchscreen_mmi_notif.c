@@ -413,6 +413,17 @@ static inline int ts_mmi_ps_get_state(struct power_supply *psy, bool *present)
 	return 0;
 }
 
+static void ts_mmi_ps_update(struct ts_mmi_dev *touch_cdev, bool present)
+{
+	if (touch_cdev->ps_is_present != present) {
+		touch_cdev->ps_is_present = present;
+		if (is_touch_active) {
+			kfifo_put(&touch_cdev->cmd_pipe, TS_MMI_DO_PS);
+			schedule_delayed_work(&touch_cdev->work, 0);
+		}
+	}
+}
+
 static int ts_mmi_charger_cb(struct notifier_block *self,
 				unsigned long event, void *ptr)
 {
@@ -437,17 +448,32 @@ static int ts_mmi_charger_cb(struct notifier_block *self,
 	dev_dbg(DEV_MMI, "%s: event=%lu, usb status: cur=%d, prev=%d\n",
 				__func__, event, present, touch_cdev->ps_is_present);
 
-	if (touch_cdev->ps_is_present != present) {
-		touch_cdev->ps_is_present = present;
-		if (is_touch_active) {
-			kfifo_put(&touch_cdev->cmd_pipe, TS_MMI_DO_PS);
-			schedule_delayed_work(&touch_cdev->work, 0);
-		}
-	}
+	ts_mmi_ps_update(touch_cdev, present);
 
 	return 0;
 }
 
+/* usb present/online changes from the relay power supply snapshot */
+static void ts_mmi_charger_relay_cb(struct relay_psy_client *client,
+				const struct relay_psy_event *ev)
+{
+	struct ts_mmi_dev *touch_cdev = container_of(
+					client, struct ts_mmi_dev, ps_relay);
+	bool present;
+
+	if (ev->valid & RELAY_PSY_BIT(RELAY_PSY_PRESENT))
+		present = !!ev->val[RELAY_PSY_PRESENT];
+	else if (ev->valid & RELAY_PSY_BIT(RELAY_PSY_ONLINE))
+		present = !!ev->val[RELAY_PSY_ONLINE];
+	else
+		return;
+
+	dev_dbg(DEV_MMI, "%s: usb status: cur=%d, prev=%d\n",
+				__func__, present, touch_cdev->ps_is_present);
+
+	ts_mmi_ps_update(touch_cdev, present);
+}
+
 static int ts_mmi_fps_cb(struct notifier_block *self,
 				unsigned long event, void *p)
 {
@@ -512,10 +538,19 @@ int ts_mmi_notifiers_register(struct ts_mmi_dev *touch_cdev)
 	if (touch_cdev->pdata.usb_detection) {
 		struct power_supply *psy = NULL;
 		bool present;
-		touch_cdev->ps_notif.notifier_call = ts_mmi_charger_cb;
-		ret = power_supply_reg_notifier(&touch_cdev->ps_notif);
-		if (ret)
-			goto PS_NOTIF_REGISTER_FAILED;
+
+		/* Share the usb reads with other drivers when the relay is up */
+		touch_cdev->ps_relay.mask[RELAY_PSY_USB] =
+			RELAY_PSY_BIT(RELAY_PSY_PRESENT) |
+			RELAY_PSY_BIT(RELAY_PSY_ONLINE);
+		touch_cdev->ps_relay.changed = ts_mmi_charger_relay_cb;
+		touch_cdev->is_ps_relay = !relay_psy_register(&touch_cdev->ps_relay);
+		if (!touch_cdev->is_ps_relay) {
+			touch_cdev->ps_notif.notifier_call = ts_mmi_charger_cb;
+			ret = power_supply_reg_notifier(&touch_cdev->ps_notif);
+			if (ret)
+				goto PS_NOTIF_REGISTER_FAILED;
+		}
 
 		psy = power_supply_get_by_name("usb");
 		if (psy) {
@@ -579,8 +614,12 @@ void ts_mmi_notifiers_unregister(struct ts_mmi_dev *touch_cdev)
 	if (touch_cdev->pdata.update_refresh_rate)
 		unregister_dynamic_refresh_rate_notifier(&touch_cdev->freq_nb);
 
-	if (touch_cdev->pdata.usb_detection)
-		power_supply_unreg_notifier(&touch_cdev->ps_notif);
+	if (touch_cdev->pdata.usb_detection) {
+		if (touch_cdev->is_ps_relay)
+			relay_psy_unregister(&touch_cdev->ps_relay);
+		else
+			power_supply_unreg_notifier(&touch_cdev->ps_notif);
+	}
 
 	if (!touch_cdev->panel_status)
 		UNREGISTER_PANEL_NOTIFIER;
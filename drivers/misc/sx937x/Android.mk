@@ -13,10 +13,17 @@ ifeq ($(SX937X_FLIP_CAL),true)
 	KBUILD_OPTIONS += CONFIG_SX937X_FLIP_CAL=y
 endif
 
+ifeq ($(SX937X_PSY_RELAY),true)
+	KBUILD_OPTIONS += CONFIG_SX937X_PSY_RELAY=y
+endif
+
 include $(CLEAR_VARS)
 LOCAL_MODULE := sx937x_sar.ko
 LOCAL_MODULE_TAGS := optional
 LOCAL_MODULE_PATH := $(KERNEL_MODULES_OUT)
 LOCAL_ADDITIONAL_DEPENDENCIES := $(KERNEL_MODULES_OUT)/sensors_class.ko
+ifeq ($(SX937X_PSY_RELAY),true)
+LOCAL_ADDITIONAL_DEPENDENCIES += $(KERNEL_MODULES_OUT)/mmi_relay.ko
+endif
 KBUILD_OPTIONS_GKI += GKI_OBJ_MODULE_DIR=gki
 include $(DLKM_DIR)/AndroidKernelModule.mk
@@ -33,6 +33,9 @@
 #include <linux/usb.h>
 #include <linux/power_supply.h>
 #include <linux/sensors.h>
+#ifdef CONFIG_CAPSENSE_PSY_RELAY
+#include <linux/mmi_relay.h>
+#endif
 #include <linux/input/sx937x.h> 	/* main struct, interrupt,init,pointers */
 #include "base.h"
 
@@ -1275,6 +1278,63 @@ static int ps_notify_callback(struct notifier_block *self,
 	return 0;
 }
 
+#ifdef CONFIG_CAPSENSE_PSY_RELAY
+#ifdef CONFIG_USE_POWER_SUPPLY_ONLINE
+#define PS_RELAY_PROP RELAY_PSY_ONLINE
+#else
+#define PS_RELAY_PROP RELAY_PSY_PRESENT
+#endif
+
+static void ps_relay_callback(struct relay_psy_client *client,
+		const struct relay_psy_event *ev)
+{
+	struct sx937x_platform_data *data =
+		container_of(client, struct sx937x_platform_data, ps_relay);
+	bool present;
+
+	if (!(ev->valid & RELAY_PSY_BIT(PS_RELAY_PROP)))
+		return;
+
+	present = ev->val[PS_RELAY_PROP] ? true : false;
+	LOG_DBG("ps relay notification: usb %d\n", present);
+	if (data->ps_is_present != present) {
+		data->ps_is_present = present;
+		schedule_work(&data->ps_notify_work);
+	}
+}
+
+/* usb changes are read once by the relay and shared with other drivers */
+static int ps_relay_register(struct sx937x_platform_data *data)
+{
+	int val = 0;
+	int retval;
+
+	/* The initial state, so that the registration only reports changes */
+	if (!relay_psy_get(RELAY_PSY_USB, PS_RELAY_PROP, &val))
+		data->ps_is_present = val ? true : false;
+
+	data->ps_relay.mask[RELAY_PSY_USB] = RELAY_PSY_BIT(PS_RELAY_PROP);
+	data->ps_relay.changed = ps_relay_callback;
+	retval = relay_psy_register(&data->ps_relay);
+
+	return retval;
+}
+
+static void ps_relay_unregister(struct sx937x_platform_data *data)
+{
+	relay_psy_unregister(&data->ps_relay);
+}
+#else
+static inline int ps_relay_register(struct sx937x_platform_data *data)
+{
+	return -ENODEV;
+}
+
+static inline void ps_relay_unregister(struct sx937x_platform_data *data)
+{
+}
+#endif
+
 #ifdef CONFIG_CAPSENSE_FLIP_CAL
 static void write_flip_regs(int num_regs, struct smtc_reg_data *regs)
 {
@@ -1542,17 +1602,20 @@ static int sx937x_probe(struct i2c_client *client, const struct i2c_device_id *i
 #ifdef CONFIG_CAPSENSE_USB_CAL
 		/*notify usb state*/
 		INIT_WORK(&pplatData->ps_notify_work, ps_notify_callback_work);
-		pplatData->ps_notif.notifier_call = ps_notify_callback;
-		err = power_supply_reg_notifier(&pplatData->ps_notif);
-		if (err)
-			LOG_ERR("Unable to register ps_notifier: %d\n", err);
-
-		psy = power_supply_get_by_name("usb");
-		if (psy) {
-			err = ps_get_state(psy, &pplatData->ps_is_present);
-			if (err) {
-				LOG_ERR("psy get property failed rc=%d\n", err);
-				power_supply_unreg_notifier(&pplatData->ps_notif);
+		pplatData->is_ps_relay = !ps_relay_register(pplatData);
+		if (!pplatData->is_ps_relay) {
+			pplatData->ps_notif.notifier_call = ps_notify_callback;
+			err = power_supply_reg_notifier(&pplatData->ps_notif);
+			if (err)
+				LOG_ERR("Unable to register ps_notifier: %d\n", err);
+
+			psy = power_supply_get_by_name("usb");
+			if (psy) {
+				err = ps_get_state(psy, &pplatData->ps_is_present);
+				if (err) {
+					LOG_ERR("psy get property failed rc=%d\n", err);
+					power_supply_unreg_notifier(&pplatData->ps_notif);
+				}
 			}
 		}
 #ifdef CONFIG_CAPSENSE_FLIP_CAL
@@ -1632,8 +1695,11 @@ static int sx937x_remove(struct i2c_client *client)
 
 		class_unregister(&capsense_class);
 #ifdef CONFIG_CAPSENSE_USB_CAL
+		if (pplatData->is_ps_relay)
+			ps_relay_unregister(pplatData);
+		else
+			power_supply_unreg_notifier(&pplatData->ps_notif);
 		cancel_work_sync(&pplatData->ps_notify_work);
-		power_supply_unreg_notifier(&pplatData->ps_notif);
 #endif
 		if (pplatData && pplatData->exit_platform_hw)
 			pplatData->exit_platform_hw(client);
@@ -12,6 +12,7 @@
 #include <linux/list.h>
 #include <linux/mutex.h>
 #include <linux/mmi_relay.h>
+#include <linux/power_supply.h>
 #include <linux/slab.h>
 
 typedef struct _relay_node {
@@ -25,14 +26,40 @@ typedef struct _relay_node {
     notifier_d dev;
 }relay_node;
 
+struct relay_psy {
+    struct notifier_block nb;
+    struct work_struct work;
+    unsigned long pending;          /* supplies changed but not read yet */
+    struct mutex clients_lock;      /* protects clients, held while calling them */
+    struct list_head clients;
+    struct mutex snap_lock;         /* protects snap and tracked */
+    struct relay_psy_event snap[RELAY_PSY_NUM];
+    unsigned long tracked[RELAY_PSY_NUM];   /* props read on the last change */
+};
+
 struct mmi_relay_dev {
     struct platform_device *pdev;
     struct mutex lock;
     relay_node nodes[NUM_TYPES][NUM_DEVS];
     unsigned notifier_nums;
+    struct relay_psy psy;
 };
 static struct mmi_relay_dev* relay_dev;
 
+static const char *const relay_psy_names[RELAY_PSY_NUM] = {
+    "usb", "battery", "wireless",
+};
+
+static const enum power_supply_property relay_psy_props[RELAY_PSY_PROP_NUM] = {
+    POWER_SUPPLY_PROP_ONLINE,
+    POWER_SUPPLY_PROP_PRESENT,
+    POWER_SUPPLY_PROP_STATUS,
+    POWER_SUPPLY_PROP_CAPACITY,
+    POWER_SUPPLY_PROP_TEMP,
+    POWER_SUPPLY_PROP_VOLTAGE_NOW,
+    POWER_SUPPLY_PROP_CURRENT_NOW,
+};
+
 /*
  * Informs the registered notifiers about an event
  * @type: notification type: atomic blocking
@@ -160,10 +187,197 @@ int relay_unregister_action(notifier_t type, notifier_d dev, struct notifier_blo
 }
 EXPORT_SYMBOL_GPL(relay_unregister_action);
 
+/* Reads the props in mask from the supply, ev->valid tells which succeeded */
+static void relay_psy_read(relay_psy_s supply, unsigned long mask,
+                           struct relay_psy_event *ev)
+{
+    union power_supply_propval pval;
+    struct power_supply *psy;
+    int i;
+
+    ev->supply = supply;
+    ev->valid = 0;
+    psy = power_supply_get_by_name(relay_psy_names[supply]);
+    if (!psy)
+        return;
+
+    for (i = 0; i < RELAY_PSY_PROP_NUM; i++) {
+        if (!(mask & RELAY_PSY_BIT(i)))
+            continue;
+        if (power_supply_get_property(psy, relay_psy_props[i], &pval))
+            continue;
+        ev->val[i] = pval.intval;
+        ev->valid |= RELAY_PSY_BIT(i);
+    }
+    power_supply_put(psy);
+}
+
+static void relay_psy_work(struct work_struct *work)
+{
+    struct relay_psy *rpsy = container_of(work, struct relay_psy, work);
+    struct relay_psy_client *client;
+    struct relay_psy_event ev;
+    struct relay_psy_event *snap;
+    unsigned long mask;
+    int s, i;
+
+    for (s = 0; s < RELAY_PSY_NUM; s++) {
+        if (!test_and_clear_bit(s, &rpsy->pending))
+            continue;
+
+        mutex_lock(&rpsy->clients_lock);
+        mask = 0;
+        list_for_each_entry(client, &rpsy->clients, list)
+            mask |= client->mask[s];
+        if (!mask) {
+            mutex_unlock(&rpsy->clients_lock);
+            continue;
+        }
+
+        relay_psy_read(s, mask, &ev);
+
+        /* Props nobody tracked before count as changed */
+        mutex_lock(&rpsy->snap_lock);
+        snap = &rpsy->snap[s];
+        ev.changed = 0;
+        for (i = 0; i < RELAY_PSY_PROP_NUM; i++) {
+            if (!(ev.valid & RELAY_PSY_BIT(i)))
+                continue;
+            if (!(rpsy->tracked[s] & snap->valid & RELAY_PSY_BIT(i)) ||
+                snap->val[i] != ev.val[i])
+                ev.changed |= RELAY_PSY_BIT(i);
+            snap->val[i] = ev.val[i];
+        }
+        snap->valid = (snap->valid & ~mask) | ev.valid;
+        rpsy->tracked[s] = mask;
+        mutex_unlock(&rpsy->snap_lock);
+
+        if (ev.changed) {
+            list_for_each_entry(client, &rpsy->clients, list) {
+                if (client->mask[s] & ev.changed)
+                    client->changed(client, &ev);
+            }
+        }
+        mutex_unlock(&rpsy->clients_lock);
+    }
+}
+
+static int relay_psy_notify(struct notifier_block *nb, unsigned long event,
+                            void *ptr)
+{
+    struct relay_psy *rpsy = container_of(nb, struct relay_psy, nb);
+    struct power_supply *psy = ptr;
+    int s;
+
+    if (event != PSY_EVENT_PROP_CHANGED || !psy || !psy->desc->name)
+        return NOTIFY_DONE;
+
+    /* Changes arriving before the work runs are read once */
+    for (s = 0; s < RELAY_PSY_NUM; s++) {
+        if (!strcmp(psy->desc->name, relay_psy_names[s])) {
+            set_bit(s, &rpsy->pending);
+            schedule_work(&rpsy->work);
+            break;
+        }
+    }
+
+    return NOTIFY_OK;
+}
+
+/**
+ * Register a client to be called when one of its props changes. The client
+ * is called once right away with the current values, all marked changed,
+ * so that it does not miss a change happening while it registers.
+ */
+int relay_psy_register(struct relay_psy_client *client)
+{
+    struct relay_psy_event ev;
+    int s;
+
+    if(!relay_dev) {
+        pr_err("Device is not initialized\n");
+        return -EINVAL;
+    }
+
+    if (!client->changed)
+        return -EINVAL;
+
+    /* Under clients_lock, so no later event reaches the client first */
+    mutex_lock(&relay_dev->psy.clients_lock);
+    list_add_tail(&client->list, &relay_dev->psy.clients);
+    for (s = 0; s < RELAY_PSY_NUM; s++) {
+        if (!client->mask[s])
+            continue;
+        relay_psy_read(s, client->mask[s], &ev);
+        ev.changed = ev.valid;
+        if (ev.changed)
+            client->changed(client, &ev);
+    }
+    mutex_unlock(&relay_dev->psy.clients_lock);
+
+    return 0;
+}
+EXPORT_SYMBOL_GPL(relay_psy_register);
+
+int relay_psy_unregister(struct relay_psy_client *client)
+{
+    if(!relay_dev) {
+        pr_err("Device is not initialized\n");
+        return -EINVAL;
+    }
+
+    mutex_lock(&relay_dev->psy.clients_lock);
+    list_del(&client->list);
+    mutex_unlock(&relay_dev->psy.clients_lock);
+
+    return 0;
+}
+EXPORT_SYMBOL_GPL(relay_psy_unregister);
+
+/**
+ * Get a prop, from the snapshot for the event driven props clients track.
+ * Measurements drift without a change event, they are always read from
+ * the supply. Can be called from a client callback.
+ */
+int relay_psy_get(relay_psy_s supply, relay_psy_p prop, int *val)
+{
+    struct relay_psy *rpsy;
+    struct relay_psy_event ev;
+    int ret = 0;
+
+    if(!relay_dev) {
+        pr_err("Device is not initialized\n");
+        return -EINVAL;
+    }
+
+    if(supply >= RELAY_PSY_NUM || prop >= RELAY_PSY_PROP_NUM)
+        return -EPERM;
+
+    rpsy = &relay_dev->psy;
+    mutex_lock(&rpsy->snap_lock);
+    if (rpsy->tracked[supply] & rpsy->snap[supply].valid &
+        RELAY_PSY_EVENT_PROPS & RELAY_PSY_BIT(prop)) {
+        *val = rpsy->snap[supply].val[prop];
+        mutex_unlock(&rpsy->snap_lock);
+        return 0;
+    }
+    mutex_unlock(&rpsy->snap_lock);
+
+    relay_psy_read(supply, RELAY_PSY_BIT(prop), &ev);
+    if (ev.valid & RELAY_PSY_BIT(prop))
+        *val = ev.val[prop];
+    else
+        ret = -ENODATA;
+
+    return ret;
+}
+EXPORT_SYMBOL_GPL(relay_psy_get);
+
 static int mmi_relay_probe(struct platform_device *pdev)
 {
     notifier_t i;
     notifier_d j;
+    int ret;
 
     relay_dev = kzalloc(sizeof(struct mmi_relay_dev), GFP_KERNEL);
     if (!relay_dev) {
@@ -190,12 +404,29 @@ static int mmi_relay_probe(struct platform_device *pdev)
             }
         }
     }
+
+    mutex_init(&relay_dev->psy.clients_lock);
+    mutex_init(&relay_dev->psy.snap_lock);
+    INIT_LIST_HEAD(&relay_dev->psy.clients);
+    INIT_WORK(&relay_dev->psy.work, relay_psy_work);
+    relay_dev->psy.nb.notifier_call = relay_psy_notify;
+    ret = power_supply_reg_notifier(&relay_dev->psy.nb);
+    if (ret) {
+        pr_err("Failed to register psy notifier: %d\n", ret);
+        kfree(relay_dev);
+        relay_dev = NULL;
+        return ret;
+    }
+
     return 0;
 }
 
 static int mmi_relay_remove(struct platform_device *pdev)
 {
+    power_supply_unreg_notifier(&relay_dev->psy.nb);
+    cancel_work_sync(&relay_dev->psy.work);
     kfree(relay_dev);
+    relay_dev = NULL;
     return 0;
 }
 
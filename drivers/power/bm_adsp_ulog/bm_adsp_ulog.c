@@ -9,9 +9,14 @@
 #include <linux/device.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
+#include <linux/poll.h>
 #include <linux/seq_file.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
 #include <linux/ipc_logging.h>
 #include <linux/rpmsg.h>
 #include <linux/soc/qcom/pmic_glink.h>
@@ -28,6 +33,8 @@
 #define BM_ULOG_WAIT_TIME_MS		5000
 #define MAX_ULOG_READ_BUFFER_SIZE	8192
 #define BM_ULOG_PAGES			(50)
+/* Stream ring of fetched chunks, a power of 2 */
+#define BM_ULOG_RING_SIZE		(64 * 1024)
 
 #define bm_info(bmdev, fmt, ...)		\
 	do {					\
@@ -74,7 +81,26 @@ struct bm_ulog_dev {
 	struct dentry			*debugfs_dir;
 	bool				*debug_enabled;
 	void				*ipc_log;
+	/* Serializes log requests with the copy out of ulog_buffer */
+	struct mutex			buf_lock;
 	char				ulog_buffer[MAX_ULOG_READ_BUFFER_SIZE];
+	/*
+	 * Background streaming, fed by stream_work only. The work waits up to
+	 * BM_ULOG_WAIT_TIME_MS for the ADSP, so it gets a queue of its own.
+	 */
+	struct workqueue_struct		*stream_wq;
+	struct delayed_work		stream_work;
+	bool				removing;
+	spinlock_t			stream_lock;
+	u32				stream_size;
+	u32				stream_interval_ms;
+	u32				stream_seq;
+	char				stream_chunk[MAX_ULOG_READ_BUFFER_SIZE];
+	/* Ring readers index with absolute offsets, head only grows */
+	struct mutex			ring_lock;
+	wait_queue_head_t		ring_wq;
+	char				*ring;
+	u64				ring_head;
 };
 
 static struct bm_ulog_dev *g_bmdev = NULL;
@@ -161,7 +187,8 @@ static int bm_ulog_set_mask(struct bm_ulog_dev *bmdev,
 	return 0;
 }
 
-static int bm_ulog_request_log(struct bm_ulog_dev *bmdev, u32 size)
+static int bm_ulog_request_log(struct bm_ulog_dev *bmdev, u32 size,
+			       char *buf)
 {
 	int rc;
 	u32 max_logsize;
@@ -177,11 +204,26 @@ static int bm_ulog_request_log(struct bm_ulog_dev *bmdev, u32 size)
 	ulog_req.hdr.opcode = BM_ULOG_GET;
 	ulog_req.max_logsize = max_logsize;
 
+	mutex_lock(&bmdev->buf_lock);
 	rc = bm_ulog_write(bmdev, &ulog_req, sizeof(ulog_req));
+	if (!rc)
+		memcpy(buf, bmdev->ulog_buffer, max_logsize);
+	mutex_unlock(&bmdev->buf_lock);
 
 	return rc;
 }
 
+/* Queue a fetch of the log, the largest pending size wins */
+static void bm_ulog_stream_kick(struct bm_ulog_dev *bmdev, u32 size)
+{
+	spin_lock(&bmdev->stream_lock);
+	if (size > bmdev->stream_size)
+		bmdev->stream_size = size;
+	spin_unlock(&bmdev->stream_lock);
+
+	mod_delayed_work(bmdev->stream_wq, &bmdev->stream_work, 0);
+}
+
 int bm_ulog_get_log(char *buf, u32 size)
 {
 	int rc;
@@ -202,14 +244,12 @@ int bm_ulog_get_log(char *buf, u32 size)
 		return -EINVAL;
 	}
 
-	rc = bm_ulog_request_log(bmdev, size);
+	rc = bm_ulog_request_log(bmdev, size, buf);
 	if (rc) {
 		pr_err("BM ulog failed to request log, rc=%d\n", rc);
 		return rc;
 	}
 
-	memcpy(buf, bmdev->ulog_buffer, size);
-
 	return 0;
 }
 EXPORT_SYMBOL(bm_ulog_get_log);
@@ -242,40 +282,103 @@ int bm_ulog_get_mask_log(enum bm_ulog_category_bitmap categories,
 		return rc;
 	}
 
-	rc = bm_ulog_request_log(bmdev, size);
+	rc = bm_ulog_request_log(bmdev, size, buf);
 	if (rc) {
 		pr_err("BM ulog failed to request log, rc=%d\n", rc);
 		return rc;
 	}
 
-	memcpy(buf, bmdev->ulog_buffer, size);
-
 	return 0;
 }
 EXPORT_SYMBOL(bm_ulog_get_mask_log);
 
-static void bm_ulog_print_buffer(struct bm_ulog_dev *bmdev, u32 size)
+static void bm_ulog_print_buffer(struct bm_ulog_dev *bmdev, char *buf,
+				 u32 size)
 {
 	int i;
 	int header = 0;
 
 	for (i = 0; i < size; i++) {
-		if (bmdev->ulog_buffer[i] == '\x0a') {
-			bmdev->ulog_buffer[i] = '\0';
-			bm_dbg(bmdev, "%s\n", &bmdev->ulog_buffer[header]);
+		if (buf[i] == '\x0a') {
+			buf[i] = '\0';
+			bm_dbg(bmdev, "%s\n", &buf[header]);
 			header = i + 1;
-		} else if (bmdev->ulog_buffer[i] == '\0') {
+		} else if (buf[i] == '\0') {
 			if (header < i) {
-				bm_dbg(bmdev, "%s\n", &bmdev->ulog_buffer[header]);
+				bm_dbg(bmdev, "%s\n", &buf[header]);
 			}
 			break;
 		}
 	}
 }
 
-int bm_ulog_print_log(u32 size)
+static void bm_ulog_ring_append(struct bm_ulog_dev *bmdev, const char *data,
+				size_t len)
+{
+	size_t off, n;
+
+	if (len > BM_ULOG_RING_SIZE) {
+		data += len - BM_ULOG_RING_SIZE;
+		len = BM_ULOG_RING_SIZE;
+	}
+
+	off = bmdev->ring_head & (BM_ULOG_RING_SIZE - 1);
+	n = min_t(size_t, len, BM_ULOG_RING_SIZE - off);
+	memcpy(bmdev->ring + off, data, n);
+	memcpy(bmdev->ring, data + n, len - n);
+	bmdev->ring_head += len;
+}
+
+/*
+ * Fetch the pending chunk into stream_chunk, so that ulog_buffer is free for
+ * the next response while the chunk is queued to the ring and printed.
+ */
+static void bm_ulog_stream_work(struct work_struct *work)
 {
+	struct bm_ulog_dev *bmdev = container_of(work, struct bm_ulog_dev,
+						 stream_work.work);
+	char seq[32];
+	size_t len, n;
+	u32 size;
 	int rc;
+
+	spin_lock(&bmdev->stream_lock);
+	size = bmdev->stream_size;
+	bmdev->stream_size = 0;
+	spin_unlock(&bmdev->stream_lock);
+
+	if (!size)
+		size = MAX_ULOG_READ_BUFFER_SIZE;
+
+	rc = bm_ulog_request_log(bmdev, size, bmdev->stream_chunk);
+	if (rc) {
+		pr_err("BM ulog failed to request log, rc=%d\n", rc);
+		goto out;
+	}
+
+	len = strnlen(bmdev->stream_chunk, size);
+	if (len) {
+		mutex_lock(&bmdev->ring_lock);
+		n = scnprintf(seq, sizeof(seq), "--- seq %u ---\n",
+			      bmdev->stream_seq++);
+		bm_ulog_ring_append(bmdev, seq, n);
+		bm_ulog_ring_append(bmdev, bmdev->stream_chunk, len);
+		if (bmdev->stream_chunk[len - 1] != '\n')
+			bm_ulog_ring_append(bmdev, "\n", 1);
+		mutex_unlock(&bmdev->ring_lock);
+		wake_up_interruptible(&bmdev->ring_wq);
+	}
+
+	bm_ulog_print_buffer(bmdev, bmdev->stream_chunk, size);
+
+out:
+	if (bmdev->stream_interval_ms)
+		queue_delayed_work(bmdev->stream_wq, &bmdev->stream_work,
+			msecs_to_jiffies(bmdev->stream_interval_ms));
+}
+
+int bm_ulog_print_log(u32 size)
+{
 	struct bm_ulog_dev *bmdev = g_bmdev;
 
 	if (!bmdev) {
@@ -288,13 +391,7 @@ int bm_ulog_print_log(u32 size)
 		return -EINVAL;
 	}
 
-	rc = bm_ulog_request_log(bmdev, size);
-	if (rc) {
-		pr_err("BM ulog failed to request log, rc=%d\n", rc);
-		return rc;
-	}
-
-	bm_ulog_print_buffer(bmdev, size);
+	bm_ulog_stream_kick(bmdev, size);
 
 	return 0;
 }
@@ -322,13 +419,7 @@ int bm_ulog_print_mask_log(enum bm_ulog_category_bitmap categories,
 		return rc;
 	}
 
-	rc = bm_ulog_request_log(bmdev, size);
-	if (rc) {
-		pr_err("BM ulog failed to request log, rc=%d\n", rc);
-		return rc;
-	}
-
-	bm_ulog_print_buffer(bmdev, size);
+	bm_ulog_stream_kick(bmdev, size);
 
 	return 0;
 }
@@ -338,6 +429,7 @@ EXPORT_SYMBOL(bm_ulog_print_mask_log);
 static int bm_ulog_dump_show(struct seq_file *s, void *unused)
 {
 	int rc;
+	char *buf;
 	struct bm_ulog_dev *bmdev = s->private;
 
 	rc = bm_ulog_set_mask(bmdev, bmdev->categories, bmdev->level);
@@ -346,12 +438,18 @@ static int bm_ulog_dump_show(struct seq_file *s, void *unused)
 		return rc;
 	}
 
-	rc = bm_ulog_request_log(bmdev, MAX_ULOG_READ_BUFFER_SIZE);
+	buf = kzalloc(MAX_ULOG_READ_BUFFER_SIZE + 1, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	rc = bm_ulog_request_log(bmdev, MAX_ULOG_READ_BUFFER_SIZE, buf);
 	if (rc) {
 		pr_err("BM ulog failed to request log, rc=%d\n", rc);
+		kfree(buf);
 		return rc;
 	}
-	seq_puts(s, bmdev->ulog_buffer);
+	seq_puts(s, buf);
+	kfree(buf);
 
 	return 0;
 }
@@ -368,6 +466,108 @@ static const struct file_operations bm_ulog_fops = {
 	.release		= single_release,
 };
 
+/* Readers start at the oldest chunk still in the ring */
+static int bm_ulog_stream_open(struct inode *inode, struct file *file)
+{
+	struct bm_ulog_dev *bmdev = inode->i_private;
+
+	file->private_data = bmdev;
+	mutex_lock(&bmdev->ring_lock);
+	if (bmdev->ring_head > BM_ULOG_RING_SIZE)
+		file->f_pos = bmdev->ring_head - BM_ULOG_RING_SIZE;
+	else
+		file->f_pos = 0;
+	mutex_unlock(&bmdev->ring_lock);
+
+	return nonseekable_open(inode, file);
+}
+
+static ssize_t bm_ulog_stream_read(struct file *file, char __user *ubuf,
+				   size_t count, loff_t *ppos)
+{
+	struct bm_ulog_dev *bmdev = file->private_data;
+	u64 pos = *ppos;
+	size_t off, n;
+	int rc;
+
+	mutex_lock(&bmdev->ring_lock);
+	while (pos >= bmdev->ring_head) {
+		mutex_unlock(&bmdev->ring_lock);
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+
+		rc = wait_event_interruptible(bmdev->ring_wq,
+				READ_ONCE(bmdev->ring_head) > pos ||
+				READ_ONCE(bmdev->removing));
+		if (rc)
+			return rc;
+		if (READ_ONCE(bmdev->removing))
+			return -ENODEV;
+
+		mutex_lock(&bmdev->ring_lock);
+	}
+
+	/* Skip what a slow reader let be overwritten */
+	if (bmdev->ring_head - pos > BM_ULOG_RING_SIZE)
+		pos = bmdev->ring_head - BM_ULOG_RING_SIZE;
+
+	count = min_t(u64, count, bmdev->ring_head - pos);
+	off = pos & (BM_ULOG_RING_SIZE - 1);
+	n = min_t(size_t, count, BM_ULOG_RING_SIZE - off);
+	if (copy_to_user(ubuf, bmdev->ring + off, n) ||
+	    copy_to_user(ubuf + n, bmdev->ring, count - n)) {
+		mutex_unlock(&bmdev->ring_lock);
+		return -EFAULT;
+	}
+	mutex_unlock(&bmdev->ring_lock);
+
+	*ppos = pos + count;
+
+	return count;
+}
+
+static __poll_t bm_ulog_stream_poll(struct file *file, poll_table *wait)
+{
+	struct bm_ulog_dev *bmdev = file->private_data;
+
+	poll_wait(file, &bmdev->ring_wq, wait);
+
+	return READ_ONCE(bmdev->ring_head) > file->f_pos ?
+		EPOLLIN | EPOLLRDNORM : 0;
+}
+
+static int bm_ulog_stream_interval_get(void *data, u64 *val)
+{
+	struct bm_ulog_dev *bmdev = data;
+
+	*val = bmdev->stream_interval_ms;
+
+	return 0;
+}
+
+/* A non zero interval starts streaming right away */
+static int bm_ulog_stream_interval_set(void *data, u64 val)
+{
+	struct bm_ulog_dev *bmdev = data;
+
+	bmdev->stream_interval_ms = val;
+	if (val)
+		bm_ulog_stream_kick(bmdev, MAX_ULOG_READ_BUFFER_SIZE);
+
+	return 0;
+}
+
+DEFINE_DEBUGFS_ATTRIBUTE(bm_ulog_stream_interval_fops,
+			 bm_ulog_stream_interval_get,
+			 bm_ulog_stream_interval_set, "%llu\n");
+
+static const struct file_operations bm_ulog_stream_fops = {
+	.open			= bm_ulog_stream_open,
+	.read			= bm_ulog_stream_read,
+	.poll			= bm_ulog_stream_poll,
+	.llseek			= no_llseek,
+};
+
 static void bm_ulog_add_debugfs(struct bm_ulog_dev *bmdev)
 {
 	int rc;
@@ -392,6 +592,9 @@ static void bm_ulog_add_debugfs(struct bm_ulog_dev *bmdev)
 
 	debugfs_create_x64("categories", 0664, dir, &bmdev->categories);
 	debugfs_create_x32("level", 0664, dir, &bmdev->level);
+	debugfs_create_file("stream", 0444, dir, bmdev, &bm_ulog_stream_fops);
+	debugfs_create_file_unsafe("stream_interval_ms", 0664, dir, bmdev,
+				   &bm_ulog_stream_interval_fops);
 
 	bmdev->debugfs_dir = dir;
 }
@@ -417,6 +620,10 @@ static int bm_ulog_probe(struct platform_device *pdev)
 	if (rc)
 		bmdev->level = BM_LOG_LEVEL_INFO;
 
+	bmdev->ring = devm_kzalloc(&pdev->dev, BM_ULOG_RING_SIZE, GFP_KERNEL);
+	if (!bmdev->ring)
+		return -ENOMEM;
+
 	bmdev->dev = &pdev->dev;
 	client_data.id = MSG_OWNER_BC;
 	client_data.name = "battery_manager_adsp_ulog";
@@ -432,7 +639,18 @@ static int bm_ulog_probe(struct platform_device *pdev)
 		return rc;
 	}
 
+	bmdev->stream_wq = alloc_ordered_workqueue("bm_ulog_stream", 0);
+	if (!bmdev->stream_wq) {
+		pmic_glink_unregister_client(bmdev->client);
+		return -ENOMEM;
+	}
+
 	mutex_init(&bmdev->lock);
+	mutex_init(&bmdev->buf_lock);
+	mutex_init(&bmdev->ring_lock);
+	spin_lock_init(&bmdev->stream_lock);
+	init_waitqueue_head(&bmdev->ring_wq);
+	INIT_DELAYED_WORK(&bmdev->stream_work, bm_ulog_stream_work);
 	init_completion(&bmdev->ack);
 	platform_set_drvdata(pdev, bmdev);
 	bmdev->debug_enabled = &debug_enabled;
@@ -454,14 +672,25 @@ static int bm_ulog_remove(struct platform_device *pdev)
 	struct bm_ulog_dev *bmdev = platform_get_drvdata(pdev);
 	int rc;
 
-	ipc_log_context_destroy(bmdev->ipc_log);
+	g_bmdev = NULL;
+
+	/*
+	 * debugfs removal waits for the file operations in flight, wake the
+	 * stream readers first. Once the files are gone nothing can restart
+	 * the work through stream_interval_ms.
+	 */
+	WRITE_ONCE(bmdev->removing, true);
+	wake_up_interruptible(&bmdev->ring_wq);
 	debugfs_remove_recursive(bmdev->debugfs_dir);
+	bmdev->stream_interval_ms = 0;
+	cancel_delayed_work_sync(&bmdev->stream_work);
+	destroy_workqueue(bmdev->stream_wq);
+	ipc_log_context_destroy(bmdev->ipc_log);
 	rc = pmic_glink_unregister_client(bmdev->client);
 	if (rc < 0) {
 		pr_err("Error unregistering from pmic_glink, rc=%d\n", rc);
 		return rc;
 	}
-	g_bmdev = NULL;
 
 	return 0;
 }
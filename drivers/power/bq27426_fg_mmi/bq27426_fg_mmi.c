@@ -41,6 +41,7 @@
 #include <linux/alarmtimer.h>
 #include "bqfs_cmd_type.h"
 #include <linux/regmap.h>
+#include <linux/power/fg_snapshot.h>
 #include <linux/regulator/driver.h>
 #include <linux/regulator/of_regulator.h>
 #include <linux/regulator/machine.h>
@@ -116,6 +117,11 @@ module_param_named(
 #define	INVALID_REG_ADDR	0xFF
 #define BQFS_UPDATE_KEY		0x8F91
 
+/* Standard commands from Temperature (0x02) to OCV voltage (0x24) */
+#define	FG_SNAPSHOT_BASE	0x02
+#define	FG_SNAPSHOT_LEN		36
+#define	FG_SNAPSHOT_MS		500
+
 #define	FG_FLAGS_OT					BIT(15)
 #define	FG_FLAGS_UT					BIT(14)
 #define	FG_FLAGS_FC					BIT(9)
@@ -276,6 +282,7 @@ struct bq_fg_chip {
 	struct mutex update_lock;
 	struct mutex irq_complete;
 	struct regmap		*regmap;
+	struct fg_snapshot	snap;
 
 	bool irq_waiting;
 	bool irq_disabled;
@@ -284,6 +291,7 @@ struct bq_fg_chip {
 	int	 force_update;
 	int	 fw_ver;
 	int	 df_ver;
+	int	 dm_ver;	/* cached DM code, -1 until read */
 
 	u8	chip;
 	u8	regs[NUM_REGS];
@@ -554,6 +562,26 @@ static int fg_write_block(struct bq_fg_chip *bq, u8 reg, u8 *data, u8 len)
 	return ret;
 }
 
+static int fg_snapshot_read(void *priv, u8 reg, u8 *buf, int len)
+{
+	struct bq_fg_chip *bq = priv;
+
+	/* Let fg_read_word() handle the skip */
+	if (bq->skip_reads)
+		return -EPERM;
+
+	return fg_read_block(bq, reg, buf, len);
+}
+
+/* Standard command read, served from the snapshot when it covers reg */
+static int fg_read_cmd(struct bq_fg_chip *bq, u8 reg, u16 *val)
+{
+	if (!fg_snapshot_read_word(&bq->snap, reg, val))
+		return 0;
+
+	return fg_read_word(bq, reg, val);
+}
+
 #define	CTRL_REG					0x00
 
 #define	FG_DFT_UNSEAL_KEY1				0x80008000
@@ -789,6 +817,12 @@ static int fg_read_dm_version(struct bq_fg_chip* bq, u8 *ver)
 	int ret;
 	u16 dm_code = 0;
 
+	/* DM code only changes with a bqfs update, which drops the cache */
+	if (bq->dm_ver >= 0) {
+		*ver = bq->dm_ver;
+		return 0;
+	}
+
 	ret = fg_write_word(bq, bq->regs[BQ_FG_REG_CTRL],
 								FG_SUBCMD_DM_CODE);
 	if (ret < 0) {
@@ -799,8 +833,10 @@ static int fg_read_dm_version(struct bq_fg_chip* bq, u8 *ver)
 	msleep(5);
 
 	ret = fg_read_word(bq, bq->regs[BQ_FG_REG_CTRL], &dm_code);
-	if (!ret)
+	if (!ret) {
 		*ver = dm_code & 0xFF;
+		bq->dm_ver = *ver;
+	}
 	return ret;
 }
 
@@ -1030,7 +1066,7 @@ static int fg_read_status(struct bq_fg_chip *bq)
 	int ret;
 	u16 flags;
 
-	ret = fg_read_word(bq, bq->regs[BQ_FG_REG_FLAGS], &flags);
+	ret = fg_read_cmd(bq, bq->regs[BQ_FG_REG_FLAGS], &flags);
 	if (ret < 0) {
 		return ret;
 	}
@@ -1057,7 +1093,7 @@ static int fg_read_rsoc(struct bq_fg_chip *bq)
 	int ret;
 	u16 soc = 0;
 
-	ret = fg_read_word(bq, bq->regs[BQ_FG_REG_SOC], &soc);
+	ret = fg_read_cmd(bq, bq->regs[BQ_FG_REG_SOC], &soc);
 	if (ret < 0) {
 		mmi_fg_err(bq, "could not read RSOC, ret = %d\n", ret);
 		return ret;
@@ -1072,7 +1108,7 @@ static int fg_read_temperature(struct bq_fg_chip *bq)
 	int ret;
 	u16 temp = 0;
 
-	ret = fg_read_word(bq, bq->regs[BQ_FG_REG_TEMP], &temp);
+	ret = fg_read_cmd(bq, bq->regs[BQ_FG_REG_TEMP], &temp);
 	if (ret < 0) {
 		mmi_fg_err(bq, "could not read temperature, ret = %d\n", ret);
 		return ret;
@@ -1087,7 +1123,7 @@ static int fg_read_ocv_voltage(struct bq_fg_chip *bq)
 	int ret;
 	u16 vocv = 0;
 
-	ret = fg_read_word(bq, bq->regs[BQ_FG_REG_VOCV], &vocv);
+	ret = fg_read_cmd(bq, bq->regs[BQ_FG_REG_VOCV], &vocv);
 	if (ret < 0) {
 		mmi_fg_err(bq, "could not read ocv voltage, ret = %d\n", ret);
 		return ret;
@@ -1102,7 +1138,7 @@ static int fg_read_volt(struct bq_fg_chip *bq)
 	int ret;
 	u16 volt = 0;
 
-	ret = fg_read_word(bq, bq->regs[BQ_FG_REG_VOLT], &volt);
+	ret = fg_read_cmd(bq, bq->regs[BQ_FG_REG_VOLT], &volt);
 	if (ret < 0) {
 		mmi_fg_err(bq, "could not read voltage, ret = %d\n", ret);
 		return ret;
@@ -1117,7 +1153,7 @@ static int fg_read_current(struct bq_fg_chip *bq, int *curr)
 	int ret;
 	u16 avg_curr = 0;
 
-	ret = fg_read_word(bq, bq->regs[BQ_FG_REG_AI], &avg_curr);
+	ret = fg_read_cmd(bq, bq->regs[BQ_FG_REG_AI], &avg_curr);
 	if (ret < 0) {
 		mmi_fg_err(bq, "could not read current, ret = %d\n", ret);
 		return ret;
@@ -1137,7 +1173,7 @@ static int fg_read_fcc(struct bq_fg_chip *bq)
 		return 0;
 	}
 
-	ret = fg_read_word(bq, bq->regs[BQ_FG_REG_FCC], &fcc);
+	ret = fg_read_cmd(bq, bq->regs[BQ_FG_REG_FCC], &fcc);
 
 	if (ret < 0) {
 		mmi_fg_err(bq, "could not read FCC, ret=%d\n", ret);
@@ -1157,7 +1193,7 @@ static int fg_read_dc(struct bq_fg_chip *bq)
 		return 0;
 	}
 
-	ret = fg_read_word(bq, bq->regs[BQ_FG_REG_DC], &dc);
+	ret = fg_read_cmd(bq, bq->regs[BQ_FG_REG_DC], &dc);
 
 	if (ret < 0) {
 		mmi_fg_err(bq, "could not read DC, ret=%d\n", ret);
@@ -1178,7 +1214,7 @@ static int fg_read_rm(struct bq_fg_chip *bq)
 		return 0;
 	}
 
-	ret = fg_read_word(bq, bq->regs[BQ_FG_REG_RM], &rm);
+	ret = fg_read_cmd(bq, bq->regs[BQ_FG_REG_RM], &rm);
 
 	if (ret < 0) {
 		mmi_fg_err(bq, "could not read DC, ret=%d\n", ret);
@@ -1199,7 +1235,7 @@ static int fg_read_cyclecount(struct bq_fg_chip *bq)
 		return -1;
 	}
 
-	ret = fg_read_word(bq, bq->regs[BQ_FG_REG_CC], &cc);
+	ret = fg_read_cmd(bq, bq->regs[BQ_FG_REG_CC], &cc);
 
 	if (ret < 0) {
 		mmi_fg_err(bq, "could not read Cycle Count, ret=%d\n", ret);
@@ -1219,7 +1255,7 @@ static int fg_read_tte(struct bq_fg_chip *bq)
 		return -1;
 	}
 
-	ret = fg_read_word(bq, bq->regs[BQ_FG_REG_TTE], &tte);
+	ret = fg_read_cmd(bq, bq->regs[BQ_FG_REG_TTE], &tte);
 
 	if (ret < 0) {
 		mmi_fg_err(bq, "could not read Time To Empty, ret=%d\n", ret);
@@ -1290,7 +1326,7 @@ static int fg_read_soh(struct bq_fg_chip *bq)
 	int ret;
 	u16 soh = 0;
 
-	ret = fg_read_word(bq, bq->regs[BQ_FG_REG_SOH], &soh);
+	ret = fg_read_cmd(bq, bq->regs[BQ_FG_REG_SOH], &soh);
 	if (ret < 0) {
 		mmi_fg_err(bq, "could not read state of health, ret = %d\n", ret);
 		return ret;
@@ -1775,9 +1811,12 @@ void fg_update_bqfs(struct bq_fg_chip *bq)
 			bq->batt_id);
 
 	mutex_lock(&bq->update_lock);
+	bq->dm_ver = -1;
+	fg_snapshot_invalidate(&bq->snap);
 	image = bqfs_image[bq->batt_id].bqfs_image;
 	for (i = 0; i < bqfs_image[bq->batt_id].array_size; i++) {
 		if (!fg_update_bqfs_execute_cmd(bq, &image[i])) {
+			fg_snapshot_invalidate(&bq->snap);
 			mutex_unlock(&bq->update_lock);
 			mmi_fg_err(bq, "Failed at command: %d\n", i);
 			fg_dm_post_access(bq);
@@ -1785,6 +1824,7 @@ void fg_update_bqfs(struct bq_fg_chip *bq)
 		}
 		mdelay(5);
 	}
+	fg_snapshot_invalidate(&bq->snap);
 	mutex_unlock(&bq->update_lock);
 
 	mmi_fg_err(bq, "Done!\n");
@@ -1874,6 +1914,18 @@ static void create_debugfs_entry(struct bq_fg_chip *bq)
 					  S_IFREG | S_IWUSR | S_IRUGO,
 					  bq->debug_root,
 					  &(bq->skip_writes));
+
+		/* 0 reads every standard command from the device */
+		debugfs_create_u32("snapshot_ms",
+					  S_IFREG | S_IWUSR | S_IRUGO,
+					  bq->debug_root,
+					  &(bq->snap.max_age_ms));
+		debugfs_create_u32("snapshot_reads", S_IFREG | S_IRUGO,
+					  bq->debug_root,
+					  &(bq->snap.reads));
+		debugfs_create_u32("snapshot_hits", S_IFREG | S_IRUGO,
+					  bq->debug_root,
+					  &(bq->snap.hits));
 	}
 }
 
@@ -2273,6 +2325,8 @@ static irqreturn_t fg_irq_thread(int irq, void *dev_id)
 	}
 	bq->irq_waiting = false;
 
+	/* The gauge signals a change, do not serve it from the snapshot */
+	fg_snapshot_invalidate(&bq->snap);
 	last_batt_present = bq->batt_present;
 
 	mutex_lock(&bq->update_lock);
@@ -2463,6 +2517,9 @@ static int bq_fg_probe(struct i2c_client *client,
 	mutex_init(&bq->data_lock);
 	mutex_init(&bq->update_lock);
 	mutex_init(&bq->irq_complete);
+	fg_snapshot_init(&bq->snap, FG_SNAPSHOT_BASE, FG_SNAPSHOT_LEN,
+			 FG_SNAPSHOT_MS, fg_snapshot_read, bq);
+	bq->dm_ver = -1;
 
 	bq->resume_completed = true;
 	bq->irq_waiting = false;
@@ -2583,6 +2640,9 @@ static int bq_fg_resume(struct device *dev)
 	struct i2c_client *client = to_i2c_client(dev);
 	struct bq_fg_chip *bq = i2c_get_clientdata(client);
 
+	/* jiffies did not advance while suspended */
+	fg_snapshot_invalidate(&bq->snap);
+
 	mutex_lock(&bq->irq_complete);
 	bq->resume_completed = true;
 	if (bq->irq_waiting) {
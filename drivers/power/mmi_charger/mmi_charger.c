@@ -25,6 +25,11 @@
 #include <linux/string.h>
 #include <linux/mutex.h>
 #include <linux/delay.h>
+#include <linux/bitmap.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/ctype.h>
 #include <linux/mmi_wake_lock.h>
 #include <soc/qcom/mmi_boot_info.h>
 
@@ -41,7 +46,11 @@
 #define HEARTBEAT_DELAY_MS 60000
 #define HEARTBEAT_FACTORY_MS 1000
 #define HEARTBEAT_DISCHARGE_MS 100000
+#define HEARTBEAT_DISCHARGE_MAX_MS 600000
+#define HEARTBEAT_DISCHARGE_LOW_SOC 15
 #define HEARTBEAT_WAKEUP_INTRVAL_NS 70000000000
+#define HEARTBEAT_FAST_MS 10000
+#define HEARTBEAT_COALESCE_MS 50
 
 static bool debug_enabled;
 module_param(debug_enabled, bool, 0600);
@@ -90,6 +99,35 @@ struct mmi_temp_zone {
         int fcc_norm_ma;
 };
 
+/*
+ * Zones sharing a temperature: vbat below band_mv[i] selects band_zone[i],
+ * above all of them the last band.
+ */
+struct mmi_temp_group {
+	int temp_c;
+	int num_bands;
+	int band_mv[MAX_NUM_TEMP_ZONE];
+	u8 band_zone[MAX_NUM_TEMP_ZONE + 1];
+};
+
+/* Thresholds out of a zone, indexed by the band of the next group */
+struct mmi_temp_step {
+	int group;
+	int hotter_t[MAX_NUM_TEMP_ZONE + 1];
+	int colder_t[MAX_NUM_TEMP_ZONE + 1];
+};
+
+/* Temp zones compiled at probe, so that a lookup does not walk them */
+struct mmi_temp_map {
+	int num_groups;
+	struct mmi_temp_group groups[MAX_NUM_TEMP_ZONE];
+	struct mmi_temp_step steps[MAX_NUM_TEMP_ZONE];
+	/* Group holding each degree from bucket_min_c, or ZONE_COLD */
+	int bucket_min_c;
+	int num_buckets;
+	u8 *buckets;
+};
+
 enum mmi_chrg_step {
 	STEP_MAX,
 	STEP_NORM,
@@ -148,6 +186,7 @@ struct mmi_charger_profile {
         int demo_fv_mv;
         int num_temp_zones;
         struct mmi_temp_zone *temp_zones;
+	struct mmi_temp_map *temp_map;
 	int num_ffc_zones;
 	struct mmi_ffc_zone *ffc_zones;
 };
@@ -174,10 +213,31 @@ struct mmi_charger {
 };
 
 #define MMI_VOTE_NUM_MAX 32
+#define MMI_VOTE_HISTORY 16
+
+struct mmi_charger_chip;
+struct mmi_sim;
+
+struct mmi_vote_event {
+	ktime_t time;
+	int voter;
+	bool enabled;
+	int value;
+};
+
+/*
+ * Votes are indexed by voter id, interned once per voter name in the chip,
+ * and the winner (lowest value) is kept up to date as votes come and go.
+ */
 struct mmi_vote {
 	const char *name;
 	int votes[MMI_VOTE_NUM_MAX];
-	const char *voters[MMI_VOTE_NUM_MAX];
+	DECLARE_BITMAP(enabled, MMI_VOTE_NUM_MAX);
+	int win_voter;
+	/* Called when the effective result changes */
+	void (*callback)(struct mmi_charger_chip *chip, struct mmi_vote *vote);
+	struct mmi_vote_event history[MMI_VOTE_HISTORY];
+	int history_idx;
 };
 
 #define IS_SUSPENDED BIT(0)
@@ -234,19 +294,128 @@ struct mmi_charger_chip {
 	struct notifier_block	mmi_reboot;
 	struct notifier_block	mmi_psy_notifier;
 	struct delayed_work	heartbeat_work;
+	int			hb_soc;
+	unsigned long		hb_soc_jiffies;
+	int			hb_soc_ms;
+	bool			hb_soc_discharging;
 
 	bool			*debug_enabled;
 	void			*ipc_log;
 
+	struct mutex		vote_lock;
+	const char		*voters[MMI_VOTE_NUM_MAX];
+	int			num_voters;
+	int			user_voter;
 	struct mmi_vote		suspend_charger_vote;
 	struct mmi_vote		disable_charging_vote;
+	struct dentry		*debug_root;
+#ifdef MMI_CHARGER_SIMULATOR
+	struct mmi_sim		*sim;
+	/* Private chip of the simulator, see mmi_sim_start() */
+	bool			sim_env;
+#endif
 };
 
-static int mmi_vote(struct mmi_vote *vote, const char *voter,
-				bool enabled, int value)
+#ifdef MMI_CHARGER_SIMULATOR
+/* The policy lines of simulated heartbeats only go to the debug log */
+#define mmi_policy_info(chip, fmt, ...)				\
+	do {							\
+		if ((chip)->sim_env)				\
+			mmi_dbg(chip, fmt, ##__VA_ARGS__);	\
+		else						\
+			mmi_info(chip, fmt, ##__VA_ARGS__);	\
+	} while (0)
+#else
+#define mmi_policy_info mmi_info
+#endif
+
+/*
+ * Run the heartbeat shortly, folding a burst of requests into one run:
+ * a run already due within the coalescing window is left as is.
+ */
+static void mmi_heartbeat_kick(struct mmi_charger_chip *chip)
+{
+	unsigned long delay = msecs_to_jiffies(HEARTBEAT_COALESCE_MS);
+
+	if (delayed_work_pending(&chip->heartbeat_work) &&
+	    time_before_eq(chip->heartbeat_work.timer.expires,
+			   jiffies + delay))
+		return;
+
+	mod_delayed_work(system_wq, &chip->heartbeat_work, delay);
+}
+
+/* Voter names are copied, voters may live in modules going away */
+static int mmi_voter_id(struct mmi_charger_chip *chip, const char *voter)
 {
 	int i;
-	int empty = -EINVAL;
+
+	for (i = 0; i < chip->num_voters; i++) {
+		if (!strcmp(chip->voters[i], voter))
+			return i;
+	}
+
+	if (chip->num_voters >= MMI_VOTE_NUM_MAX)
+		return -ENOENT;
+
+	chip->voters[chip->num_voters] = kstrdup_const(voter, GFP_KERNEL);
+	if (!chip->voters[chip->num_voters])
+		return -ENOMEM;
+
+	return chip->num_voters++;
+}
+
+static void mmi_vote_update_winner(struct mmi_vote *vote)
+{
+	int i;
+	int win_voter = -EINVAL;
+	int win_vote = INT_MAX;
+
+	for_each_set_bit(i, vote->enabled, MMI_VOTE_NUM_MAX) {
+		if (vote->votes[i] < win_vote) {
+			win_voter = i;
+			win_vote = vote->votes[i];
+		}
+	}
+
+	WRITE_ONCE(vote->win_voter, win_voter);
+}
+
+static void mmi_vote_init(struct mmi_vote *vote, const char *name,
+		void (*callback)(struct mmi_charger_chip *chip,
+				 struct mmi_vote *vote))
+{
+	vote->name = name;
+	vote->win_voter = -EINVAL;
+	vote->callback = callback;
+}
+
+/* Registers a voter once, the id returned is what it votes with */
+static int mmi_voter_register_chip(struct mmi_charger_chip *chip,
+				const char *voter)
+{
+	int id;
+
+	if (!voter) {
+		mmi_err(chip, "Invalid voter\n");
+		return -EINVAL;
+	}
+
+	mutex_lock(&chip->vote_lock);
+	id = mmi_voter_id(chip, voter);
+	mutex_unlock(&chip->vote_lock);
+	if (id < 0)
+		mmi_err(chip, "Failed to register voter %s, rc=%d\n", voter, id);
+
+	return id;
+}
+
+static int mmi_vote(struct mmi_vote *vote, int id, bool enabled, int value)
+{
+	int win_voter;
+	int win_vote;
+	bool changed;
+	struct mmi_vote_event *event;
 	struct mmi_charger_chip *chip = this_chip;
 
 	if (!chip) {
@@ -254,63 +423,121 @@ static int mmi_vote(struct mmi_vote *vote, const char *voter,
 		return -ENODEV;
 	}
 
-	if (!voter) {
-		mmi_err(chip, "%s: Invalid voter\n", vote->name);
+	mutex_lock(&chip->vote_lock);
+	if (id < 0 || id >= chip->num_voters) {
+		mutex_unlock(&chip->vote_lock);
+		mmi_err(chip, "%s: Invalid voter %d\n", vote->name, id);
 		return -EINVAL;
 	}
 
-	for (i = 0; i < MMI_VOTE_NUM_MAX; i++) {
-		if (vote->voters[i] &&
-		    !strcmp(vote->voters[i], voter)) {
-			break;
-		} else if (empty < 0 && !vote->voters[i]) {
-			empty = i;
-		}
+	if (!enabled && !test_bit(id, vote->enabled)) {
+		mutex_unlock(&chip->vote_lock);
+		return 0;
 	}
 
-	if (i < MMI_VOTE_NUM_MAX) {
-		if (enabled) {
-			vote->voters[i] = voter;
-			vote->votes[i] = value;
-		} else {
-			vote->voters[i] = NULL;
-			vote->votes[i] = 0;
-		}
+	win_voter = vote->win_voter;
+	win_vote = win_voter < 0 ? 0 : vote->votes[win_voter];
+	if (enabled) {
+		set_bit(id, vote->enabled);
+		vote->votes[id] = value;
+		if (win_voter < 0 || value < win_vote)
+			WRITE_ONCE(vote->win_voter, id);
+		else if (id == win_voter && value > win_vote)
+			mmi_vote_update_winner(vote);
 	} else {
-		if (!enabled) {
-			return 0;
-		} else if (empty < 0) {
-			mmi_err(this_chip, "No entry found\n");
-			return -ENOENT;
-		} else {
-			vote->voters[empty] = voter;
-			vote->votes[empty] = value;
-		}
+		clear_bit(id, vote->enabled);
+		vote->votes[id] = 0;
+		if (id == win_voter)
+			mmi_vote_update_winner(vote);
 	}
 
+	if ((vote->win_voter < 0) != (win_voter < 0))
+		changed = true;
+	else
+		changed = vote->win_voter >= 0 &&
+			  vote->votes[vote->win_voter] != win_vote;
+
+	event = &vote->history[vote->history_idx];
+	event->time = ktime_get_boottime();
+	event->voter = id;
+	event->enabled = enabled;
+	event->value = value;
+	vote->history_idx = (vote->history_idx + 1) % MMI_VOTE_HISTORY;
+	mutex_unlock(&chip->vote_lock);
+
 	mmi_info(chip, "%s:%s voter: en:%d, val:%d\n",
-			vote->name, voter, enabled, value);
+			vote->name, chip->voters[id], enabled, value);
+
+	if (changed && vote->callback)
+		vote->callback(chip, vote);
 
 	return 0;
 }
 
 static int mmi_get_effective_voter(struct mmi_vote *vote)
+{
+	return READ_ONCE(vote->win_voter);
+}
+
+static void mmi_heartbeat_vote_callback(struct mmi_charger_chip *chip,
+					struct mmi_vote *vote)
+{
+	mmi_heartbeat_kick(chip);
+}
+
+static void mmi_vote_show(struct seq_file *m, struct mmi_charger_chip *chip,
+			  struct mmi_vote *vote)
 {
 	int i;
-	int win_voter = -EINVAL;
-	int win_vote = INT_MAX;
+	int win_voter = vote->win_voter;
+	struct mmi_vote_event *event;
 
-	for (i = 0; i < MMI_VOTE_NUM_MAX; i++) {
-		if (vote->voters[i] &&
-		    vote->votes[i] < win_vote) {
-			win_voter = i;
-			win_vote = vote->votes[i];
-		}
+	if (win_voter < 0)
+		seq_printf(m, "%s: no vote\n", vote->name);
+	else
+		seq_printf(m, "%s: %s=%d\n", vote->name,
+			   chip->voters[win_voter], vote->votes[win_voter]);
+
+	for_each_set_bit(i, vote->enabled, MMI_VOTE_NUM_MAX)
+		seq_printf(m, "\t%s=%d\n", chip->voters[i], vote->votes[i]);
+
+	seq_puts(m, "\thistory:\n");
+	for (i = 0; i < MMI_VOTE_HISTORY; i++) {
+		event = &vote->history[(vote->history_idx + i) %
+				       MMI_VOTE_HISTORY];
+		if (!event->time)
+			continue;
+		seq_printf(m, "\t%lld %s en:%d val:%d\n",
+			   ktime_to_ms(event->time), chip->voters[event->voter],
+			   event->enabled, event->value);
 	}
+}
+
+static int mmi_votes_show(struct seq_file *m, void *data)
+{
+	struct mmi_charger_chip *chip = m->private;
+
+	mutex_lock(&chip->vote_lock);
+	mmi_vote_show(m, chip, &chip->disable_charging_vote);
+	mmi_vote_show(m, chip, &chip->suspend_charger_vote);
+	mutex_unlock(&chip->vote_lock);
+
+	return 0;
+}
 
-	return win_voter;
+static int mmi_votes_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, mmi_votes_show, inode->i_private);
 }
 
+static const struct file_operations mmi_votes_fops = {
+	.owner		= THIS_MODULE,
+	.open		= mmi_votes_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static void mmi_notify_charger_event(struct mmi_charger_chip *chip, int type);
 static ssize_t state_sync_store(struct device *dev,
 				struct device_attribute *attr,
@@ -339,9 +566,7 @@ static ssize_t state_sync_store(struct device *dev,
 		mmi_notify_charger_event(this_chip,
 					NOTIFY_EVENT_TYPE_VBUS_PRESENT);
 		mutex_unlock(&this_chip->charger_lock);
-		cancel_delayed_work(&this_chip->heartbeat_work);
-		schedule_delayed_work(&this_chip->heartbeat_work,
-					msecs_to_jiffies(0));
+		mmi_heartbeat_kick(this_chip);
 		mmi_info(this_chip, "charger state sync received\n");
 	}
 
@@ -377,9 +602,7 @@ static ssize_t dcp_pmax_store(struct device *dev,
 	if (this_chip->dcp_pmax != pmax &&
 	    (pmax >= CHARGER_POWER_5W && pmax <= CHARGER_POWER_10W)) {
 		this_chip->dcp_pmax = pmax;
-		cancel_delayed_work(&this_chip->heartbeat_work);
-		schedule_delayed_work(&this_chip->heartbeat_work,
-				      msecs_to_jiffies(0));
+		mmi_heartbeat_kick(this_chip);
 	}
 
 	return r ? r : count;
@@ -422,9 +645,7 @@ static ssize_t hvdcp_pmax_store(struct device *dev,
 	if (this_chip->hvdcp_pmax != pmax &&
 	    (pmax >= CHARGER_POWER_7P5W && pmax <= CHARGER_POWER_MAX)) {
 		this_chip->hvdcp_pmax = pmax;
-		cancel_delayed_work(&this_chip->heartbeat_work);
-		schedule_delayed_work(&this_chip->heartbeat_work,
-				      msecs_to_jiffies(0));
+		mmi_heartbeat_kick(this_chip);
 	}
 
 	return r ? r : count;
@@ -467,9 +688,7 @@ static ssize_t pd_pmax_store(struct device *dev,
 	if (this_chip->pd_pmax != pmax &&
 	    (pmax >= CHARGER_POWER_15W && pmax <= CHARGER_POWER_MAX)) {
 		this_chip->pd_pmax = pmax;
-		cancel_delayed_work(&this_chip->heartbeat_work);
-		schedule_delayed_work(&this_chip->heartbeat_work,
-				      msecs_to_jiffies(0));
+		mmi_heartbeat_kick(this_chip);
 	}
 
 	return r ? r : count;
@@ -512,9 +731,7 @@ static ssize_t wls_pmax_store(struct device *dev,
 	if (this_chip->wls_pmax != pmax &&
 	    (pmax >= CHARGER_POWER_5W && pmax <= CHARGER_POWER_MAX)) {
 		this_chip->wls_pmax = pmax;
-		cancel_delayed_work(&this_chip->heartbeat_work);
-		schedule_delayed_work(&this_chip->heartbeat_work,
-				      msecs_to_jiffies(0));
+		mmi_heartbeat_kick(this_chip);
 	}
 
 	return r ? r : count;
@@ -760,8 +977,7 @@ static ssize_t force_charger_suspend_store(struct device *dev,
 	}
 
 	this_chip->force_charger_disabled = (mode) ? true : false;
-	cancel_delayed_work(&this_chip->heartbeat_work);
-	schedule_delayed_work(&this_chip->heartbeat_work, msecs_to_jiffies(0));
+	mmi_heartbeat_kick(this_chip);
 	mmi_info(this_chip, "%s force_charger_disabled\n", (mode)? "set" : "clear");
 
 	return count;
@@ -806,8 +1022,7 @@ static ssize_t force_charging_enable_store(struct device *dev,
 	}
 
 	this_chip->force_charging_enabled = (mode) ? true : false;
-	cancel_delayed_work(&this_chip->heartbeat_work);
-	schedule_delayed_work(&this_chip->heartbeat_work, msecs_to_jiffies(0));
+	mmi_heartbeat_kick(this_chip);
 	mmi_info(this_chip, "%s force_charging_enabled\n", (mode)? "set" : "clear");
 
 	return count;
@@ -835,9 +1050,8 @@ static ssize_t force_charging_disable_store(struct device *dev,
 		return -EINVAL;
 	}
 
-	mmi_vote_charging_disable("MMI_USER", !!mode);
-	cancel_delayed_work(&this_chip->heartbeat_work);
-	schedule_delayed_work(&this_chip->heartbeat_work, msecs_to_jiffies(0));
+	mmi_vote_charging_disable_id(this_chip->user_voter, !!mode);
+	mmi_heartbeat_kick(this_chip);
 	mmi_info(this_chip, "%s force_charging_disable\n", (mode)? "set" : "clear");
 
 	return count;
@@ -916,6 +1130,140 @@ static void mmi_battery_supply_init(struct mmi_charger_chip *chip)
 	mmi_info(chip, "battery supply is initialized\n");
 }
 
+/* First zone of the group whose norm_mv is above vbat, else the last one */
+static int mmi_temp_group_zone(struct mmi_temp_zone *zones, int first,
+				int last, int vbat_mv)
+{
+	int i;
+
+	for (i = first; i < last; i++) {
+		if (vbat_mv < zones[i].norm_mv)
+			break;
+	}
+
+	return i;
+}
+
+static int mmi_temp_band(const struct mmi_temp_group *group, int vbat_mv)
+{
+	int i = 0;
+
+	while (i < group->num_bands && vbat_mv >= group->band_mv[i])
+		i++;
+
+	return i;
+}
+
+static int mmi_compile_temp_zones(struct mmi_charger_chip *chip,
+				struct mmi_charger *charger)
+{
+	int i, j, k, b;
+	int g, t, fcc, next_fcc;
+	int num_zones = charger->profile.num_temp_zones;
+	struct mmi_temp_zone *zones = charger->profile.temp_zones;
+	struct mmi_temp_group *group;
+	struct mmi_temp_step *step;
+	struct mmi_temp_map *map;
+
+	if (!num_zones || num_zones > MAX_NUM_TEMP_ZONE)
+		return -EINVAL;
+
+	for (i = 1; i < num_zones; i++) {
+		if (zones[i].temp_c < zones[i - 1].temp_c)
+			return -EINVAL;
+	}
+
+	map = devm_kzalloc(chip->dev, sizeof(*map), GFP_KERNEL);
+	if (!map)
+		return -ENOMEM;
+
+	/* Split each group at the distinct norm_mv of its zones */
+	for (i = 0; i < num_zones; i = j) {
+		group = &map->groups[map->num_groups];
+		group->temp_c = zones[i].temp_c;
+		for (j = i; j < num_zones && zones[j].temp_c == group->temp_c;
+		     j++) {
+			map->steps[j].group = map->num_groups;
+			for (k = 0; k < group->num_bands; k++) {
+				if (group->band_mv[k] >= zones[j].norm_mv)
+					break;
+			}
+			if (k < group->num_bands &&
+			    group->band_mv[k] == zones[j].norm_mv)
+				continue;
+			memmove(&group->band_mv[k + 1], &group->band_mv[k],
+				(group->num_bands - k) * sizeof(int));
+			group->band_mv[k] = zones[j].norm_mv;
+			group->num_bands++;
+		}
+
+		for (b = 0; b < group->num_bands; b++)
+			group->band_zone[b] = mmi_temp_group_zone(zones, i,
+						j - 1, group->band_mv[b] - 1);
+		group->band_zone[b] = mmi_temp_group_zone(zones, i, j - 1,
+						group->band_mv[b - 1]);
+		map->num_groups++;
+	}
+
+	/* Hysteresis applies when moving to a zone allowing more current */
+	for (i = 0; i < num_zones; i++) {
+		step = &map->steps[i];
+		g = step->group;
+		fcc = zones[i].fcc_max_ma;
+
+		if (g + 1 < map->num_groups) {
+			group = &map->groups[g + 1];
+			for (b = 0; b <= group->num_bands; b++) {
+				next_fcc = zones[group->band_zone[b]].fcc_max_ma;
+				step->hotter_t[b] = zones[i].temp_c +
+					(fcc < next_fcc ? HYSTERESIS_DEGC : 0);
+			}
+		} else {
+			step->hotter_t[0] = zones[i].temp_c;
+		}
+
+		if (g > 0) {
+			group = &map->groups[g - 1];
+			for (b = 0; b <= group->num_bands; b++) {
+				next_fcc = zones[group->band_zone[b]].fcc_max_ma;
+				step->colder_t[b] = group->temp_c -
+					(fcc < next_fcc ? HYSTERESIS_DEGC : 0);
+			}
+		} else {
+			step->colder_t[0] = MIN_TEMP_C;
+		}
+	}
+
+	/* Degree t belongs to the first group above it */
+	map->bucket_min_c = min(MIN_TEMP_C, map->groups[0].temp_c);
+	map->num_buckets = map->groups[map->num_groups - 1].temp_c -
+				map->bucket_min_c;
+	if (map->num_buckets) {
+		map->buckets = devm_kzalloc(chip->dev, map->num_buckets,
+					    GFP_KERNEL);
+		if (!map->buckets) {
+			devm_kfree(chip->dev, map);
+			return -ENOMEM;
+		}
+	}
+
+	for (i = 0, g = 0; i < map->num_buckets; i++) {
+		t = map->bucket_min_c + i;
+		while (t >= map->groups[g].temp_c)
+			g++;
+		if (!g && t < MIN_TEMP_C)
+			map->buckets[i] = ZONE_COLD;
+		else
+			map->buckets[i] = g;
+	}
+
+	charger->profile.temp_map = map;
+	mmi_info(chip, "[C:%s]: mmi temp zones: %d groups, %d buckets\n",
+		charger->driver->name, map->num_groups, map->num_buckets);
+
+	return 0;
+}
+
 static int mmi_get_charger_profile(struct mmi_charger_chip *chip,
 				struct mmi_charger *charger)
 {
@@ -1001,6 +1349,16 @@ static int mmi_get_charger_profile(struct mmi_charger_chip *chip,
 				charger->profile.temp_zones[i].fcc_max_ma,
 				charger->profile.temp_zones[i].fcc_norm_ma);
 		}
+
+		rc = mmi_compile_temp_zones(chip, charger);
+		if (rc < 0) {
+			mmi_err(chip, "[C:%s]: Couldn't compile mmi temp zones rc = %d\n",
+					charger->driver->name, rc);
+			devm_kfree(chip->dev, charger->profile.temp_zones);
+			charger->profile.temp_zones = NULL;
+			charger->profile.num_temp_zones = 0;
+			return rc;
+		}
 	}
 
 	if (of_find_property(node, "mmi,mmi-ffc-zones", &byte_len)) {
@@ -1078,110 +1436,27 @@ static void mmi_update_charger_profile(struct mmi_charger_chip *chip,
 	}
 }
 
-static int mmi_find_colder_temp_zone(int pres_zone, int vbat,
-				struct mmi_temp_zone *zones,
-				int num_zones)
-{
-	int i;
-	int colder_zone;
-	int target_zone;
-
-	if (pres_zone == ZONE_HOT)
-		colder_zone = num_zones - 1;
-	else if (pres_zone == ZONE_COLD ||
- 	  zones[pres_zone].temp_c == zones[ZONE_FIRST].temp_c)
-		return ZONE_COLD;
-	else {
-		for (i = pres_zone - 1; i >= ZONE_FIRST; i--) {
-			if (zones[pres_zone].temp_c > zones[i].temp_c) {
-				colder_zone = i;
-				break;
-			}
-		}
-		if (i < 0)
-			return ZONE_COLD;
-	}
-
-	target_zone = colder_zone;
-	for (i = ZONE_FIRST; i < colder_zone; i++) {
-		if (zones[colder_zone].temp_c == zones[i].temp_c) {
-			target_zone = i;
-			if (vbat < zones[i].norm_mv)
-				break;
-		}
-	}
-
-	return target_zone;
-}
-
-static int mmi_find_hotter_temp_zone(int pres_zone, int vbat,
-				struct mmi_temp_zone *zones,
-				int num_zones)
-{
-	int i;
-	int hotter_zone;
-	int target_zone;
-
-	if (pres_zone == ZONE_COLD)
-		hotter_zone = ZONE_FIRST;
-	else if (pres_zone == ZONE_HOT ||
-	    zones[pres_zone].temp_c == zones[num_zones - 1].temp_c)
-		return ZONE_HOT;
-	else {
-		for (i = pres_zone + 1; i < num_zones; i++) {
-			if (zones[pres_zone].temp_c < zones[i].temp_c) {
-				hotter_zone = i;
-				break;
-			}
-		}
-		if (i >= num_zones)
-			return ZONE_HOT;
-	}
-
-	target_zone = hotter_zone;
-	for (i = hotter_zone; i < num_zones; i++) {
-		if (zones[hotter_zone].temp_c == zones[i].temp_c) {
-			target_zone = i;
-			if (vbat < zones[i].norm_mv)
-				break;
-		}
-	}
-	return target_zone;
-}
-
-static int mmi_refresh_temp_zone(int pres_zone, int vbat,
-				struct mmi_temp_zone *zones,
-				int num_zones)
+static int mmi_temp_zone_lookup(const struct mmi_temp_map *map, int g,
+				int vbat_mv)
 {
-	int i;
-	int target_zone;
-
-	if (pres_zone == ZONE_COLD || pres_zone == ZONE_HOT)
-		return pres_zone;
+	const struct mmi_temp_group *group = &map->groups[g];
 
-	target_zone = pres_zone;
-	for (i = ZONE_FIRST; i < num_zones; i++) {
-		if (zones[pres_zone].temp_c == zones[i].temp_c) {
-			target_zone = i;
-			if (vbat < zones[i].norm_mv)
-				break;
-		}
-	}
-	return target_zone;
+	return group->band_zone[mmi_temp_band(group, vbat_mv)];
 }
 
 static void mmi_get_temp_zone(struct mmi_charger_chip *chip,
 			       struct mmi_charger *charger)
 {
-	int i;
+	int g, b;
 	int temp_c;
 	int vbat_mv;
 	int max_temp;
-	int prev_zone, num_zones;
+	int prev_zone;
 	int hotter_zone, colder_zone;
 	struct mmi_temp_zone *zones;
-	int hotter_t, hotter_fcc;
-	int colder_t, colder_fcc;
+	const struct mmi_temp_map *map;
+	const struct mmi_temp_step *step;
+	int hotter_t, colder_t;
 
 	if (!chip) {
 		pr_err("called before chg valid!\n");
@@ -1191,93 +1466,73 @@ static void mmi_get_temp_zone(struct mmi_charger_chip *chip,
 	temp_c = charger->batt_info.batt_temp;
 	vbat_mv = charger->batt_info.batt_mv;
 	prev_zone = charger->status.pres_temp_zone;
-	num_zones = charger->profile.num_temp_zones;
-	if (!charger->profile.temp_zones) {
+	map = charger->profile.temp_map;
+	if (!map) {
 		zones = NULL;
-		num_zones = 0;
 		max_temp = MAX_TEMP_C;
 	} else {
 		zones = charger->profile.temp_zones;
 		if (chip->max_chrg_temp >= MIN_MAX_TEMP_C)
 			max_temp = chip->max_chrg_temp;
 		else
-			max_temp = zones[num_zones - 1].temp_c;
+			max_temp = map->groups[map->num_groups - 1].temp_c;
 	}
 
-	if (prev_zone == ZONE_NONE && zones) {
-		for (i = num_zones - 1; i >= 0; i--) {
-			if (temp_c >= zones[i].temp_c) {
+	if (prev_zone == ZONE_NONE && map) {
+		if (temp_c >= map->groups[map->num_groups - 1].temp_c) {
+			charger->status.pres_temp_zone = ZONE_HOT;
+		} else if (temp_c < map->bucket_min_c) {
+			charger->status.pres_temp_zone = ZONE_COLD;
+		} else {
+			g = map->buckets[temp_c - map->bucket_min_c];
+			if (g == ZONE_COLD)
+				charger->status.pres_temp_zone = ZONE_COLD;
+			else
 				charger->status.pres_temp_zone =
-					mmi_find_hotter_temp_zone(i,
-							vbat_mv,
-							zones,
-							num_zones);
-				goto exit;
-			}
+					mmi_temp_zone_lookup(map, g, vbat_mv);
 		}
-		if (temp_c < MIN_TEMP_C)
-			charger->status.pres_temp_zone = ZONE_COLD;
-		else
-			charger->status.pres_temp_zone =
-					mmi_find_hotter_temp_zone(ZONE_COLD,
-							vbat_mv,
-							zones,
-							num_zones);
 		goto exit;
 	}
 
 	if (prev_zone == ZONE_COLD) {
 		if (temp_c >= MIN_TEMP_C + HYSTERESIS_DEGC) {
-			if (!num_zones)
+			if (!map)
 				charger->status.pres_temp_zone = ZONE_FIRST;
 			else
 				charger->status.pres_temp_zone =
-					mmi_find_hotter_temp_zone(prev_zone,
-							vbat_mv,
-							zones,
-							num_zones);
+					mmi_temp_zone_lookup(map, 0, vbat_mv);
 		}
 	} else if (prev_zone == ZONE_HOT) {
 		if (temp_c <=  max_temp - HYSTERESIS_DEGC) {
-			if (!num_zones)
+			if (!map)
 				charger->status.pres_temp_zone = ZONE_FIRST;
 			else
 				charger->status.pres_temp_zone =
-					mmi_find_colder_temp_zone(prev_zone,
-							vbat_mv,
-							zones,
-							num_zones);
+					mmi_temp_zone_lookup(map,
+							map->num_groups - 1,
+							vbat_mv);
 		}
-	} else if (zones) {
-		hotter_zone = mmi_find_hotter_temp_zone(prev_zone,
-						vbat_mv,
-						zones,
-						num_zones);
-		colder_zone = mmi_find_colder_temp_zone(prev_zone,
-						vbat_mv,
-						zones,
-						num_zones);
-		if (hotter_zone == ZONE_HOT) {
-			hotter_fcc = 0;
-			hotter_t = zones[prev_zone].temp_c;
+	} else if (map) {
+		step = &map->steps[prev_zone];
+		g = step->group;
+
+		if (g + 1 < map->num_groups) {
+			b = mmi_temp_band(&map->groups[g + 1], vbat_mv);
+			hotter_zone = map->groups[g + 1].band_zone[b];
 		} else {
-			hotter_fcc = zones[hotter_zone].fcc_max_ma;
-			hotter_t = zones[prev_zone].temp_c;
+			b = 0;
+			hotter_zone = ZONE_HOT;
 		}
+		hotter_t = step->hotter_t[b];
 
-		if (colder_zone == ZONE_COLD) {
-			colder_fcc = 0;
-			colder_t = MIN_TEMP_C;
+		if (g > 0) {
+			b = mmi_temp_band(&map->groups[g - 1], vbat_mv);
+			colder_zone = map->groups[g - 1].band_zone[b];
 		} else {
-			colder_fcc = zones[colder_zone].fcc_max_ma;
-			colder_t = zones[colder_zone].temp_c;
+			b = 0;
+			colder_zone = ZONE_COLD;
 		}
-
-		if (zones[prev_zone].fcc_max_ma < hotter_fcc)
-			hotter_t += HYSTERESIS_DEGC;
-
-		if (zones[prev_zone].fcc_max_ma < colder_fcc)
-			colder_t -= HYSTERESIS_DEGC;
+		colder_t = step->colder_t[b];
 
 		if (temp_c < MIN_TEMP_C)
 			charger->status.pres_temp_zone = ZONE_COLD;
@@ -1289,10 +1544,7 @@ static void mmi_get_temp_zone(struct mmi_charger_chip *chip,
 			charger->status.pres_temp_zone = colder_zone;
 		else
 			charger->status.pres_temp_zone =
-					mmi_refresh_temp_zone(prev_zone,
-							vbat_mv,
-							zones,
-							num_zones);
+					mmi_temp_zone_lookup(map, g, vbat_mv);
 	} else {
 		if (temp_c < MIN_TEMP_C)
 			charger->status.pres_temp_zone = ZONE_COLD;
@@ -1303,7 +1555,7 @@ static void mmi_get_temp_zone(struct mmi_charger_chip *chip,
 	}
 
 exit:
-	if (!zones ||
+	if (!map ||
 	    charger->status.pres_temp_zone == ZONE_COLD ||
 	    charger->status.pres_temp_zone == ZONE_HOT) {
 		charger->status.temp_zone = NULL;
@@ -1311,7 +1563,7 @@ exit:
 		charger->status.temp_zone = &zones[charger->status.pres_temp_zone];
 	}
 	if (prev_zone != charger->status.pres_temp_zone) {
-		mmi_info(chip, "[C:%s]: temp zone switch %x -> %x\n",
+		mmi_policy_info(chip, "[C:%s]: temp zone switch %x -> %x\n",
 			charger->driver->name,
 			prev_zone,
 			charger->status.pres_temp_zone);
@@ -1359,7 +1611,7 @@ static void mmi_get_charger_info(struct mmi_charger_chip *chip,
 
 	charger->driver->get_batt_info(charger->driver->data, batt_info);
 	charger->driver->get_chg_info(charger->driver->data, chg_info);
-	mmi_info(chip, "[C:%s]: batt_mv %d, batt_ma %d, batt_soc %d,"
+	mmi_policy_info(chip, "[C:%s]: batt_mv %d, batt_ma %d, batt_soc %d,"
 		" batt_temp %d, batt_status %d, batt_sn %s,"
 		" chrg_present %d, chrg_type %d, chrg_pmax_mw %d,"
 		" chrg_mv %d, chrg_ma %d\n",
@@ -1488,7 +1740,7 @@ static void mmi_update_charger_status(struct mmi_charger_chip *chip,
 
 	charger->battery->pending++;
 
-	mmi_info(chip, "[C:%s]: StepChg: %s, TempZone: %d, LimitMode: %d, DemoSuspend: %d\n",
+	mmi_policy_info(chip, "[C:%s]: StepChg: %s, TempZone: %d, LimitMode: %d, DemoSuspend: %d\n",
 		charger->driver->name,
 		stepchg_str[(int)status->pres_chrg_step],
 		status->pres_temp_zone,
@@ -1603,7 +1855,7 @@ static void mmi_configure_charger(struct mmi_charger_chip *chip,
 	charger->driver->set_constraint(charger->driver->data, &charger->constraint);
 	charger->driver->config_charge(charger->driver->data, cfg);
 
-	mmi_info(chip, "[C:%s]: FV=%d, FCC=%d, CDIS=%d,"
+	mmi_policy_info(chip, "[C:%s]: FV=%d, FCC=%d, CDIS=%d,"
 		" CSUS=%d, CRES=%d, CFULL=%d\n",
 		charger->driver->name,
 		cfg->target_fv,
@@ -2004,6 +2256,100 @@ static void mmi_update_battery_status(struct mmi_charger_chip *chip)
 	mutex_unlock(&chip->battery_lock);
 }
 
+/* Come back sooner when close to a temperature or voltage threshold */
+static int mmi_charger_heartbeat_margin(struct mmi_charger_chip *chip,
+					struct mmi_charger *charger)
+{
+	int i;
+	int temp_c = charger->batt_info.batt_temp;
+	int vbat_mv = charger->batt_info.batt_mv;
+	int margin_c = abs(temp_c - MIN_TEMP_C);
+	int margin_mv = INT_MAX;
+	struct mmi_charger_profile *profile = &charger->profile;
+
+	for (i = 0; i < profile->num_temp_zones; i++)
+		margin_c = min(margin_c,
+			       abs(temp_c - profile->temp_zones[i].temp_c));
+	if (chip->max_chrg_temp >= MIN_MAX_TEMP_C)
+		margin_c = min(margin_c, abs(temp_c - chip->max_chrg_temp));
+
+	if (charger->status.temp_zone)
+		margin_mv = abs(vbat_mv - charger->status.temp_zone->norm_mv);
+	if (profile->max_fv_mv)
+		margin_mv = min(margin_mv, abs(vbat_mv - profile->max_fv_mv));
+
+	if (margin_c <= HYSTERESIS_DEGC || margin_mv <= HYST_STEP_MV)
+		return HEARTBEAT_FAST_MS;
+	else if (margin_c <= 2 * HYSTERESIS_DEGC ||
+		 margin_mv <= 2 * HYST_STEP_MV ||
+		 charger->status.pres_chrg_step == STEP_NORM)
+		return chip->heartbeat_interval / 2;
+
+	return chip->heartbeat_interval;
+}
+
+/* Track the time to gain one percent while charging, or lose one otherwise */
+static void mmi_charger_track_soc(struct mmi_charger_chip *chip,
+				  bool discharging)
+{
+	int delta;
+
+	if (chip->hb_soc < 0 || chip->hb_soc_discharging != discharging) {
+		chip->hb_soc = chip->combo_soc;
+		chip->hb_soc_jiffies = jiffies;
+		chip->hb_soc_ms = 0;
+		chip->hb_soc_discharging = discharging;
+		return;
+	}
+
+	delta = discharging ? chip->hb_soc - chip->combo_soc :
+			      chip->combo_soc - chip->hb_soc;
+	if (delta > 0)
+		chip->hb_soc_ms = jiffies_to_msecs(jiffies -
+						   chip->hb_soc_jiffies) /
+				  delta;
+	if (delta) {
+		chip->hb_soc = chip->combo_soc;
+		chip->hb_soc_jiffies = jiffies;
+	}
+}
+
+static int mmi_charger_heartbeat_interval(struct mmi_charger_chip *chip)
+{
+	int interval;
+	struct mmi_charger *charger = NULL;
+
+	if (chip->factory_mode)
+		return HEARTBEAT_FACTORY_MS;
+
+	if (chip->max_charger_rate == MMI_POWER_SUPPLY_CHARGE_RATE_NONE) {
+		/*
+		 * Nothing to configure: only follow the capacity, so stretch
+		 * up to the time it takes to lose one percent, but not when
+		 * the battery is low.
+		 */
+		mmi_charger_track_soc(chip, true);
+		if (!chip->hb_soc_ms ||
+		    chip->combo_soc <= HEARTBEAT_DISCHARGE_LOW_SOC)
+			return HEARTBEAT_DISCHARGE_MS;
+
+		return clamp(chip->hb_soc_ms, HEARTBEAT_DISCHARGE_MS,
+			     HEARTBEAT_DISCHARGE_MAX_MS);
+	}
+
+	mmi_charger_track_soc(chip, false);
+	interval = chip->heartbeat_interval;
+	if (chip->hb_soc_ms)
+		interval = min(interval, chip->hb_soc_ms);
+
+	list_for_each_entry(charger, &chip->charger_list, list)
+		interval = min(interval,
+			       mmi_charger_heartbeat_margin(chip, charger));
+
+	/* Never poll faster than the fast rate, nor slower than DT asks */
+	return max(interval, min(chip->heartbeat_interval, HEARTBEAT_FAST_MS));
+}
+
 static void mmi_charger_heartbeat_work(struct work_struct *work)
 {
 	int hb_resch_time;
@@ -2036,6 +2382,7 @@ static void mmi_charger_heartbeat_work(struct work_struct *work)
 		mmi_configure_charger(chip, charger);
 	}
 	mmi_update_battery_status(chip);
+	hb_resch_time = mmi_charger_heartbeat_interval(chip);
 	mutex_unlock(&chip->charger_lock);
 
 	mmi_dbg(chip, "DemoMode:%d, FactoryVersion:%d, FactoryMode:%d,"
@@ -2067,18 +2414,16 @@ static void mmi_charger_heartbeat_work(struct work_struct *work)
 
 	chip->suspended = 0;
 
-	if (chip->factory_mode)
-		hb_resch_time = HEARTBEAT_FACTORY_MS;
-	else if (chip->max_charger_rate != MMI_POWER_SUPPLY_CHARGE_RATE_NONE)
-		hb_resch_time = chip->heartbeat_interval;
-	else
-		hb_resch_time = HEARTBEAT_DISCHARGE_MS;
+	mmi_dbg(chip, "Next heartbeat in %dms\n", hb_resch_time);
 	schedule_delayed_work(&chip->heartbeat_work,
 			      msecs_to_jiffies(hb_resch_time));
-	if (suspend_wakeups ||
-	    chip->max_charger_rate != MMI_POWER_SUPPLY_CHARGE_RATE_NONE)
+	if (chip->max_charger_rate != MMI_POWER_SUPPLY_CHARGE_RATE_NONE)
 		alarm_start_relative(&chip->heartbeat_alarm,
 				     ns_to_ktime(HEARTBEAT_WAKEUP_INTRVAL_NS));
+	else if (suspend_wakeups)
+		alarm_start_relative(&chip->heartbeat_alarm,
+			max(ms_to_ktime(hb_resch_time),
+			    ns_to_ktime(HEARTBEAT_WAKEUP_INTRVAL_NS)));
 
 	if (chip->max_charger_rate == MMI_POWER_SUPPLY_CHARGE_RATE_NONE)
 		pm_relax(chip->dev);
@@ -2205,7 +2550,20 @@ void mmi_get_charger_configure(struct mmi_charger_driver *driver)
 }
 EXPORT_SYMBOL(mmi_get_charger_configure);
 
-int mmi_vote_charging_disable(const char *voter, bool enable)
+int mmi_voter_register(const char *voter)
+{
+	struct mmi_charger_chip *chip = this_chip;
+
+	if (!chip) {
+		pr_err("mmi_charger: chip is invalid\n");
+		return -ENODEV;
+	}
+
+	return mmi_voter_register_chip(chip, voter);
+}
+EXPORT_SYMBOL(mmi_voter_register);
+
+int mmi_vote_charging_disable_id(int voter, bool enable)
 {
 	struct mmi_charger_chip *chip = this_chip;
 
@@ -2216,9 +2574,9 @@ int mmi_vote_charging_disable(const char *voter, bool enable)
 
 	return mmi_vote(&chip->disable_charging_vote, voter, enable, 0);
 }
-EXPORT_SYMBOL(mmi_vote_charging_disable);
+EXPORT_SYMBOL(mmi_vote_charging_disable_id);
 
-int mmi_vote_charger_suspend(const char *voter, bool enable)
+int mmi_vote_charger_suspend_id(int voter, bool enable)
 {
 	struct mmi_charger_chip *chip = this_chip;
 
@@ -2229,6 +2587,29 @@ int mmi_vote_charger_suspend(const char *voter, bool enable)
 
 	return mmi_vote(&chip->suspend_charger_vote, voter, enable, 0);
 }
+EXPORT_SYMBOL(mmi_vote_charger_suspend_id);
+
+/* Name based wrappers, prefer registering once and voting by id */
+int mmi_vote_charging_disable(const char *voter, bool enable)
+{
+	int id = mmi_voter_register(voter);
+
+	if (id < 0)
+		return id;
+
+	return mmi_vote_charging_disable_id(id, enable);
+}
+EXPORT_SYMBOL(mmi_vote_charging_disable);
+
+int mmi_vote_charger_suspend(const char *voter, bool enable)
+{
+	int id = mmi_voter_register(voter);
+
+	if (id < 0)
+		return id;
+
+	return mmi_vote_charger_suspend_id(id, enable);
+}
 EXPORT_SYMBOL(mmi_vote_charger_suspend);
 
 int mmi_register_charger_driver(struct mmi_charger_driver *driver)
@@ -2413,9 +2794,7 @@ static int mmi_psy_notifier_call(struct notifier_block *nb, unsigned long val,
 	    ((strcmp(psy->desc->name, "battery") == 0) ||
 	    (strcmp(psy->desc->name, "usb") == 0) ||
 	    (strcmp(psy->desc->name, "wireless") == 0))) {
-		cancel_delayed_work(&chip->heartbeat_work);
-		schedule_delayed_work(&chip->heartbeat_work,
-				      msecs_to_jiffies(0));
+		mmi_heartbeat_kick(chip);
 	}
 
 	return NOTIFY_OK;
@@ -2632,6 +3011,670 @@ static int mmi_parse_dt(struct mmi_charger_chip *chip)
 	return 0;
 }
 
+#ifdef MMI_CHARGER_SIMULATOR
+/*
+ * Charger policy simulator: runs the heartbeat policy on a private charger
+ * and chip, with a copy of the profile of the first registered charger,
+ * either against a battery model or replaying heartbeat log lines. Nothing
+ * reaches the real chargers, and votes, factory or demo mode of the real
+ * chip do not change the run.
+ */
+#define SIM_SAMPLES_MAX		8192
+#define SIM_LINE_MAX		512
+#define SIM_TRANSITIONS_MAX	16
+#define SIM_REPORT_SIZE		2048
+#define SIM_OCV_EMPTY_MV	3500
+#define SIM_OCV_FULL_MV		4400
+#define SIM_TEMP_TAU_S		600
+
+struct mmi_sim_sample {
+	u32 t_ms;
+	struct mmi_battery_info batt_info;
+	struct mmi_charger_info chg_info;
+};
+
+struct mmi_sim_transition {
+	u32 t_s;
+	int from;
+	int to;
+	int temp;
+};
+
+struct mmi_sim {
+	struct mutex lock;
+	struct mmi_charger_chip *chip;
+	struct mmi_charger_chip env;
+	struct mmi_charger charger;
+	struct mmi_charger_driver driver;
+	struct mmi_battery_pack battery;
+	/* Recorded heartbeat samples, and the line being received */
+	struct mmi_sim_sample *samples;
+	int num_samples;
+	char line[SIM_LINE_MAX];
+	int line_len;
+	/* Replay position, or battery model */
+	bool replay;
+	int sample;
+	int cap_mah;
+	int ir_mohm;
+	int limit_ma;
+	int pmax_mw;
+	int ambient_c;
+	int rise_mc;
+	int batt_ma;
+	s64 charge_uah;
+	int temp_mc;
+	/* Run statistics */
+	u32 time_s;
+	bool full;
+	u32 full_s;
+	u32 step_s[STEP_NONE + 1];
+	int step_changes;
+	int cfg_changes;
+	int max_temp;
+	int num_transitions;
+	struct mmi_sim_transition transitions[SIM_TRANSITIONS_MAX];
+	char report[SIM_REPORT_SIZE];
+};
+
+static int mmi_sim_model_permille(struct mmi_sim *sim)
+{
+	return div_s64(sim->charge_uah, sim->cap_mah);
+}
+
+/* Linear OCV, the reported soc is rounded up like fuel gauges do */
+static int mmi_sim_model_mv(struct mmi_sim *sim)
+{
+	return SIM_OCV_EMPTY_MV + (SIM_OCV_FULL_MV - SIM_OCV_EMPTY_MV) *
+			mmi_sim_model_permille(sim) / 1000;
+}
+
+static int mmi_sim_get_batt_info(void *data, struct mmi_battery_info *batt_info)
+{
+	struct mmi_sim *sim = data;
+
+	if (sim->replay) {
+		*batt_info = sim->samples[sim->sample].batt_info;
+		return 0;
+	}
+
+	memset(batt_info, 0, sizeof(*batt_info));
+	batt_info->batt_ma = sim->batt_ma;
+	batt_info->batt_mv = mmi_sim_model_mv(sim) +
+				sim->batt_ma * sim->ir_mohm / 1000;
+	batt_info->batt_soc = DIV_ROUND_UP(mmi_sim_model_permille(sim), 10);
+	batt_info->batt_temp = sim->temp_mc / 1000;
+	batt_info->batt_full_uah = sim->cap_mah * 1000;
+	batt_info->batt_design_uah = sim->cap_mah * 1000;
+	if (sim->charger.cfg.full_charged)
+		batt_info->batt_status = POWER_SUPPLY_STATUS_FULL;
+	else if (sim->batt_ma > 0)
+		batt_info->batt_status = POWER_SUPPLY_STATUS_CHARGING;
+	else
+		batt_info->batt_status = POWER_SUPPLY_STATUS_NOT_CHARGING;
+	strlcpy(batt_info->batt_sn, "sim", sizeof(batt_info->batt_sn));
+
+	return 0;
+}
+
+static int mmi_sim_get_chg_info(void *data, struct mmi_charger_info *chg_info)
+{
+	struct mmi_sim *sim = data;
+
+	if (sim->replay) {
+		*chg_info = sim->samples[sim->sample].chg_info;
+		return 0;
+	}
+
+	memset(chg_info, 0, sizeof(*chg_info));
+	chg_info->chrg_present = 1;
+	chg_info->vbus_present = 1;
+	chg_info->chrg_type = POWER_SUPPLY_TYPE_USB_PD;
+	chg_info->chrg_pmax_mw = sim->pmax_mw;
+	chg_info->chrg_mv = 5000;
+	chg_info->chrg_ma = sim->batt_ma * mmi_sim_model_mv(sim) / 5000;
+
+	return 0;
+}
+
+static int mmi_sim_config_charge(void *data, struct mmi_charger_cfg *config)
+{
+	return 0;
+}
+
+static bool mmi_sim_is_charge_tapered(void *data, int tapered_ma)
+{
+	struct mmi_sim *sim = data;
+	int batt_ma;
+
+	if (sim->replay)
+		batt_ma = sim->samples[sim->sample].batt_info.batt_ma;
+	else
+		batt_ma = sim->batt_ma;
+
+	return abs(batt_ma) <= tapered_ma;
+}
+
+static void mmi_sim_set_constraint(void *data,
+			struct mmi_charger_constraint *constraint)
+{
+}
+
+/* Battery charged with the configured CC/CV limits, heated by I^2 */
+static void mmi_sim_model_advance(struct mmi_sim *sim, int dt_s)
+{
+	struct mmi_charger_cfg *cfg = &sim->charger.cfg;
+	int steady_mc;
+	int cv_ma;
+	int ma = 0;
+
+	if (!cfg->charging_disable && !cfg->charger_suspend &&
+	    cfg->target_fcc > 0) {
+		ma = min(cfg->target_fcc, sim->limit_ma);
+		if (sim->pmax_mw)
+			ma = min(ma, sim->pmax_mw * 1000 / SIM_OCV_FULL_MV);
+		cv_ma = (cfg->target_fv - mmi_sim_model_mv(sim)) * 1000 /
+				sim->ir_mohm;
+		ma = clamp(cv_ma, 0, ma);
+	}
+
+	sim->batt_ma = ma;
+	sim->charge_uah += div_s64((s64)ma * dt_s * 1000, 3600);
+	if (sim->charge_uah > sim->cap_mah * 1000LL)
+		sim->charge_uah = sim->cap_mah * 1000LL;
+
+	steady_mc = sim->ambient_c * 1000 +
+			div_s64((s64)sim->rise_mc * ma * ma, 1000000);
+	if (dt_s >= SIM_TEMP_TAU_S)
+		sim->temp_mc = steady_mc;
+	else
+		sim->temp_mc += (steady_mc - sim->temp_mc) * dt_s /
+				SIM_TEMP_TAU_S;
+}
+
+/* One heartbeat of the policy, followed by dt_s of simulated time */
+static void mmi_sim_tick(struct mmi_sim *sim, int dt_s)
+{
+	struct mmi_charger_chip *chip = &sim->env;
+	struct mmi_charger *charger = &sim->charger;
+	struct mmi_sim_transition *tr;
+	struct mmi_charger_cfg prev_cfg = charger->cfg;
+	int prev_zone = charger->status.pres_temp_zone;
+	int prev_step = charger->status.pres_chrg_step;
+
+	mmi_get_charger_info(chip, charger);
+	mmi_update_charger_profile(chip, charger);
+	mmi_reset_charger_configure(chip, charger);
+	mmi_update_charger_status(chip, charger);
+	mmi_configure_charger(chip, charger);
+
+	if (prev_zone != ZONE_NONE &&
+	    prev_zone != charger->status.pres_temp_zone) {
+		if (sim->num_transitions < SIM_TRANSITIONS_MAX) {
+			tr = &sim->transitions[sim->num_transitions];
+			tr->t_s = sim->time_s;
+			tr->from = prev_zone;
+			tr->to = charger->status.pres_temp_zone;
+			tr->temp = charger->batt_info.batt_temp;
+		}
+		sim->num_transitions++;
+	}
+
+	if (prev_step != charger->status.pres_chrg_step)
+		sim->step_changes++;
+
+	if (prev_cfg.target_fv != charger->cfg.target_fv ||
+	    prev_cfg.target_fcc != charger->cfg.target_fcc ||
+	    prev_cfg.charging_disable != charger->cfg.charging_disable)
+		sim->cfg_changes++;
+
+	if (!sim->full && charger->status.pres_chrg_step == STEP_FULL) {
+		sim->full = true;
+		sim->full_s = sim->time_s;
+	}
+
+	sim->max_temp = max(sim->max_temp, charger->batt_info.batt_temp);
+	sim->step_s[charger->status.pres_chrg_step] += dt_s;
+	sim->time_s += dt_s;
+
+	if (!sim->replay)
+		mmi_sim_model_advance(sim, dt_s);
+}
+
+static void mmi_sim_profile_free(struct mmi_charger_profile *profile)
+{
+	if (profile->temp_map)
+		kfree(profile->temp_map->buckets);
+	kfree(profile->temp_map);
+	kfree(profile->temp_zones);
+	kfree(profile->ffc_zones);
+	memset(profile, 0, sizeof(*profile));
+}
+
+/* The charger may unregister during a run, its zones go with it */
+static int mmi_sim_profile_copy(struct mmi_charger_profile *dst,
+				const struct mmi_charger_profile *src)
+{
+	const struct mmi_temp_map *map = src->temp_map;
+
+	*dst = *src;
+	dst->temp_zones = NULL;
+	dst->temp_map = NULL;
+	dst->ffc_zones = NULL;
+
+	if (src->temp_zones) {
+		dst->temp_zones = kmemdup(src->temp_zones, src->num_temp_zones *
+					  sizeof(*src->temp_zones), GFP_KERNEL);
+		if (!dst->temp_zones)
+			goto err;
+	}
+
+	if (map) {
+		dst->temp_map = kmemdup(map, sizeof(*map), GFP_KERNEL);
+		if (!dst->temp_map)
+			goto err;
+		dst->temp_map->buckets = NULL;
+		if (map->buckets) {
+			dst->temp_map->buckets = kmemdup(map->buckets,
+						map->num_buckets, GFP_KERNEL);
+			if (!dst->temp_map->buckets)
+				goto err;
+		}
+	}
+
+	if (src->ffc_zones) {
+		dst->ffc_zones = kmemdup(src->ffc_zones, src->num_ffc_zones *
+					 sizeof(*src->ffc_zones), GFP_KERNEL);
+		if (!dst->ffc_zones)
+			goto err;
+	}
+
+	return 0;
+err:
+	mmi_sim_profile_free(dst);
+	return -ENOMEM;
+}
+
+/* Only the DT limits of the real chip, no votes, factory or demo mode */
+static void mmi_sim_env_init(struct mmi_sim *sim)
+{
+	struct mmi_charger_chip *chip = sim->chip;
+	struct mmi_charger_chip *env = &sim->env;
+
+	memset(env, 0, sizeof(*env));
+	env->name = "mmi_sim";
+	env->dev = chip->dev;
+	env->debug_enabled = chip->debug_enabled;
+	env->sim_env = true;
+	INIT_LIST_HEAD(&env->charger_list);
+	INIT_LIST_HEAD(&env->battery_list);
+	env->dcp_pmax = chip->dcp_pmax;
+	env->hvdcp_pmax = chip->hvdcp_pmax;
+	env->pd_pmax = chip->pd_pmax;
+	env->wls_pmax = chip->wls_pmax;
+	env->max_chrg_temp = chip->max_chrg_temp;
+	mmi_vote_init(&env->disable_charging_vote, "disable_charging", NULL);
+	mmi_vote_init(&env->suspend_charger_vote, "suspend_charger", NULL);
+}
+
+static int mmi_sim_start(struct mmi_sim *sim)
+{
+	struct mmi_charger_chip *chip = sim->chip;
+	struct mmi_charger *charger = &sim->charger;
+	struct mmi_charger *first;
+	int rc = -ENODEV;
+
+	mmi_sim_profile_free(&charger->profile);
+	mutex_lock(&chip->charger_lock);
+	first = list_first_entry_or_null(&chip->charger_list,
+					 struct mmi_charger, list);
+	if (first)
+		rc = mmi_sim_profile_copy(&charger->profile, &first->profile);
+	mutex_unlock(&chip->charger_lock);
+
+	if (rc)
+		return rc;
+
+	mmi_sim_env_init(sim);
+
+	sim->driver.name = "sim";
+	sim->driver.get_batt_info = mmi_sim_get_batt_info;
+	sim->driver.get_chg_info = mmi_sim_get_chg_info;
+	sim->driver.config_charge = mmi_sim_config_charge;
+	sim->driver.is_charge_tapered = mmi_sim_is_charge_tapered;
+	sim->driver.set_constraint = mmi_sim_set_constraint;
+	sim->driver.data = sim;
+	memset(&sim->battery, 0, sizeof(sim->battery));
+	charger->driver = &sim->driver;
+	charger->battery = &sim->battery;
+	memset(&charger->status, 0, sizeof(charger->status));
+	memset(&charger->cfg, 0, sizeof(charger->cfg));
+	charger->status.pres_temp_zone = ZONE_NONE;
+	charger->status.pres_chrg_step = STEP_NONE;
+	charger->status.demo_full_soc = 100;
+	charger->status.charging_limit_modes = CHARGING_LIMIT_UNKNOWN;
+
+	sim->time_s = 0;
+	sim->full = false;
+	sim->full_s = 0;
+	memset(sim->step_s, 0, sizeof(sim->step_s));
+	sim->step_changes = 0;
+	sim->cfg_changes = 0;
+	sim->max_temp = INT_MIN;
+	sim->num_transitions = 0;
+
+	return 0;
+}
+
+static void mmi_sim_report(struct mmi_sim *sim, int start_soc)
+{
+	char *buf = sim->report;
+	int i, len = 0;
+
+	len += scnprintf(buf + len, SIM_REPORT_SIZE - len,
+			"mode: %s\nsimulated: %us\nsoc: %d -> %d\n",
+			sim->replay ? "replay" : "model", sim->time_s,
+			start_soc, sim->charger.batt_info.batt_soc);
+	if (sim->full)
+		len += scnprintf(buf + len, SIM_REPORT_SIZE - len,
+				"time to full: %us\n", sim->full_s);
+	else
+		len += scnprintf(buf + len, SIM_REPORT_SIZE - len,
+				"time to full: not reached\n");
+
+	len += scnprintf(buf + len, SIM_REPORT_SIZE - len,
+			"max temp: %d\nstep changes: %d\nconfig changes: %d\n",
+			sim->max_temp, sim->step_changes, sim->cfg_changes);
+	for (i = 0; i <= STEP_NONE; i++)
+		len += scnprintf(buf + len, SIM_REPORT_SIZE - len,
+				"step %s: %us\n", stepchg_str[i],
+				sim->step_s[i]);
+
+	len += scnprintf(buf + len, SIM_REPORT_SIZE - len,
+			"zone transitions: %d\n", sim->num_transitions);
+	for (i = 0; i < min(sim->num_transitions, SIM_TRANSITIONS_MAX); i++)
+		len += scnprintf(buf + len, SIM_REPORT_SIZE - len,
+				"  %us: zone %d -> %d at %dC\n",
+				sim->transitions[i].t_s,
+				sim->transitions[i].from,
+				sim->transitions[i].to,
+				sim->transitions[i].temp);
+}
+
+static int mmi_sim_run_model(struct mmi_sim *sim, char *args)
+{
+	int soc = 20, temp = 25, hours = 4, step_s = 30;
+	char *arg, *val;
+	int rc, *dst;
+
+	sim->cap_mah = 5000;
+	sim->ir_mohm = 100;
+	sim->limit_ma = 3000;
+	sim->pmax_mw = 0;
+	sim->ambient_c = 25;
+	sim->rise_mc = 2000;
+
+	while ((arg = strsep(&args, " \t\n")) != NULL) {
+		if (!*arg)
+			continue;
+		val = strchr(arg, '=');
+		if (!val)
+			return -EINVAL;
+		*val++ = '\0';
+
+		if (!strcmp(arg, "soc"))
+			dst = &soc;
+		else if (!strcmp(arg, "temp"))
+			dst = &temp;
+		else if (!strcmp(arg, "hours"))
+			dst = &hours;
+		else if (!strcmp(arg, "step"))
+			dst = &step_s;
+		else if (!strcmp(arg, "cap"))
+			dst = &sim->cap_mah;
+		else if (!strcmp(arg, "ir"))
+			dst = &sim->ir_mohm;
+		else if (!strcmp(arg, "limit"))
+			dst = &sim->limit_ma;
+		else if (!strcmp(arg, "pmax"))
+			dst = &sim->pmax_mw;
+		else if (!strcmp(arg, "ambient"))
+			dst = &sim->ambient_c;
+		else if (!strcmp(arg, "rise"))
+			dst = &sim->rise_mc;
+		else
+			return -EINVAL;
+
+		rc = kstrtoint(val, 0, dst);
+		if (rc)
+			return rc;
+	}
+
+	if (sim->cap_mah <= 0 || sim->ir_mohm <= 0 || step_s <= 0 ||
+	    hours <= 0 || soc < 0 || soc > 100)
+		return -EINVAL;
+
+	rc = mmi_sim_start(sim);
+	if (rc)
+		return rc;
+
+	sim->replay = false;
+	sim->batt_ma = 0;
+	sim->charge_uah = (s64)sim->cap_mah * soc * 10;
+	sim->temp_mc = temp * 1000;
+	while (sim->time_s < hours * 3600) {
+		mmi_sim_tick(sim, step_s);
+		/* Carry on a little past full, to see it is stable */
+		if (sim->full && sim->time_s >= sim->full_s + 10 * step_s)
+			break;
+	}
+	mmi_sim_report(sim, soc);
+
+	return 0;
+}
+
+static int mmi_sim_run_replay(struct mmi_sim *sim)
+{
+	struct mmi_sim_sample *next;
+	int dt_s, rc;
+
+	if (!sim->num_samples)
+		return -ENODATA;
+
+	rc = mmi_sim_start(sim);
+	if (rc)
+		return rc;
+
+	sim->replay = true;
+	for (sim->sample = 0; sim->sample < sim->num_samples; sim->sample++) {
+		next = &sim->samples[sim->sample + 1];
+		if (sim->sample + 1 < sim->num_samples &&
+		    next->t_ms > sim->samples[sim->sample].t_ms)
+			dt_s = (next->t_ms -
+				sim->samples[sim->sample].t_ms) / 1000;
+		else
+			dt_s = HEARTBEAT_DELAY_MS / 1000;
+		mmi_sim_tick(sim, dt_s);
+	}
+	sim->sample = sim->num_samples - 1;
+	mmi_sim_report(sim, sim->samples[0].batt_info.batt_soc);
+
+	return 0;
+}
+
+/* Heartbeat lines from mmi_get_charger_info(), with the printk time if any */
+static void mmi_sim_parse_line(struct mmi_sim *sim, const char *line)
+{
+	struct mmi_sim_sample *sample;
+	unsigned int sec = 0, usec = 0;
+	const char *batt, *chrg;
+
+	batt = strstr(line, "batt_mv ");
+	chrg = strstr(line, "chrg_present ");
+	if (!batt || !chrg || sim->num_samples >= SIM_SAMPLES_MAX)
+		return;
+
+	sample = &sim->samples[sim->num_samples];
+	memset(sample, 0, sizeof(*sample));
+	if (sscanf(batt, "batt_mv %d, batt_ma %d, batt_soc %d, batt_temp %d,"
+		   " batt_status %d", &sample->batt_info.batt_mv,
+		   &sample->batt_info.batt_ma, &sample->batt_info.batt_soc,
+		   &sample->batt_info.batt_temp,
+		   &sample->batt_info.batt_status) != 5)
+		return;
+
+	if (sscanf(chrg, "chrg_present %d, chrg_type %d, chrg_pmax_mw %d,"
+		   " chrg_mv %d, chrg_ma %d", &sample->chg_info.chrg_present,
+		   &sample->chg_info.chrg_type, &sample->chg_info.chrg_pmax_mw,
+		   &sample->chg_info.chrg_mv,
+		   &sample->chg_info.chrg_ma) != 5)
+		return;
+
+	if (line[0] == '[' && sscanf(line + 1, "%u.%u", &sec, &usec) == 2)
+		sample->t_ms = sec * 1000 + usec / 1000;
+
+	sim->num_samples++;
+}
+
+static ssize_t mmi_sim_trace_write(struct file *file, const char __user *ubuf,
+				   size_t count, loff_t *ppos)
+{
+	struct mmi_sim *sim = file->private_data;
+	char buf[256];
+	size_t done = 0, n, i;
+
+	mutex_lock(&sim->lock);
+	if (!sim->samples) {
+		sim->samples = vzalloc(SIM_SAMPLES_MAX * sizeof(*sim->samples));
+		if (!sim->samples) {
+			mutex_unlock(&sim->lock);
+			return -ENOMEM;
+		}
+	}
+
+	while (done < count) {
+		n = min(count - done, sizeof(buf));
+		if (copy_from_user(buf, ubuf + done, n)) {
+			mutex_unlock(&sim->lock);
+			return -EFAULT;
+		}
+
+		for (i = 0; i < n; i++) {
+			if (buf[i] != '\n') {
+				if (sim->line_len < SIM_LINE_MAX - 1)
+					sim->line[sim->line_len++] = buf[i];
+				continue;
+			}
+			sim->line[sim->line_len] = '\0';
+			mmi_sim_parse_line(sim, sim->line);
+			sim->line_len = 0;
+		}
+		done += n;
+	}
+	mutex_unlock(&sim->lock);
+
+	return count;
+}
+
+static const struct file_operations mmi_sim_trace_fops = {
+	.open = simple_open,
+	.write = mmi_sim_trace_write,
+	.llseek = no_llseek,
+};
+
+static ssize_t mmi_sim_read(struct file *file, char __user *ubuf,
+			    size_t count, loff_t *ppos)
+{
+	struct mmi_sim *sim = file->private_data;
+	ssize_t rc;
+
+	mutex_lock(&sim->lock);
+	rc = simple_read_from_buffer(ubuf, count, ppos, sim->report,
+				     strlen(sim->report));
+	mutex_unlock(&sim->lock);
+
+	return rc;
+}
+
+/* "model [key=value ...]", "replay" or "clear" */
+static ssize_t mmi_sim_write(struct file *file, const char __user *ubuf,
+			     size_t count, loff_t *ppos)
+{
+	struct mmi_sim *sim = file->private_data;
+	char buf[128], *args;
+	int rc;
+
+	if (count >= sizeof(buf))
+		return -EINVAL;
+
+	if (copy_from_user(buf, ubuf, count))
+		return -EFAULT;
+
+	buf[count] = '\0';
+	args = strim(buf);
+
+	mutex_lock(&sim->lock);
+	if (!strncmp(args, "model", 5) && (!args[5] || isspace(args[5]))) {
+		rc = mmi_sim_run_model(sim, args + 5);
+	} else if (!strcmp(args, "replay")) {
+		rc = mmi_sim_run_replay(sim);
+	} else if (!strcmp(args, "clear")) {
+		sim->num_samples = 0;
+		sim->line_len = 0;
+		rc = 0;
+	} else {
+		rc = -EINVAL;
+	}
+	mutex_unlock(&sim->lock);
+
+	return rc ? rc : count;
+}
+
+static const struct file_operations mmi_sim_fops = {
+	.open = simple_open,
+	.read = mmi_sim_read,
+	.write = mmi_sim_write,
+	.llseek = default_llseek,
+};
+
+static void mmi_sim_init(struct mmi_charger_chip *chip)
+{
+	struct mmi_sim *sim;
+
+	if (IS_ERR_OR_NULL(chip->debug_root))
+		return;
+
+	sim = devm_kzalloc(chip->dev, sizeof(*sim), GFP_KERNEL);
+	if (!sim)
+		return;
+
+	mutex_init(&sim->lock);
+	sim->chip = chip;
+	chip->sim = sim;
+	debugfs_create_file("sim", 0600, chip->debug_root, sim,
+			    &mmi_sim_fops);
+	debugfs_create_file("sim_trace", 0200, chip->debug_root, sim,
+			    &mmi_sim_trace_fops);
+}
+
+/* Called once the debugfs files are gone */
+static void mmi_sim_exit(struct mmi_charger_chip *chip)
+{
+	if (chip->sim) {
+		vfree(chip->sim->samples);
+		mmi_sim_profile_free(&chip->sim->charger.profile);
+	}
+}
+#else
+static inline void mmi_sim_init(struct mmi_charger_chip *chip)
+{
+}
+
+static inline void mmi_sim_exit(struct mmi_charger_chip *chip)
+{
+}
+#endif
+
 static int mmi_charger_probe(struct platform_device *pdev)
 {
 	int rc = 0;
@@ -2658,8 +3701,11 @@ static int mmi_charger_probe(struct platform_device *pdev)
 	chip->init_cycles = 0;
 	chip->factory_version = mmi_is_factory_version();
 	chip->factory_mode = mmi_is_factory_mode();
-	chip->disable_charging_vote.name = "disable_charging";
-	chip->suspend_charger_vote.name = "suspend_charger";
+	mutex_init(&chip->vote_lock);
+	mmi_vote_init(&chip->disable_charging_vote, "disable_charging",
+		      mmi_heartbeat_vote_callback);
+	mmi_vote_init(&chip->suspend_charger_vote, "suspend_charger",
+		      mmi_heartbeat_vote_callback);
 	platform_set_drvdata(pdev, chip);
 	device_init_wakeup(chip->dev, true);
 
@@ -2670,6 +3716,9 @@ static int mmi_charger_probe(struct platform_device *pdev)
 	else
 		mmi_info(chip, "IPC logging is enabled for mmi charger\n");
 
+	/* A failure is reported, force_charging_disable then fails its votes */
+	chip->user_voter = mmi_voter_register_chip(chip, "MMI_USER");
+
 	rc = mmi_parse_dt(chip);
 	if (rc) {
 		mmi_err(chip, "Failed to parse device tree\n");
@@ -2683,6 +3732,7 @@ static int mmi_charger_probe(struct platform_device *pdev)
 	INIT_LIST_HEAD(&chip->charger_list);
 	INIT_LIST_HEAD(&chip->battery_list);
 	INIT_DELAYED_WORK(&chip->heartbeat_work, mmi_charger_heartbeat_work);
+	chip->hb_soc = -EINVAL;
 	PM_WAKEUP_REGISTER(chip->dev, chip->mmi_hb_wake_source, "mmi_hb_wake");
 	alarm_init(&chip->heartbeat_alarm, ALARM_BOOTTIME,
 		   mmi_heartbeat_alarm_cb);
@@ -2747,9 +3797,13 @@ static int mmi_charger_probe(struct platform_device *pdev)
 	if (chip->start_factory_kill_disabled)
 		factory_kill_disable = 1;
 
-	cancel_delayed_work(&chip->heartbeat_work);
-	schedule_delayed_work(&chip->heartbeat_work,
-			      msecs_to_jiffies(0));
+	chip->debug_root = debugfs_create_dir("mmi_charger", NULL);
+	if (!IS_ERR_OR_NULL(chip->debug_root))
+		debugfs_create_file("votes", 0400, chip->debug_root, chip,
+				    &mmi_votes_fops);
+	mmi_sim_init(chip);
+
+	mmi_heartbeat_kick(chip);
 
 	mmi_info(chip, "MMI charger probed successfully!\n");
 	return 0;
@@ -2761,6 +3815,7 @@ exit:
 
 static int mmi_charger_remove(struct platform_device *pdev)
 {
+	int i;
 	struct mmi_charger_chip *chip = platform_get_drvdata(pdev);
 
 	if (!list_empty(&chip->charger_list)) {
@@ -2768,6 +3823,10 @@ static int mmi_charger_remove(struct platform_device *pdev)
 	}
 
 	cancel_delayed_work(&chip->heartbeat_work);
+	debugfs_remove_recursive(chip->debug_root);
+	mmi_sim_exit(chip);
+	for (i = 0; i < chip->num_voters; i++)
+		kfree_const(chip->voters[i]);
 
 	if (chip->factory_mode)
 		unregister_reboot_notifier(&chip->mmi_reboot);
@@ -1215,6 +1215,9 @@ static int mmi_chrg_manager_parse_dt(struct mmi_charger_manager *chip)
 	chip->dont_rerun_aicl= of_property_read_bool(node,
 			"mmi,dont-rerun-aicl");
 
+	chip->pps_predict_tuning = of_property_read_bool(node,
+			"mmi,pps-predict-tuning");
+
 	rc = of_property_read_u32(node,
 				"mmi,typec-middle-current",
 				&chip->typec_middle_current);
@@ -244,6 +244,7 @@ struct mmi_charger_manager {
 	bool extrn_sense;
 	bool recovery_pmic_chrg;
 	bool dont_rerun_aicl;
+	bool pps_predict_tuning;	/*jump pps request from the estimated slope*/
 
 	bool sys_therm_cooling;
 	bool sys_therm_force_pmic_chrg;
@@ -42,6 +42,7 @@
 #include <linux/version.h>
 #include <linux/kernel.h>
 #include <linux/types.h>
+#include <linux/math64.h>
 #include "mmi_charger_core.h"
 
 typedef enum  {
@@ -88,6 +89,20 @@ static int quit_slave_chrg_cnt = 0;
 static int batt_curr_roof = 0;
 static int pd_constant_power_cnt = 0;
 
+/*
+ * Samples of the predictive PPS tuning, restarted on every state change.
+ * slope is the request change per mA of battery current, in the voltage
+ * tuning state this is the resistance of the adapter, cable and charge
+ * pump path in mOhm.
+ */
+static struct {
+	int iter;
+	int last_req;
+	int last_ibatt;
+	int slope;
+	int probe;
+} pps_predict;
+
 static void mmi_chrg_sm_move_state(struct mmi_charger_manager *chip, pm_sm_state_t state)
 {
 	mmi_chrg_dbg(chip, PR_INTERRUPT, "pm_state change:%s -> %s\n",
@@ -95,6 +110,7 @@ static void mmi_chrg_sm_move_state(struct mmi_charger_manager *chip, pm_sm_state
 	sm_state = state;
 	pd_constant_power_cnt = 0;
 	batt_curr_roof = 0;
+	memset(&pps_predict, 0, sizeof(pps_predict));
 }
 
 #define PPS_VOLT_COMP_DELTA	300000
@@ -242,6 +258,65 @@ void mmi_chrg_enable_all_cp(struct mmi_charger_manager *chip, int val)
 #define DISABLE_CHRG_LIMIT -1
 #define CP_CHRG_SOC_LIMIT 90
 #define PD_CONT_PWR_CNT 5
+#define HEARTBEAT_PPS_SETTLE_MS 300
+#define PPS_PREDICT_MIN_DELTA_UA 50000
+#define PPS_PREDICT_GAIN_PCT 75
+#define PPS_PREDICT_MAX_PROBE 8
+#define PPS_PREDICT_MAX_STEPS 40
+#define PPS_PREDICT_SETTLE_STEPS 4
+
+/*
+ * Predictive PPS tuning, returns the next request. applied is the request
+ * which was in effect while ibatt was sampled. Once two samples show a
+ * response, the request jumps by PPS_PREDICT_GAIN_PCT of the predicted
+ * distance to the target, so it approaches from below and the step shrinks
+ * with the remaining error down to one programming step. Until then the
+ * probe step doubles on every iteration. Large jumps wait longer for the
+ * adapter and the battery current to settle.
+ */
+static int mmi_pps_predict_next(struct mmi_charger_manager *chip,
+				int req, int applied, int req_max, int step,
+				int ibatt, int target, int *delay_ms)
+{
+	int d_req = applied - pps_predict.last_req;
+	int d_ibatt = ibatt - pps_predict.last_ibatt;
+	int delta;
+
+	if (pps_predict.iter && d_req > 0
+		&& d_ibatt >= PPS_PREDICT_MIN_DELTA_UA)
+		pps_predict.slope = div_s64((s64)d_req * 1000, d_ibatt);
+
+	if (pps_predict.slope > 0) {
+		delta = div_s64((s64)(target - ibatt) * pps_predict.slope
+				* PPS_PREDICT_GAIN_PCT, 1000 * 100);
+		delta -= delta % step;
+		pps_predict.probe = 0;
+	} else {
+		pps_predict.probe = pps_predict.probe ?
+			min(pps_predict.probe * 2, PPS_PREDICT_MAX_PROBE) : 1;
+		delta = step * pps_predict.probe;
+	}
+
+	delta = clamp(delta, step, step * PPS_PREDICT_MAX_STEPS);
+	delta = max(min(delta, req_max - req), 0);
+	*delay_ms = delta > step * PPS_PREDICT_SETTLE_STEPS ?
+			HEARTBEAT_PPS_SETTLE_MS : HEARTBEAT_PPS_TUNNING_MS;
+
+	mmi_chrg_dbg(chip, PR_MOTO, "pps predict %s iter %d, "
+				"applied %d, request %d, ibatt %dmA, "
+				"target %dmA, slope %d, probe %d, "
+				"delta %d, wait %dms\n",
+				pm_state_str[sm_state], pps_predict.iter,
+				applied, req, ibatt / 1000, target / 1000,
+				pps_predict.slope, pps_predict.probe,
+				delta, *delay_ms);
+
+	pps_predict.iter++;
+	pps_predict.last_req = applied;
+	pps_predict.last_ibatt = ibatt;
+
+	return req + delta;
+}
 
 static void clear_chg_manager(struct mmi_charger_manager *chip)
 {
@@ -286,6 +361,7 @@ void mmi_chrg_policy_clear(struct mmi_charger_manager *chip) {
 	chrg_cv_delta_volt = 0;
 	pd_constant_power_cnt = 0;
 	batt_curr_roof = 0;
+	memset(&pps_predict, 0, sizeof(pps_predict));
 	return;
 }
 
@@ -756,10 +832,22 @@ void mmi_chrg_sm_work_func(struct work_struct *work)
 				<= chip->pd_curr_max
 				&& vbatt_volt < chrg_step->chrg_step_cv_volt
 				&& ibatt_curr < chrg_step->chrg_step_cc_curr) {
-				chip->pd_request_curr += chip->pps_curr_steps;
+				if (chip->pps_predict_tuning) {
+					chip->pd_request_curr =
+						mmi_pps_predict_next(chip,
+							chip->pd_request_curr,
+							chip->pd_request_curr_prev,
+							chip->pd_curr_max,
+							chip->pps_curr_steps,
+							ibatt_curr,
+							chrg_step->chrg_step_cc_curr,
+							&heartbeat_dely_ms);
+				} else {
+					chip->pd_request_curr += chip->pps_curr_steps;
+					heartbeat_dely_ms = HEARTBEAT_PPS_TUNNING_MS;
+				}
 				mmi_chrg_dbg(chip, PR_MOTO, "Increase pps curr %d\n",
 								chip->pd_request_curr);
-				heartbeat_dely_ms = HEARTBEAT_PPS_TUNNING_MS;
 		} else {
 			mmi_chrg_info(chip,"Enter into tunning pps volt\n");
 			mmi_chrg_sm_move_state(chip, PM_STATE_PPS_TUNNING_VOLT);
@@ -805,10 +893,24 @@ void mmi_chrg_sm_work_func(struct work_struct *work)
 				&& ibatt_curr < ((chrg_step->pres_chrg_step == STEP_FIRST) ?
 				chrg_step->chrg_step_cc_curr + chip->step_first_curr_comp:
 				chrg_step->chrg_step_cc_curr)) {
-				chip->pd_request_volt += chip->pps_volt_steps;
+				if (chip->pps_predict_tuning) {
+					chip->pd_request_volt =
+						mmi_pps_predict_next(chip,
+							chip->pd_request_volt,
+							chip->pd_request_volt_prev,
+							chip->pd_volt_max,
+							chip->pps_volt_steps,
+							ibatt_curr,
+							(chrg_step->pres_chrg_step == STEP_FIRST) ?
+							chrg_step->chrg_step_cc_curr + chip->step_first_curr_comp :
+							chrg_step->chrg_step_cc_curr,
+							&heartbeat_dely_ms);
+				} else {
+					chip->pd_request_volt += chip->pps_volt_steps;
+					heartbeat_dely_ms = HEARTBEAT_PPS_TUNNING_MS;
+				}
 				mmi_chrg_dbg(chip, PR_MOTO, "Increase pps volt %d\n",
 								chip->pd_request_volt);
-				heartbeat_dely_ms = HEARTBEAT_PPS_TUNNING_MS;
 		} else {
 			mmi_chrg_info(chip,"Enter into CC loop stage !\n");
 			mmi_chrg_sm_move_state(chip, PM_STATE_CP_CC_LOOP);
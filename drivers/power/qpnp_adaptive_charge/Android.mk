@@ -16,6 +16,11 @@ ifeq ($(ADAPTIVE_TOLERANCE_OPTIMIZATION),true)
 	KBUILD_OPTIONS += ADAPTIVE_TOLERANCE_OPTIMIZATION=y
 endif
 
+ifeq ($(ADAPTIVE_CHARGE_PSY_RELAY),true)
+	KBUILD_OPTIONS += CONFIG_ADAPTIVE_CHARGE_PSY_RELAY=y
+	LOCAL_ADDITIONAL_DEPENDENCIES += $(KERNEL_MODULES_OUT)/mmi_relay.ko
+endif
+
 LOCAL_MODULE_PATH := $(KERNEL_MODULES_OUT)
 KBUILD_OPTIONS_GKI += GKI_OBJ_MODULE_DIR=gki
 include $(DLKM_DIR)/AndroidKernelModule.mk
@@ -38,6 +38,9 @@
 #include <linux/power_supply.h>
 #include <linux/notifier.h>
 #include <linux/moduleparam.h>
+#ifdef ADAPTIVE_CHARGE_PSY_RELAY
+#include <linux/mmi_relay.h>
+#endif
 
 #ifdef USE_MMI_CHARGER
 #elif (LINUX_VERSION_CODE >= KERNEL_VERSION(5, 4, 61))
@@ -52,6 +55,7 @@ static struct adap_chg_data {
 	struct power_supply *dc_psy;
 	struct power_supply *usb_psy;
 #ifdef USE_MMI_CHARGER
+	int	voter;
 #else
 	struct votable	*usb_icl_votable;
 	struct votable	*dc_suspend_votable;
@@ -60,6 +64,10 @@ static struct adap_chg_data {
 #endif
 	int	batt_capacity;
 	struct	notifier_block ps_notif;
+#ifdef ADAPTIVE_CHARGE_PSY_RELAY
+	struct	relay_psy_client ps_relay;
+#endif
+	bool	is_ps_relay;
 	struct	work_struct update;
 	bool	init_success;
 	bool	charging_suspended;
@@ -96,7 +104,7 @@ static void suspend_charging(bool on)
 {
 	if(!adap_chg_data.charging_suspended && on) {
 #ifdef USE_MMI_CHARGER
-		mmi_vote_charger_suspend(ADAPTIVE_CHARGING_VOTER, on);
+		mmi_vote_charger_suspend_id(adap_chg_data.voter, on);
 #else
 		vote(adap_chg_data.usb_icl_votable, ADAPTIVE_CHARGING_VOTER, true, 0);
 		vote(adap_chg_data.dc_suspend_votable, ADAPTIVE_CHARGING_VOTER, true, 0);
@@ -107,7 +115,7 @@ static void suspend_charging(bool on)
 
 	if(adap_chg_data.charging_suspended && !on) {
 #ifdef USE_MMI_CHARGER
-		mmi_vote_charger_suspend(ADAPTIVE_CHARGING_VOTER, on);
+		mmi_vote_charger_suspend_id(adap_chg_data.voter, on);
 #else
 		vote(adap_chg_data.usb_icl_votable, ADAPTIVE_CHARGING_VOTER, false, 0);
 		vote(adap_chg_data.dc_suspend_votable, ADAPTIVE_CHARGING_VOTER, false, 0);
@@ -122,7 +130,7 @@ static void stop_charging(bool on)
 {
 	if(!adap_chg_data.charging_stopped && on) {
 #ifdef USE_MMI_CHARGER
-		mmi_vote_charging_disable(ADAPTIVE_CHARGING_VOTER, on);
+		mmi_vote_charging_disable_id(adap_chg_data.voter, on);
 #else
 		vote(adap_chg_data.fcc_votable, ADAPTIVE_CHARGING_VOTER, true, 0);
 		vote(adap_chg_data.chg_dis_votable, ADAPTIVE_CHARGING_VOTER, true, 0);
@@ -133,7 +141,7 @@ static void stop_charging(bool on)
 
 	if(adap_chg_data.charging_stopped && !on) {
 #ifdef USE_MMI_CHARGER
-		mmi_vote_charging_disable(ADAPTIVE_CHARGING_VOTER, on);
+		mmi_vote_charging_disable_id(adap_chg_data.voter, on);
 #else
 		vote(adap_chg_data.fcc_votable, ADAPTIVE_CHARGING_VOTER, false, 0);
 		vote(adap_chg_data.chg_dis_votable, ADAPTIVE_CHARGING_VOTER, false, 0);
@@ -304,6 +312,38 @@ static int ps_notify_callback(struct notifier_block *nb,
 	return 0;
 }
 
+#ifdef ADAPTIVE_CHARGE_PSY_RELAY
+static void ps_relay_callback(struct relay_psy_client *client,
+		const struct relay_psy_event *ev)
+{
+	struct adap_chg_data *data = container_of(client, struct adap_chg_data, ps_relay);
+
+	if (upper_limit != -1)
+		schedule_work(&data->update);
+}
+
+/* Battery capacity is read once by the relay and shared with other drivers */
+static int ps_relay_register(struct adap_chg_data *data)
+{
+	data->ps_relay.mask[RELAY_PSY_BATTERY] = RELAY_PSY_BIT(RELAY_PSY_CAPACITY);
+	data->ps_relay.changed = ps_relay_callback;
+
+	return relay_psy_register(&data->ps_relay);
+}
+
+static void ps_relay_unregister(struct adap_chg_data *data)
+{
+	relay_psy_unregister(&data->ps_relay);
+}
+#else
+static inline int ps_relay_register(struct adap_chg_data *data)
+{
+	return -ENODEV;
+}
+
+static inline void ps_relay_unregister(struct adap_chg_data *data) { }
+#endif
+
 static struct kernel_param_ops upper_limit_ops =
 {
 	.set = &set_upper_limit,
@@ -381,6 +421,14 @@ static int qpnp_adap_chg_init_work(void)
 	}
 
 #ifdef USE_MMI_CHARGER
+	adap_chg_data.voter = mmi_voter_register(ADAPTIVE_CHARGING_VOTER);
+	if (adap_chg_data.voter == -ENODEV) {
+		pr_err("mmi charger not ready\n");
+		goto psy_fail;
+	} else if (adap_chg_data.voter < 0) {
+		pr_err("Failed to register voter\n");
+		goto fail;
+	}
 #else
 	adap_chg_data.usb_icl_votable = find_votable("USB_ICL");
 	if (IS_ERR(adap_chg_data.usb_icl_votable)) {
@@ -407,13 +455,18 @@ static int qpnp_adap_chg_init_work(void)
 	}
 #endif
 
-	adap_chg_data.ps_notif.notifier_call = ps_notify_callback;
-	if (power_supply_reg_notifier(&adap_chg_data.ps_notif)) {
-		pr_err("Failed to register notifier\n");
-		goto fail;
+	/* The relay calls back on registration, which schedules update */
+	INIT_WORK(&adap_chg_data.update, update_work);
+
+	adap_chg_data.is_ps_relay = !ps_relay_register(&adap_chg_data);
+	if (!adap_chg_data.is_ps_relay) {
+		adap_chg_data.ps_notif.notifier_call = ps_notify_callback;
+		if (power_supply_reg_notifier(&adap_chg_data.ps_notif)) {
+			pr_err("Failed to register notifier\n");
+			goto fail;
+		}
 	}
 
-	INIT_WORK(&adap_chg_data.update, update_work);
 	schedule_work(&adap_chg_data.update);
 
 	adap_chg_data.init_success = true;
@@ -455,8 +508,11 @@ static int __init qpnp_adap_chg_init(void)
 static void qpnp_adap_chg_exit(void)
 {
 	if(adap_chg_data.init_success) {
+		if (adap_chg_data.is_ps_relay)
+			ps_relay_unregister(&adap_chg_data);
+		else
+			power_supply_unreg_notifier(&adap_chg_data.ps_notif);
 		cancel_work_sync(&adap_chg_data.update);
-		power_supply_unreg_notifier(&adap_chg_data.ps_notif);
 	}
 
 	stop_charging(false);
@@ -42,6 +42,7 @@
 #define OEM_NOTIFY_IND			0x10002
 
 #define OEM_WAIT_TIME_MS		5000
+#define OEM_SNAPSHOT_CACHE_MS		500
 
 #define BATT_DEFAULT_ID 107000
 #define BATT_SN_UNKNOWN "unknown-sn"
@@ -93,6 +94,13 @@ struct lpd_info {
 	int lpd_rsbu2;
 };
 
+/* Read at once with OEM_PROP_CHG_SNAPSHOT, must fit in one response */
+struct charger_snapshot {
+	struct battery_info	batt;
+	struct charger_info	chg;
+	struct lpd_info		lpd;
+};
+
 struct oem_notify_ind_msg {
 	struct pmic_glink_hdr	hdr;
 	u32			notification;
@@ -175,6 +183,13 @@ struct qti_charger {
 	struct mutex			write_lock;
 	struct oem_read_buf_resp_msg	rx_buf;
 	atomic_t			rx_valid;
+	struct mutex			snapshot_lock;
+	struct charger_snapshot		snapshot;
+	unsigned long			snapshot_jiffies;
+	atomic_t			snapshot_gen;
+	int				snapshot_valid_gen;
+	bool				snapshot_valid;
+	bool				snapshot_supported;
 	struct work_struct		setup_work;
 	struct work_struct		notify_work;
 	struct oem_notify_ind_msg	notify_msg;
@@ -366,6 +381,16 @@ static void oem_state_cb(void *priv, enum pmic_glink_state state)
 	}
 }
 
+/*
+ * Bumping the generation drops the cached snapshot, including one that is
+ * being fetched right now: it was read before the change and is not
+ * published as valid.
+ */
+static void qti_charger_snapshot_invalidate(struct qti_charger *chg)
+{
+	atomic_inc(&chg->snapshot_gen);
+}
+
 static int qti_charger_write(struct qti_charger *chg, u32 property,
 			       const void *val, size_t val_len)
 {
@@ -393,6 +418,7 @@ static int qti_charger_write(struct qti_charger *chg, u32 property,
 
 	mutex_lock(&chg->write_lock);
 	reinit_completion(&chg->write_ack);
+	qti_charger_snapshot_invalidate(chg);
 
 	mmi_dbg(chg, "Start data write for property: %u, len=%zu\n",
 		property, val_len);
@@ -489,6 +515,94 @@ out:
 	return rc;
 }
 
+static bool qti_charger_snapshot_fresh(struct qti_charger *chg)
+{
+	return chg->snapshot_valid &&
+	       chg->snapshot_valid_gen == atomic_read(&chg->snapshot_gen) &&
+	       time_before(jiffies, chg->snapshot_jiffies +
+			   msecs_to_jiffies(OEM_SNAPSHOT_CACHE_MS));
+}
+
+/*
+ * Battery, charger and LPD info, shared by the heartbeat and the power
+ * supply readers for OEM_SNAPSHOT_CACHE_MS. If the ADSP supports it, they
+ * come in a single round trip.
+ */
+static int qti_charger_read_snapshot(struct qti_charger *chg,
+				     struct charger_snapshot *snapshot)
+{
+	int rc = 0;
+	int gen;
+
+	BUILD_BUG_ON(sizeof(struct charger_snapshot) >
+		     OEM_PROPERTY_DATA_SIZE * sizeof(u32));
+
+	mutex_lock(&chg->snapshot_lock);
+	if (qti_charger_snapshot_fresh(chg))
+		goto out;
+
+	gen = atomic_read(&chg->snapshot_gen);
+	if (chg->snapshot_supported) {
+		rc = qti_charger_read(chg, OEM_PROP_CHG_SNAPSHOT,
+				      &chg->snapshot,
+				      sizeof(struct charger_snapshot));
+	} else {
+		rc = qti_charger_read(chg, OEM_PROP_BATT_INFO,
+				      &chg->snapshot.batt,
+				      sizeof(struct battery_info));
+		if (!rc)
+			rc = qti_charger_read(chg, OEM_PROP_CHG_INFO,
+					      &chg->snapshot.chg,
+					      sizeof(struct charger_info));
+		if (!rc && qti_charger_read(chg, OEM_PROP_LPD_INFO,
+					    &chg->snapshot.lpd,
+					    sizeof(struct lpd_info)))
+			memset(&chg->snapshot.lpd, 0, sizeof(struct lpd_info));
+	}
+
+	chg->snapshot_valid = !rc;
+	chg->snapshot_valid_gen = gen;
+	chg->snapshot_jiffies = jiffies;
+out:
+	if (!rc)
+		memcpy(snapshot, &chg->snapshot, sizeof(*snapshot));
+	mutex_unlock(&chg->snapshot_lock);
+
+	return rc;
+}
+
+/*
+ * Battery info only. Without the snapshot property a full refresh costs
+ * three round trips, so a cache miss here reads just the battery info.
+ */
+static int qti_charger_read_batt_snapshot(struct qti_charger *chg,
+					  struct battery_info *info)
+{
+	int rc = 0;
+	bool hit;
+
+	if (chg->snapshot_supported) {
+		struct charger_snapshot snapshot;
+
+		rc = qti_charger_read_snapshot(chg, &snapshot);
+		if (!rc)
+			memcpy(info, &snapshot.batt, sizeof(*info));
+		return rc;
+	}
+
+	mutex_lock(&chg->snapshot_lock);
+	hit = qti_charger_snapshot_fresh(chg);
+	if (hit)
+		memcpy(info, &chg->snapshot.batt, sizeof(*info));
+	mutex_unlock(&chg->snapshot_lock);
+
+	if (!hit)
+		rc = qti_charger_read(chg, OEM_PROP_BATT_INFO, info,
+				      sizeof(struct battery_info));
+
+	return rc;
+}
+
 int qti_charger_set_property(u32 property, const void *val, size_t val_len)
 {
 	struct qti_charger *chg = this_chip;
@@ -531,14 +645,15 @@ static int qti_charger_get_batt_info(void *data, struct mmi_battery_info *batt_i
 {
 	int rc;
 	struct qti_charger *chg = data;
+	struct charger_snapshot snapshot;
 	int batt_status = chg->batt_info.batt_status;
 
-	rc = qti_charger_read(chg, OEM_PROP_BATT_INFO,
-				&chg->batt_info,
-				sizeof(struct battery_info));
+	rc = qti_charger_read_snapshot(chg, &snapshot);
 	if (rc)
 		return rc;
 
+	memcpy(&chg->batt_info, &snapshot.batt, sizeof(struct battery_info));
+
 	if (chg->chg_cfg.full_charged)
 		chg->batt_info.batt_status = POWER_SUPPLY_STATUS_FULL;
 
@@ -559,21 +674,15 @@ static int qti_charger_get_chg_info(void *data, struct mmi_charger_info *chg_inf
 {
 	int rc;
 	struct qti_charger *chg = data;
+	struct charger_snapshot snapshot;
 	struct wls_dump wls_info;
 
-	rc = qti_charger_read(chg, OEM_PROP_CHG_INFO,
-				&chg->chg_info,
-				sizeof(struct charger_info));
+	rc = qti_charger_read_snapshot(chg, &snapshot);
 	if (rc)
 		return rc;
 
-	rc = qti_charger_read(chg, OEM_PROP_LPD_INFO,
-				&chg->lpd_info,
-				sizeof(struct lpd_info));
-	if (rc) {
-		rc = 0;
-		memset(&chg->lpd_info, 0, sizeof(struct lpd_info));
-	}
+	memcpy(&chg->chg_info, &snapshot.chg, sizeof(struct charger_info));
+	memcpy(&chg->lpd_info, &snapshot.lpd, sizeof(struct lpd_info));
 	mmi_info(chg, "LPD: present=%d, rsbu1=%d, rsbu2=%d\n",
 			chg->lpd_info.lpd_present,
 			chg->lpd_info.lpd_rsbu1,
@@ -589,6 +698,10 @@ static int qti_charger_get_chg_info(void *data, struct mmi_charger_info *chg_inf
 	chg->chg_info.lpd_present = chg->lpd_info.lpd_present;
 	memcpy(chg_info, &chg->chg_info, sizeof(struct mmi_charger_info));
 
+	/* Wireless dump is only worth a round trip with a wireless charger */
+	if (!chg->wls_psy)
+		goto out;
+
 	rc =  qti_charger_read(chg, OEM_PROP_WLS_DUMP_INFO,
 				&wls_info,
 				sizeof(struct wls_dump));
@@ -628,6 +741,7 @@ static int qti_charger_get_chg_info(void *data, struct mmi_charger_info *chg_inf
 		wls_info.wls_icl_ma,
 		wls_info.wls_icl_therm_ma);
 
+out:
 	bm_ulog_print_log(OEM_BM_ULOG_SIZE);
 
 	return rc;
@@ -1752,40 +1866,40 @@ static int battery_psy_get_prop(struct power_supply *psy,
 		union power_supply_propval *pval)
 {
 	int rc;
-	struct battery_info info = {0};
+	struct battery_info batt;
+	struct battery_info *info = &batt;
 	struct qti_charger *chg = power_supply_get_drvdata(psy);
 
 	pval->intval = -ENODATA;
 
-	rc = qti_charger_read(chg, OEM_PROP_BATT_INFO, &info,
-				sizeof(struct battery_info));
+	rc = qti_charger_read_batt_snapshot(chg, &batt);
 	if (rc)
 		return rc;
 
 	switch (prop) {
 	case POWER_SUPPLY_PROP_STATUS:
-		pval->intval = info.batt_status;
+		pval->intval = info->batt_status;
 		break;
 	case POWER_SUPPLY_PROP_PRESENT:
-		pval->intval = info.batt_temp > BPD_TEMP_THRE? 1 : 0;
+		pval->intval = info->batt_temp > BPD_TEMP_THRE? 1 : 0;
 		break;
 	case POWER_SUPPLY_PROP_VOLTAGE_NOW:
-		pval->intval = info.batt_uv;
+		pval->intval = info->batt_uv;
 		break;
 	case POWER_SUPPLY_PROP_CURRENT_NOW:
-		pval->intval = info.batt_ua;
+		pval->intval = info->batt_ua;
 		break;
 	case POWER_SUPPLY_PROP_CAPACITY:
-		pval->intval = info.batt_soc / 100;
+		pval->intval = info->batt_soc / 100;
 		break;
 	case POWER_SUPPLY_PROP_TEMP:
-		pval->intval = info.batt_temp / 10;
+		pval->intval = info->batt_temp / 10;
 		break;
 	case POWER_SUPPLY_PROP_CHARGE_FULL:
-		pval->intval = info.batt_full_uah;
+		pval->intval = info->batt_full_uah;
 		break;
 	case POWER_SUPPLY_PROP_CHARGE_FULL_DESIGN:
-		pval->intval = info.batt_design_uah;
+		pval->intval = info->batt_design_uah;
 		break;
 	default:
 		break;
@@ -2052,6 +2166,8 @@ static void qti_charger_notify_work(struct work_struct *work)
 	struct qti_charger *chg = container_of(work,
 				struct qti_charger, notify_work);
 
+	/* Whatever changed, do not serve it from the cache */
+	qti_charger_snapshot_invalidate(chg);
 	notification = chg->notify_msg.notification;
 	notify_data.receiver = chg->notify_msg.receiver;
 	memcpy(notify_data.data, chg->notify_msg.data,
@@ -2140,6 +2256,9 @@ static int qti_charger_parse_dt(struct qti_charger *chg)
 		chg->profile_info.data_bk_size = 4;
 	chg->profile_info.data_bk_size *= 4;
 
+	chg->snapshot_supported = of_property_read_bool(node,
+					"mmi,oem-snapshot");
+
 	chg->profile_info.data_size = 0;
 	if (of_find_property(node, "mmi,profile-data", &byte_len)) {
 		if (byte_len % chg->profile_info.data_bk_size) {
@@ -2200,6 +2319,8 @@ static int qti_charger_probe(struct platform_device *pdev)
 	INIT_WORK(&chg->notify_work, qti_charger_notify_work);
 	mutex_init(&chg->read_lock);
 	mutex_init(&chg->write_lock);
+	mutex_init(&chg->snapshot_lock);
+	atomic_set(&chg->snapshot_gen, 0);
 	init_completion(&chg->read_ack);
 	init_completion(&chg->write_ack);
 	atomic_set(&chg->rx_valid, 0);
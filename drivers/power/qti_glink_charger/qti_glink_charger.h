@@ -59,6 +59,7 @@ enum oem_property_type {
 	OEM_PROP_WLS_TX_MODE,
 	OEM_PROP_WLS_FOLIO_MODE,
 	OEM_PROP_WLS_DUMP_INFO,
+	OEM_PROP_CHG_SNAPSHOT,
 	OEM_PROP_MAX,
 };
 
@@ -12,11 +12,17 @@
 #include <linux/seq_file.h>
 #include <linux/regmap.h>
 #include <linux/workqueue.h>
+#include <linux/power/fg_snapshot.h>
 
 #include "rt9426a_battery.h"
 
 #define PRECISION_ENHANCE	5
 
+/* Standard commands from CURR (0x04) to FLAG3 (0x30) */
+#define RT9426A_SNAPSHOT_BASE	RT9426A_REG_CURR
+#define RT9426A_SNAPSHOT_LEN	(RT9426A_REG_FLAG3 + 2 - RT9426A_REG_CURR)
+#define RT9426A_SNAPSHOT_MS	500
+
 /* Global Variable for RT9426A */
 u16 g_PAGE_CHKSUM[14] = {0};
 
@@ -26,6 +32,8 @@ struct rt9426a_chip {
 	struct rt9426a_platform_data *pdata;
 	struct power_supply *fg_psy;
 	struct regmap *regmap;
+	struct fg_snapshot snap;
+	struct dentry *debug_root;
 	struct mutex var_lock;
 	struct mutex update_lock;
 	struct delayed_work update_work;
@@ -117,6 +125,24 @@ static int rt9426a_reg_write_word(struct i2c_client *i2c, u8 reg, u16 data)
 	return rt9426a_block_write(i2c, reg, 2, (uint8_t *)&data);
 }
 
+static int rt9426a_snapshot_read(void *priv, u8 reg, u8 *buf, int len)
+{
+	struct rt9426a_chip *chip = priv;
+
+	return rt9426a_block_read(chip->i2c, reg, len, buf);
+}
+
+/* Standard command read, served from the snapshot when it covers reg */
+static int rt9426a_read_cmd(struct rt9426a_chip *chip, u8 reg)
+{
+	u16 data;
+
+	if (!fg_snapshot_read_word(&chip->snap, reg, &data))
+		return data;
+
+	return rt9426a_reg_read_word(chip->i2c, reg);
+}
+
 static int __maybe_unused rt9426a_reg_write_word_with_check
 		(struct rt9426a_chip *chip, u8 reg, u16 data)
 {
@@ -391,7 +417,7 @@ static int rt9426a_get_avg_vbat(struct rt9426a_chip *chip)
 static int rt9426a_get_volt(struct rt9426a_chip *chip)
 {
 	if (chip->pdata->volt_source)
-		chip->bvolt = rt9426a_reg_read_word(chip->i2c, chip->pdata->volt_source);
+		chip->bvolt = rt9426a_read_cmd(chip, chip->pdata->volt_source);
 
 	return chip->bvolt;
 }
@@ -399,7 +425,7 @@ static int rt9426a_get_volt(struct rt9426a_chip *chip)
 static int rt9426a_get_temp(struct rt9426a_chip *chip)
 {
 	if (chip->pdata->temp_source) {
-		chip->btemp = rt9426a_reg_read_word(chip->i2c, chip->pdata->temp_source);
+		chip->btemp = rt9426a_read_cmd(chip, chip->pdata->temp_source);
 		chip->btemp -= 2732;
 	}
 
@@ -410,7 +436,7 @@ static unsigned int rt9426a_get_cyccnt(struct rt9426a_chip *chip)
 {
 	int ret;
 
-	ret = rt9426a_reg_read_word(chip->i2c, RT9426A_REG_CYC);
+	ret = rt9426a_read_cmd(chip, RT9426A_REG_CYC);
 	if (ret < 0)
 		dev_notice(chip->dev, "%s: read cycle count fail\n", __func__);
 	else
@@ -422,7 +448,7 @@ static int rt9426a_get_soh(struct rt9426a_chip *chip)
 {
 	int ret;
 
-	ret = rt9426a_reg_read_word(chip->i2c, RT9426A_REG_SOH);
+	ret = rt9426a_read_cmd(chip, RT9426A_REG_SOH);
 	if (ret <= 0)
 		dev_notice(chip->dev, "%s: read soh fail\n", __func__);
 	else
@@ -434,7 +460,7 @@ static int rt9426a_get_soh(struct rt9426a_chip *chip)
 static int rt9426a_get_current(struct rt9426a_chip *chip)
 {
 	if (chip->pdata->curr_source) {
-		chip->bcurr = rt9426a_reg_read_word(chip->i2c, chip->pdata->curr_source);
+		chip->bcurr = rt9426a_read_cmd(chip, chip->pdata->curr_source);
 		if (chip->bcurr < 0)
 			return -EIO;
 		if (chip->bcurr > 0x7FFF) {
@@ -459,7 +485,7 @@ static int rt9426a_fg_get_soc(struct rt9426a_chip *chip, int to_do_smooth_soc)
 {
 	int regval, capacity = 0, btemp;
 
-	regval  = rt9426a_reg_read_word(chip->i2c, RT9426A_REG_SOC);
+	regval  = rt9426a_read_cmd(chip, RT9426A_REG_SOC);
 	if (regval < 0) {
 		dev_notice(chip->dev, "read soc value fail\n");
 		return -EIO;
@@ -786,6 +812,9 @@ static void rt9426a_update_info(struct rt9426a_chip *chip)
 		mdelay(5);
 	}
 
+	/* one block read below serves the whole report */
+	fg_snapshot_invalidate(&chip->snap);
+
 	/* read OPCFG1~7 to check */
 	rt9426a_read_page_cmd(chip, RT9426A_PAGE_1);
 
@@ -802,7 +831,7 @@ static void rt9426a_update_info(struct rt9426a_chip *chip)
 		 rt9426a_reg_read_word(chip->i2c, RT9426A_REG_SWINDOW1),
 		 rt9426a_reg_read_word(chip->i2c, RT9426A_REG_SWINDOW2));
 
-	ret = rt9426a_reg_read_word(chip->i2c, RT9426A_REG_FLAG2);
+	ret = rt9426a_read_cmd(chip, RT9426A_REG_FLAG2);
 
 	rt9426a_read_page_cmd(chip, RT9426A_PAGE_2);
 	regval = rt9426a_reg_read_word(chip->i2c, RT9426A_REG_SWINDOW1);
@@ -827,25 +856,25 @@ static void rt9426a_update_info(struct rt9426a_chip *chip)
 
 	dev_info(chip->dev, "DSNCAP(%d) FCC(%d)\n",
 		rt9426a_reg_read_word(chip->i2c, RT9426A_REG_DC),
-		rt9426a_reg_read_word(chip->i2c, RT9426A_REG_FCC));
+		rt9426a_read_cmd(chip, RT9426A_REG_FCC));
 
 	dev_info(chip->dev, "VOLT_SOURCE(0x%x) INPUT_VOLT(%d) FG_VBAT(%d) FG_OCV(%d) FG_AV(%d)\n",
 		chip->pdata->volt_source, rt9426a_get_volt(chip),
-		rt9426a_reg_read_word(chip->i2c, RT9426A_REG_VBAT),
+		rt9426a_read_cmd(chip, RT9426A_REG_VBAT),
 		rt9426a_reg_read_word(chip->i2c, RT9426A_REG_OCV),
 		rt9426a_reg_read_word(chip->i2c, RT9426A_REG_AV));
 	dev_info(chip->dev, "CURR_SOURCE(0x%x) INPUT_CURR(%d) FG_CURR(%d) FG_AI(%d)\n",
 		chip->pdata->curr_source, rt9426a_get_current(chip),
-		rt9426a_reg_read_word(chip->i2c, RT9426A_REG_CURR),
-		rt9426a_reg_read_word(chip->i2c, RT9426A_REG_AI));
+		rt9426a_read_cmd(chip, RT9426A_REG_CURR),
+		rt9426a_read_cmd(chip, RT9426A_REG_AI));
 	dev_info(chip->dev, "TEMP_SOURCE(0x%x) INPUT_TEMP(%d) FG_TEMP(%d)\n",
 			chip->pdata->temp_source, rt9426a_get_temp(chip),
-			rt9426a_reg_read_word(chip->i2c, RT9426A_REG_TEMP));
+			rt9426a_read_cmd(chip, RT9426A_REG_TEMP));
 	dev_info(chip->dev, "FG_FG_INTT(%d) FG_AT(%d)\n",
-		rt9426a_reg_read_word(chip->i2c, RT9426A_REG_INTT),
+		rt9426a_read_cmd(chip, RT9426A_REG_INTT),
 		rt9426a_reg_read_word(chip->i2c, RT9426A_REG_AT));
 
-	regval = rt9426a_reg_read_word(chip->i2c, RT9426A_REG_FLAG1);
+	regval = rt9426a_read_cmd(chip, RT9426A_REG_FLAG1);
 	dev_info(chip->dev, "FLAG1(0x%x)\n", regval);
 	if (((regval & 0x0200) >> 9) == 1)
 		dev_info(chip->dev, "FC = 1\n");
@@ -857,7 +886,7 @@ static void rt9426a_update_info(struct rt9426a_chip *chip)
 	else
 		dev_info(chip->dev, "FD = 0\n");
 
-	regval = rt9426a_reg_read_word(chip->i2c, RT9426A_REG_FLAG2);
+	regval = rt9426a_read_cmd(chip, RT9426A_REG_FLAG2);
 	dev_info(chip->dev, "FLAG2(0x%x)\n", regval);
 
 	if (((regval & 0xE000) >> 13) == 0)
@@ -883,7 +912,7 @@ static void rt9426a_update_info(struct rt9426a_chip *chip)
 	else
 		dev_info(chip->dev, "RLX = 0\n");
 
-	regval = rt9426a_reg_read_word(chip->i2c, RT9426A_REG_FLAG3);
+	regval = rt9426a_read_cmd(chip, RT9426A_REG_FLAG3);
 	dev_info(chip->dev, "FLAG3(0x%x)\n", regval);
 	if (((regval & 0x0100) >> 8) == 1)
 		dev_info(chip->dev, "RI = 1\n");
@@ -897,13 +926,13 @@ static void rt9426a_update_info(struct rt9426a_chip *chip)
 
 	dev_info(chip->dev, "CYCCNT(%d)\n", rt9426a_get_cyccnt(chip));
 
-	regval = rt9426a_reg_read_word(chip->i2c, RT9426A_REG_SOC);
+	regval = rt9426a_read_cmd(chip, RT9426A_REG_SOC);
 	dev_info(chip->dev, "SOC(%d)\n", regval);
 	/* add for smooth_soc */
 	/*chip->capacity = rt9426a_fg_get_soc(chip);*/
 	chip->capacity = rt9426a_fg_get_soc(chip, chip->pdata->smooth_soc_en);
 
-	regval = rt9426a_reg_read_word(chip->i2c, RT9426A_REG_RM);
+	regval = rt9426a_read_cmd(chip, RT9426A_REG_RM);
 	dev_info(chip->dev, "RM(%d)\n", regval);
 
 	//regval = rt9426a_reg_read_word(chip->i2c, RT9426A_REG_SOH);
@@ -2495,6 +2524,7 @@ BYPASS_EXT_REG:
 			if ((reg_flag2&RT9426A_RDY_MASK)&&(reg_flag2!=0xFFFF)) {
 				/* get current & vbat for vbat compensation ; 2022-01-18 */
 				/* step-1. volt_comp = volt_now - ((curr_now * RT9426A_BATTERY_RESISTANCE) / 1000) */
+				fg_snapshot_invalidate(&chip->snap);
 				curr_now = rt9426a_get_current(chip);
 				volt_now = rt9426a_reg_read_word(chip->i2c, RT9426A_REG_VBAT);
 				volt_comp = volt_now -
@@ -2560,6 +2590,7 @@ END_INIT:
 	/* rt9426a_check_cycle_cnt_for_fg_ini(chip); */
 
 	/* get initial soc for driver for smooth soc */
+	fg_snapshot_invalidate(&chip->snap);
 	chip->capacity = rt9426a_fg_get_soc(chip,0);
 
 	if (ret == RT9426A_INIT_PASS) {
@@ -2858,6 +2889,24 @@ static const struct regmap_config rt9426a_regmap_config = {
 	.val_format_endian = REGMAP_ENDIAN_LITTLE,
 };
 
+static void rt9426a_create_debugfs(struct rt9426a_chip *chip)
+{
+	chip->debug_root = debugfs_create_dir(dev_name(chip->dev), NULL);
+	if (IS_ERR_OR_NULL(chip->debug_root)) {
+		dev_notice(chip->dev, "create debugfs fail\n");
+		chip->debug_root = NULL;
+		return;
+	}
+
+	/* 0 reads every standard command from the device */
+	debugfs_create_u32("snapshot_ms", 0644, chip->debug_root,
+			   &chip->snap.max_age_ms);
+	debugfs_create_u32("snapshot_reads", 0444, chip->debug_root,
+			   &chip->snap.reads);
+	debugfs_create_u32("snapshot_hits", 0444, chip->debug_root,
+			   &chip->snap.hits);
+}
+
 static void fg_update_work_func(struct work_struct *work)
 {
 	struct rt9426a_chip *chip = container_of(work, struct rt9426a_chip, update_work.work);
@@ -2916,6 +2965,9 @@ static int rt9426a_i2c_probe(struct i2c_client *i2c)
 
 	mutex_init(&chip->var_lock);
 	mutex_init(&chip->update_lock);
+	fg_snapshot_init(&chip->snap, RT9426A_SNAPSHOT_BASE,
+			 RT9426A_SNAPSHOT_LEN, RT9426A_SNAPSHOT_MS,
+			 rt9426a_snapshot_read, chip);
 	INIT_DELAYED_WORK(&chip->update_work, fg_update_work_func);
 	i2c_set_clientdata(i2c, chip);
 
@@ -2978,6 +3030,8 @@ static int rt9426a_i2c_probe(struct i2c_client *i2c)
 		goto fail_irq_enable;
 	}
 
+	rt9426a_create_debugfs(chip);
+
 	dev_info(chip->dev, "chip ver = 0x%04x\n", chip->ic_ver);
 	queue_delayed_work(system_power_efficient_wq, &chip->update_work, 5 * HZ);
 
@@ -3003,6 +3057,7 @@ static int rt9426a_i2c_remove(struct i2c_client *i2c)
 	rt9426a_irq_deinit(chip);
 	for (i = 0; i < ARRAY_SIZE(rt_fuelgauge_attrs); i++)
 		device_remove_file(&chip->fg_psy->dev, &rt_fuelgauge_attrs[i]);
+	debugfs_remove_recursive(chip->debug_root);
 	mutex_destroy(&chip->update_lock);
 	mutex_destroy(&chip->var_lock);
 
@@ -99,10 +99,15 @@ int32_t	calculate_mah = 0;
 int32_t	calculate_soc = 0;
 static int	car_error = 0;
 
-static char * BATT_CAPACITY	= NULL;//"/data/sCaMAH.dat";
-static char * BATT_FCC 	= NULL;//"/data/fcc.dat";
-static char * OCV_FLAG		= NULL;//"/data/ocv_flag.dat";
-static char * BATT_OFFSET 	= NULL;//"/data/offset.dat";
+//state which used to live in /data files, saved by userspace through sysfs
+static int32_t	bmu_state[BMU_STATE_NUM] = {
+	[0 ... BMU_STATE_NUM - 1] = NO_FILE,
+};
+static uint8_t	bmu_state_dirty = 0;
+
+//tables sorted by x at init are binary searched
+static uint8_t	ocv_table_sorted = 0;
+static uint8_t	temp_table_sorted = 0;
 
 static uint8_t	oz8806_pec_check  = 0;
 static uint8_t	oz8806_cell_num  = 1;
@@ -188,8 +193,11 @@ static int32_t 	oz8806_car_write(int32_t data);
 static uint8_t 	pec_calculate (uint8_t ucCrc, uint8_t ucData);
 //static int32_t 	oz8806_write_byte_pec(uint8_t index, uint8_t data);
 //static int 		bmu_check_file(char * address);
-static int 		bmu_write_data(char * address,int data);
-static int 		bmu_read_data(char * address);
+static int 		bmu_write_data(enum bmu_state_idx idx,int data);
+static int 		bmu_read_data(enum bmu_state_idx idx);
+static uint8_t 	bmu_table_sorted(int32_t number, one_latitude_data_t *data);
+static int32_t 	bmu_table_lookup(int32_t number, one_latitude_data_t *data,
+				 int32_t value, uint8_t sorted);
 //static int 		bmu_write_string(char * address,char * data);
 static void	 	bmu_wait_ready(void);
 //static int32_t 	i2c_read_byte(uint8_t addr,uint8_t index,uint8_t *data);
@@ -206,18 +214,6 @@ static void 	trim_bmu_VD23(void);
 
 void bmu_init_parameter_more(parameter_data_t *paramter_temp)
 {
-	if (paramter_temp->BATT_CAPACITY)
-		BATT_CAPACITY = paramter_temp->BATT_CAPACITY;
-
-	if (paramter_temp->BATT_FCC)
-		BATT_FCC = paramter_temp->BATT_FCC;
-
-	if (paramter_temp->OCV_FLAG)
-		OCV_FLAG = paramter_temp->OCV_FLAG;
-
-	if (paramter_temp->BATT_OFFSET)
-		BATT_OFFSET = paramter_temp->BATT_OFFSET;
-
 	if (paramter_temp->oz8806_cell_num)
 		oz8806_cell_num = paramter_temp->oz8806_cell_num;
 
@@ -330,6 +326,12 @@ void bmu_init_parameter_more(parameter_data_t *paramter_temp)
 
 	bmu_init_table(&xaxis_table, &yaxis_table, &zaxis_table, &rc_table);
 
+	ocv_table_sorted = bmu_table_sorted(parameter->ocv_data_num, parameter->ocv);
+	temp_table_sorted = bmu_table_sorted(parameter->cell_temp_num, parameter->temperature);
+	if (!ocv_table_sorted || !temp_table_sorted)
+		bmt_dbg("unsorted table, ocv:%d temp:%d, using linear scan\n",
+			!ocv_table_sorted, !temp_table_sorted);
+
 	batt_dbg("byte_num is %d\n",byte_num);
 	power_on_flag = num_0;
 	bmu_sleep_flag = num_0;
@@ -535,7 +537,7 @@ void bmu_init_parameter_more(parameter_data_t *paramter_temp)
 				data = batt_info->fOCVVolt - num_100;
 			else
 				data = batt_info->fOCVVolt;
-			batt_info->fRSOC = one_latitude_table(parameter->ocv_data_num,parameter->ocv,data);
+			batt_info->fRSOC = bmu_table_lookup(parameter->ocv_data_num,parameter->ocv,data,ocv_table_sorted);
 			batt_dbg("find ocv table batt_info.fRSOC is %d\n",batt_info->fRSOC);
 			if((batt_info->fRSOC >num_100) || (batt_info->fRSOC < num_0))
 				batt_info->fRSOC = num_50;
@@ -680,7 +682,7 @@ void check_shutdwon_voltage(void)
 
 	if(!sleep_ocv_flag) return;
 
-	temp = one_latitude_table(parameter->ocv_data_num,parameter->ocv,batt_info->fOCVVolt);
+	temp = bmu_table_lookup(parameter->ocv_data_num,parameter->ocv,batt_info->fOCVVolt,ocv_table_sorted);
 	batt_dbg("Sleep data is %d \n",temp);
 
 	// select higher data 
@@ -873,16 +875,16 @@ static void bmu_wait_ready(void)
 
 	if (bmu_sys_rw_kernel)// this ok
 	{
-		/* wait for sysfs to capacity from file*/
-		store_rc = bmu_read_data(BATT_CAPACITY);
+		/* wait for userspace to restore the saved capacity */
+		store_rc = bmu_read_data(BMU_STATE_CAPACITY);
 
 		//check file ,if file not exit, goto file fail
 		if(store_rc < 0)
 		{
-			batt_dbg("open BATT_CAPACITY fail, retry_times:%d \n", retry_times);
+			batt_dbg("no saved capacity, retry_times:%d \n", retry_times);
 			if(retry_times >= power_on_retry_times)
 			{
-				batt_dbg("BATT_CAPACITY file fail\n");
+				batt_dbg("saved capacity fail\n");
 				batt_info->sCaMAH = calculate_mah;
 				goto file_fail;
 			}
@@ -892,7 +894,7 @@ static void bmu_wait_ready(void)
 				return;
 			}
 		}
-		batt_dbg("open BATT_CAPACITY success, retry_times:%d \n", retry_times);
+		batt_dbg("saved capacity ok, retry_times:%d \n", retry_times);
 		batt_dbg("AAAA read battery capacity data is %d\n", store_rc);
 	}
 	else
@@ -901,7 +903,7 @@ static void bmu_wait_ready(void)
 		batt_dbg("RC from file:%d\n", store_rc);
 		if (store_rc == INIT_CAP)
         	{
-            		batt_dbg("wait for reading file:%s, retry:%d\n", BATT_CAPACITY, retry_times);
+            		batt_dbg("wait for saved capacity, retry:%d\n", retry_times);
 			if(retry_times > 10)
         		{
                    		batt_dbg("fail to get save_capacity, retry_times:%d \n",retry_times);
@@ -912,7 +914,7 @@ static void bmu_wait_ready(void)
         	}
 		else if (store_rc == NO_FILE)
 		{
-			batt_dbg("no file %s, retry_times:%d \n", BATT_CAPACITY, retry_times);
+			batt_dbg("no saved capacity, retry_times:%d \n", retry_times);
 			goto file_fail;
 		}
 	}
@@ -1150,7 +1152,7 @@ file_fail:
 		batt_info->fRSOC = num_0;
 		gas_gauge->sCtMAH = num_0;
 		gas_gauge->ocv_flag = 0;
-		bmu_write_data(OCV_FLAG,0);
+		bmu_write_data(BMU_STATE_OCV_FLAG,0);
 	}
 	if(batt_info->fRSOC >= num_100)
 	{
@@ -1160,7 +1162,7 @@ file_fail:
 		gas_gauge->discharge_sCtMAH = num_0;
 		gas_gauge->discharge_fcc_update = num_1;
 		gas_gauge->ocv_flag = 0;
-		bmu_write_data(OCV_FLAG,0);
+		bmu_write_data(BMU_STATE_OCV_FLAG,0);
 	}
 
 	if(sleep_ocv_flag)
@@ -1171,11 +1173,11 @@ file_fail:
 	// double check
 	if (bmu_sys_rw_kernel)
 	{
-		store_rc =  bmu_read_data(BATT_CAPACITY);
+		store_rc =  bmu_read_data(BMU_STATE_CAPACITY);
 		if(store_rc != batt_info->sCaMAH)
 		{
-			bmu_write_data(BATT_CAPACITY,batt_info->sCaMAH);
-			bmu_write_data(BATT_FCC, gas_gauge->fcc_data);
+			bmu_write_data(BMU_STATE_CAPACITY,batt_info->sCaMAH);
+			bmu_write_data(BMU_STATE_FCC, gas_gauge->fcc_data);
 			//batt_dbg("init write sCaMAH  %d,%d\n",batt_info->sCaMAH,store_rc);
 		}
 	}
@@ -1415,7 +1417,7 @@ static void check_board_offset(void)
 		return;
 	}
 
-	ret = bmu_read_data(BATT_OFFSET);
+	ret = bmu_read_data(BMU_STATE_OFFSET);
 	//batt_dbg("AAAA board_offset is  %d\n",data);
 	if(ret < num_0)
 	{
@@ -1427,12 +1429,12 @@ static void check_board_offset(void)
 		{
 			if((data < num_10) && (data > num_0) && (data != num_0))
 			{
-				ret = bmu_write_data(BATT_OFFSET,data);
+				ret = bmu_write_data(BMU_STATE_OFFSET,data);
 
 				if(ret <num_0)
 					batt_dbg("first write board_offset error\n");
 
-				data = bmu_read_data(BATT_OFFSET);
+				data = bmu_read_data(BMU_STATE_OFFSET);
 
 				batt_dbg("first write board_offset is %d\n",data);
 			}
@@ -1440,7 +1442,7 @@ static void check_board_offset(void)
 	}
 	else
 	{
-		offset = bmu_read_data(BATT_OFFSET);
+		offset = bmu_read_data(BMU_STATE_OFFSET);
 		if(((offset - data) > num_2) || ((offset - data) < -num_2))
 			afe_write_board_offset(offset);
 	}
@@ -1668,7 +1670,7 @@ retry_wakeup:
 	if(gas_gauge->fcc_data > (config_data->design_capacity *FCC_UPPER_LIMIT / 100))
 	{	
 		gas_gauge->fcc_data=  config_data->design_capacity  * FCC_UPPER_LIMIT / 100 ;
-		bmu_write_data(BATT_FCC,gas_gauge->fcc_data);
+		bmu_write_data(BMU_STATE_FCC,gas_gauge->fcc_data);
 	
 		batt_dbg("fcc error is %d\n",gas_gauge->fcc_data);
 
@@ -1676,7 +1678,7 @@ retry_wakeup:
 	if((gas_gauge->fcc_data <= 0) || (gas_gauge->fcc_data  < (config_data->design_capacity * FCC_LOWER_LIMIT / 100)))
 	{	
 		gas_gauge->fcc_data = config_data->design_capacity * FCC_LOWER_LIMIT /100;
-		bmu_write_data(BATT_FCC,gas_gauge->fcc_data);
+		bmu_write_data(BMU_STATE_FCC,gas_gauge->fcc_data);
 	
 		batt_dbg("fcc error is %d\n",gas_gauge->fcc_data);
 
@@ -1687,25 +1689,25 @@ retry_wakeup:
 	
 	if (bmu_sys_rw_kernel)
 	{
-		data = bmu_read_data(BATT_CAPACITY);
+		data = bmu_read_data(BMU_STATE_CAPACITY);
 		//batt_dbg("read from RAM batt_info->sCaMAH is %d\n",data);
 		if(data >= num_0)
 		{
 			if(fRSOC_PRE != batt_info->fRSOC)
 			{
 				fRSOC_PRE = batt_info->fRSOC;
-				bmu_write_data(BATT_CAPACITY,batt_info->sCaMAH);
+				bmu_write_data(BMU_STATE_CAPACITY,batt_info->sCaMAH);
 			//	batt_dbg("o2 back batt_info->sCaMAH num_1 is %d\n",batt_info->sCaMAH);
 				//return;
 				goto end;
 			}
 
 			if(((batt_info->sCaMAH - data)> (gas_gauge->fcc_data/200))||((data - batt_info->sCaMAH)> (gas_gauge->fcc_data/200))){
-				bmu_write_data(BATT_CAPACITY,batt_info->sCaMAH);
+				bmu_write_data(BMU_STATE_CAPACITY,batt_info->sCaMAH);
 			//	batt_dbg("o2 back batt_info->sCaMAH 2 is %d\n",batt_info->sCaMAH);
 			}
 		}
-		else bmu_write_data(BATT_CAPACITY,batt_info->sCaMAH);
+		else bmu_write_data(BMU_STATE_CAPACITY,batt_info->sCaMAH);
 	}
 	else
 	{
@@ -1760,11 +1762,11 @@ retry_wakeup:
 	batt_dbg("test data is %d\n",batt_info->sCaMAH);
 	/*
 
-	data = bmu_read_data(BATT_FCC);
+	data = bmu_read_data(BMU_STATE_FCC);
 
 	if(data != gas_gauge->fcc_data)
 	{
-		bmu_write_data(BATT_FCC,gas_gauge->fcc_data);
+		bmu_write_data(BMU_STATE_FCC,gas_gauge->fcc_data);
 		batt_dbg("test %d\n",gas_gauge->fcc_data);
 	}
 	*/
@@ -1898,7 +1900,7 @@ void charge_end_process(void)
 	{
 		if(batt_info->fCurr < config_data->charge_end_current)
 			gas_gauge->fcc_data = gas_gauge->sCtMAH;
-		bmu_write_data(BATT_FCC,gas_gauge->fcc_data);
+		bmu_write_data(BMU_STATE_FCC,gas_gauge->fcc_data);
 		
 		batt_dbg("charge1 fcc update is %d\n",gas_gauge->fcc_data);
 
@@ -1907,7 +1909,7 @@ void charge_end_process(void)
 	if(gas_gauge->fcc_data > (config_data->design_capacity *FCC_UPPER_LIMIT / 100))
 	{
 		gas_gauge->fcc_data=  config_data->design_capacity  * FCC_UPPER_LIMIT / 100 ;
-		bmu_write_data(BATT_FCC,gas_gauge->fcc_data);
+		bmu_write_data(BMU_STATE_FCC,gas_gauge->fcc_data);
 
 		batt_dbg("charge2 fcc update is %d\n",gas_gauge->fcc_data);
 
@@ -1915,7 +1917,7 @@ void charge_end_process(void)
 	if((gas_gauge->fcc_data <= 0) || (gas_gauge->fcc_data  < (config_data->design_capacity * FCC_LOWER_LIMIT / 100)))
 	{	
 		gas_gauge->fcc_data = config_data->design_capacity * FCC_LOWER_LIMIT / 100;
-		bmu_write_data(BATT_FCC,gas_gauge->fcc_data);
+		bmu_write_data(BMU_STATE_FCC,gas_gauge->fcc_data);
 	
 		batt_dbg("charge3 fcc update is %d\n",gas_gauge->fcc_data);
 
@@ -1926,12 +1928,12 @@ void charge_end_process(void)
 	batt_info->sCaMAH = full_charge_data;;
 
 	if (bmu_sys_rw_kernel)
-		bmu_write_data(BATT_CAPACITY,batt_info->sCaMAH);
+		bmu_write_data(BMU_STATE_CAPACITY,batt_info->sCaMAH);
 
 	afe_write_car(batt_info->sCaMAH);
 
 	if(gas_gauge->ocv_flag)
-		bmu_write_data(OCV_FLAG,0);
+		bmu_write_data(BMU_STATE_OCV_FLAG,0);
 
 	batt_dbg("yyyy  end charge \n");
 	batt_info->fRSOC = num_100;
@@ -1961,7 +1963,7 @@ void discharge_end_process(void)
 	if(gas_gauge->discharge_fcc_update)
 	{
 		gas_gauge->fcc_data = gas_gauge->discharge_sCtMAH;
-		bmu_write_data(BATT_FCC,gas_gauge->fcc_data);
+		bmu_write_data(BMU_STATE_FCC,gas_gauge->fcc_data);
 		batt_dbg("discharge1 fcc update is %d\n",gas_gauge->fcc_data);
 
 	}
@@ -1969,24 +1971,24 @@ void discharge_end_process(void)
 	if(gas_gauge->fcc_data > (config_data->design_capacity *FCC_UPPER_LIMIT / 100))
 	{
 		gas_gauge->fcc_data=  config_data->design_capacity  * FCC_UPPER_LIMIT / 100 ;
-		bmu_write_data(BATT_FCC,gas_gauge->fcc_data);
+		bmu_write_data(BMU_STATE_FCC,gas_gauge->fcc_data);
 		batt_dbg("discharge2 fcc update is %d\n",gas_gauge->fcc_data);
 	}
 	if((gas_gauge->fcc_data <= 0) || (gas_gauge->fcc_data  < (config_data->design_capacity * FCC_LOWER_LIMIT / 100)))
 	{
 		gas_gauge->fcc_data = config_data->design_capacity * FCC_LOWER_LIMIT / 100;
-		bmu_write_data(BATT_FCC,gas_gauge->fcc_data);
+		bmu_write_data(BMU_STATE_FCC,gas_gauge->fcc_data);
 		batt_dbg("discharge3 fcc update is %d\n",gas_gauge->fcc_data);
 	}
 	*/
 	gas_gauge->fcc_data = config_data->design_capacity;
 	if(gas_gauge->ocv_flag)
-		bmu_write_data(OCV_FLAG,0);
+		bmu_write_data(BMU_STATE_OCV_FLAG,0);
 
 	batt_info->sCaMAH = gas_gauge->fcc_data / 100 - 1;
 
 	if (bmu_sys_rw_kernel)
-		bmu_write_data(BATT_CAPACITY,batt_info->sCaMAH);
+		bmu_write_data(BMU_STATE_CAPACITY,batt_info->sCaMAH);
 
 	afe_write_car(batt_info->sCaMAH);
 	batt_info->fRCPrev = batt_info->sCaMAH;
@@ -2005,181 +2007,120 @@ void discharge_end_process(void)
 
 /*****************************************************************************
 * Description:
-*		below is linux file operation
-* Parameters:
-*		description for each argument, new argument starts at new line
-* Return:
-*		what does this function returned?
+*		persistent state, kept in memory instead of /data files so that
+*		the polling loop does no file I/O. Userspace reads the bmu_state
+*		blob when notified, saves it, and writes it back on boot.
+*		All below run under the update mutex of oz8806_battery.c
 *****************************************************************************/
-#if 0
-static int bmu_check_file(char * address)
+static int bmu_read_data(enum bmu_state_idx idx)
 {
-        long fd = sys_open(address,O_RDONLY,0644);
-    
-        if(fd < num_0)
-        {
-                //batt_dbg(" bmu check file  fail %s\n",address);
-				return -num_1;
-        } 
-        sys_close(fd);
-        return (num_0);
+	return bmu_state[idx];
 }
 
-
-static int bmu_read_data(char * address)
+static int bmu_write_data(enum bmu_state_idx idx,int data)
 {
-        char value[4];
-        int* p = (int *)value;
-        long fd = sys_open(address,O_RDONLY,0644);
-    
-        if(fd < num_0)
-		{
-			batt_dbg(" bmu read open file fail %s, return %ld\n",address, fd);
-			return fd;
-		}
-        
-        sys_read(fd,(char __user *)value,4);
-        
-        sys_close(fd);
-    
-        return (*p);
-}
-
-static int bmu_write_data(char * address,int data)
-{
-        char value[4];
-        int* p = (int *)value;
-        long fd = sys_open(address,O_CREAT | O_RDWR, 0644);
-    
-        if(fd < num_0)
-        {
-			batt_dbg("bmu wirte open file fail %s failed, return %ld\n",address, fd);
-			return fd;
-        }
-        *p = data;
-        sys_write(fd, (const char __user *)value, 4);
-        
-        sys_close(fd);
-		return num_0;
-}
-
-#else
-static int bmu_read_data(char * address)
-{
-    return -1;
-#if 0
-	struct file *fp = NULL;
-	mm_segment_t fs;
-	loff_t pos = 0;
-	char buf_r[5];
-	int ret = 0;
-	int val = 0;
-
-	//batt_dbg("%s\n", __func__);
+	if (idx == BMU_STATE_CAPACITY)
+		gas_gauge->stored_capacity = data;
 
-	fp = filp_open(address, O_RDONLY, 0644);
-	if (IS_ERR(fp))
+	if (bmu_state[idx] != data)
 	{
-		batt_dbg(" %s: open file fail %s\n", __func__, address);
-		return -1;
+		bmu_state[idx] = data;
+		bmu_state_dirty = num_1;
 	}
 
-	fs = get_fs();
-	set_fs(KERNEL_DS);
-
-	pos = 0;
-	ret = vfs_read(fp, buf_r, sizeof(buf_r), &pos);
-	if (ret < 0)
-		batt_dbg(" %s: read file fail %s\n", __func__, address);
-
-	buf_r[4] = '\0';
-	batt_dbg("%s: read: %s\n", __func__, buf_r);
+	return num_0;
+}
 
-	ret = kstrtoint(buf_r, 10, &val);
-	if (ret < 0)
-		batt_dbg(" %s: fail to get int from %s\n", __func__, address);
+int bmu_state_show(char *buf)
+{
+	return sprintf(buf, "%d %d %d %d\n",
+		       bmu_state[BMU_STATE_CAPACITY], bmu_state[BMU_STATE_FCC],
+		       bmu_state[BMU_STATE_OCV_FLAG], bmu_state[BMU_STATE_OFFSET]);
+}
+EXPORT_SYMBOL(bmu_state_show);
 
-	set_fs(fs);
+int bmu_state_restore(const char *buf)
+{
+	int32_t val[BMU_STATE_NUM];
 
-	filp_close(fp, NULL);
+	if (sscanf(buf, "%d %d %d %d", &val[BMU_STATE_CAPACITY], &val[BMU_STATE_FCC],
+		   &val[BMU_STATE_OCV_FLAG], &val[BMU_STATE_OFFSET]) != BMU_STATE_NUM)
+		return -EINVAL;
 
-	if (ret < 0)
-		return ret;
+	memcpy(bmu_state, val, sizeof(bmu_state));
+	if (gas_gauge)
+		gas_gauge->stored_capacity = val[BMU_STATE_CAPACITY];
+	bmt_dbg("restored state, capacity:%d fcc:%d ocv_flag:%d offset:%d\n",
+		val[BMU_STATE_CAPACITY], val[BMU_STATE_FCC],
+		val[BMU_STATE_OCV_FLAG], val[BMU_STATE_OFFSET]);
 
-	return val;
-#endif 
+	return num_0;
 }
+EXPORT_SYMBOL(bmu_state_restore);
 
-static int bmu_write_data(char * address,int data)
+//returns 1 once after the state changed, so that userspace saves it
+uint8_t bmu_state_changed(void)
 {
-    return -1;
-#if 0
-	struct file *fp = NULL;
-	mm_segment_t fs;
-	loff_t pos = 0;
-	char buf[5];
-	char buf_r[5];
-	int ret = 0;
-	int val = 0;
+	uint8_t dirty = bmu_state_dirty;
 
-	ret = sprintf(buf, "%d", data);
+	bmu_state_dirty = num_0;
+	return dirty;
+}
+EXPORT_SYMBOL(bmu_state_changed);
 
-	//batt_dbg("%s\n", __func__);
+/*****************************************************************************
+* Description:
+*		one latitude table lookup, same result as one_latitude_table()
+*		but binary searched when the table is sorted by x
+* Return:
+*		y of value, interpolated between the two nearest points and
+*		clamped to the first and last points
+*****************************************************************************/
+static uint8_t bmu_table_sorted(int32_t number, one_latitude_data_t *data)
+{
+	int32_t i;
 
-	fp = filp_open(address, O_RDWR | O_CREAT, 0644);
-	if (IS_ERR(fp))
+	for (i = num_1; i < number; i++)
 	{
-		batt_dbg(" %s: open file fail %s\n", __func__, address);
-		return -1;
+		if (data[i].x < data[i - 1].x)
+			return num_0;
 	}
 
-	fs = get_fs();
-	set_fs(KERNEL_DS);
+	return num_1;
+}
 
-	pos = 0;
-	ret = vfs_write(fp, buf, sizeof(buf), &pos);
-	if (ret < 0)
-		batt_dbg(" %s: write file fail %s\n", __func__, address);
+static int32_t bmu_table_lookup(int32_t number, one_latitude_data_t *data,
+				int32_t value, uint8_t sorted)
+{
+	int32_t lo = num_1;
+	int32_t hi = number - num_1;
+	int32_t mid;
 
-	else if (!strcmp(address, BATT_CAPACITY))
-		gas_gauge->stored_capacity = data;
+	if (!sorted)
+		return one_latitude_table(number, data, value);
 
-	if(config_data->debug)
-	{
-		pos = 0;
-		ret = vfs_read(fp, buf_r, sizeof(buf_r), &pos);
-		if (ret < 0)
-			batt_dbg(" %s: read file fail %s\n", __func__, address);
+	if ((number <= num_0) || (value <= data[0].x))
+		return data[0].y;
 
-		batt_dbg("%s: read: %s\n", __func__, buf_r);
+	if (value > data[number - 1].x)
+		return data[number - 1].y;
 
-		ret = kstrtoint(buf_r, 10, &val);
-		if (ret < 0)
-			batt_dbg(" %s: fail to get int from %s\n", __func__, address);
+	//first point with x >= value
+	while (lo < hi)
+	{
+		mid = (lo + hi) / num_2;
+		if (data[mid].x < value)
+			lo = mid + num_1;
+		else
+			hi = mid;
 	}
 
-	set_fs(fs);
+	if (data[lo].x == value)
+		return data[lo].y;
 
-	filp_close(fp, NULL);
-
-	return ret;
-#endif 
+	return data[lo - 1].y + (data[lo].y - data[lo - 1].y) *
+		(value - data[lo - 1].x) / (data[lo].x - data[lo - 1].x);
 }
-#if 0
-static int bmu_check_file(char * address)
-{
-	struct file *fp = NULL;
-
-	fp = filp_open(address, O_RDONLY, 0644);
-	if (IS_ERR(fp))
-	{
-		batt_dbg(" %s: open file fail %s\n", __func__, address);
-		return -1;
-	}
-	return 0;
-}
-#endif
-#endif
 
 //----------------------------------------------------------------------------
 //----------------------------------------------------------------------------
@@ -3030,7 +2971,7 @@ static int32_t afe_read_cell_temp(int32_t *data)
 	else{
 		temp = buf * config_data->temp_pull_up;
 		temp = temp / (config_data->temp_ref_voltage - buf);
-		*data =	one_latitude_table(parameter->cell_temp_num,parameter->temperature,temp);
+		*data =	bmu_table_lookup(parameter->cell_temp_num,parameter->temperature,temp,temp_table_sorted);
 	}
 	//batt_dbg("1111111111111 r is %d\n",temp);
 	return ret;
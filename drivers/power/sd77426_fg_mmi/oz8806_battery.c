@@ -335,6 +335,39 @@ static ssize_t oz8806_save_capacity_show(struct device *dev, struct device_attri
 	return sprintf(buf,"%d\n", save_capacity);
 }
 
+/*****************************************************************************
+ * Description:
+ *		bmu_state: capacity, fcc, ocv flag and board offset, space separated.
+ *		Userspace saves it on each change notification and writes it back
+ *		on boot, before writing 1 to bmu_init_done. Writes once the
+ *		gauge is initialized fail with -EBUSY
+ *****************************************************************************/
+static ssize_t oz8806_bmu_state_show(struct device *dev, struct device_attribute *attr,char *buf)
+{
+	int ret;
+
+	mutex_lock(&update_mutex);
+	ret = bmu_state_show(buf);
+	mutex_unlock(&update_mutex);
+
+	return ret;
+}
+
+static ssize_t oz8806_bmu_state_store(struct device *dev, struct device_attribute *attr, const char *buf, size_t _count)
+{
+	int ret;
+
+	/* Only the boot time restore, the gauge owns the state once running */
+	if (bmu_init_done)
+		return -EBUSY;
+
+	mutex_lock(&update_mutex);
+	ret = bmu_state_restore(buf);
+	mutex_unlock(&update_mutex);
+
+	return ret < 0 ? ret : _count;
+}
+
 static ssize_t oz8806_bmu_init_done_show(struct device *dev, struct device_attribute *attr,char *buf)
 {
 	return sprintf(buf,"%d\n", bmu_init_done);
@@ -417,6 +450,7 @@ static DEVICE_ATTR(registers, S_IRUGO | (S_IWUSR|S_IWGRP), oz8806_register_show,
 static DEVICE_ATTR(chip_id, S_IRUGO, oz8806_chip_id_show, NULL);
 static DEVICE_ATTR(bmt_debug, S_IRUGO | (S_IWUSR|S_IWGRP), oz8806_debug_show, oz8806_debug_store);
 static DEVICE_ATTR(save_capacity, S_IRUGO, oz8806_save_capacity_show, NULL);
+static DEVICE_ATTR(bmu_state, S_IRUGO| (S_IWUSR|S_IWGRP), oz8806_bmu_state_show, oz8806_bmu_state_store);
 static DEVICE_ATTR(bmu_init_done, S_IRUGO| (S_IWUSR|S_IWGRP), oz8806_bmu_init_done_show, oz8806_bmu_init_done_store);
 static DEVICE_ATTR(cycle_count, S_IRUGO| (S_IWUSR|S_IWGRP), batt_cycle_soh_show, batt_cycle_soh_store);
 static DEVICE_ATTR(age, S_IRUGO| (S_IWUSR|S_IWGRP), batt_age_soh_show, batt_age_soh_store);
@@ -427,6 +461,7 @@ static struct attribute *oz8806_attributes[] = {
 	&dev_attr_bmt_debug.attr,
 	&dev_attr_bmu_init_done.attr,
 	&dev_attr_save_capacity.attr,
+	&dev_attr_bmu_state.attr,
 	&dev_attr_cycle_count.attr,
 	&dev_attr_age.attr,
 	&dev_attr_name.attr,
@@ -893,6 +928,7 @@ static void oz8806_battery_func(struct oz8806_data *data)
 {
 	unsigned long time_since_last_update_ms = 0;
 	static unsigned long cur_jiffies = 0;
+	uint8_t state_changed;
 
 	if(0 == cur_jiffies)
 		cur_jiffies = jiffies;
@@ -925,9 +961,13 @@ static void oz8806_battery_func(struct oz8806_data *data)
 	if(adapter_status == O2_CHARGER_BATTERY)
 		discharge_end_fun(data);
 
+	state_changed = bmu_state_changed();
 	mutex_unlock(&update_mutex);
 	/**************mutex_unlock*********************/
 
+	if (state_changed)
+		sysfs_notify(&data->bat->dev.kobj, NULL, "bmu_state");
+
 
 	oz8806_wakeup_event(data);
 
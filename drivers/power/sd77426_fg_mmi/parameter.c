@@ -70,11 +70,6 @@ void bmu_init_parameter(parameter_data_t *parameter_customer)
 	parameter_customer->discharge_pursue_th = 10;
 	parameter_customer->wait_method = 2;
 
-	//parameter_customer->BATT_CAPACITY 	= "/data/sCaMAH.dat";
-	//parameter_customer->BATT_FCC 		= "/data/fcc.dat";
-	//parameter_customer->OCV_FLAG 	= "/data/ocv_flag.dat";
-	//parameter_customer->BATT_OFFSET 	= "/data/offset.dat";
-
 	parameter_customer->fix_car_init = 0;
 	parameter_customer->power_on_retry_times = 0;
 
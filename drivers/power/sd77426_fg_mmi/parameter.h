@@ -72,6 +72,15 @@
 #define INIT_CAP (-2) 
 #define NO_FILE (-1)  
 
+//state saved by userspace through the bmu_state sysfs blob
+enum bmu_state_idx {
+	BMU_STATE_CAPACITY,
+	BMU_STATE_FCC,
+	BMU_STATE_OCV_FLAG,
+	BMU_STATE_OFFSET,
+	BMU_STATE_NUM,
+};
+
 /****************************************************************************
 * Struct section
 *  add struct #define here if any
@@ -136,10 +145,6 @@ typedef struct	 tag_parameter_data {
  	uint8_t	discharge_pursue_step;
 	uint8_t	discharge_pursue_th;
 	uint8_t	wait_method;
-	char * BATT_CAPACITY ;
-	char * BATT_FCC;
-	char * OCV_FLAG;
-	char * BATT_OFFSET;
 	uint8_t oz8806_cell_num;
 	int32_t res_divider_ratio;
 	uint8_t set_soc_from_ext;
@@ -268,6 +273,9 @@ extern void	discharge_end_process(void);
 extern int32_t	oz8806_temp_read(int32_t *voltage);
 extern int32_t	afe_read_current(int32_t *dat);
 extern int32_t	afe_read_cell_volt(int32_t *voltage);
+extern int bmu_state_show(char *buf);
+extern int bmu_state_restore(const char *buf);
+extern uint8_t bmu_state_changed(void);
 
 extern void bmu_init_table(int **x, int **y, int **z, int **rc);
 
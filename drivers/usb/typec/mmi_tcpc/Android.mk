@@ -34,6 +34,10 @@ ifeq ($(USB_POWER_DELIVERY),true)
 	KERNEL_CFLAGS += CONFIG_USB_POWER_DELIVERY=y
 endif
 
+ifeq ($(TCPC_EVENT_FLOOD),true)
+	KERNEL_CFLAGS += CONFIG_TCPC_EVENT_FLOOD=y
+endif
+
 
 
 include $(CLEAR_VARS)
@@ -82,6 +82,8 @@ int tcpci_get_alert_mask(struct tcpc_device *tcpc, uint32_t *mask);
 int tcpci_get_alert_status(struct tcpc_device *tcpc, uint32_t *alert);
 int tcpci_get_fault_status(struct tcpc_device *tcpc, uint8_t *fault);
 int tcpci_get_power_status(struct tcpc_device *tcpc, uint16_t *pw_status);
+int tcpci_get_power_fault_status(struct tcpc_device *tcpc,
+	uint16_t *pw_status, uint8_t *fault);
 int tcpci_init(struct tcpc_device *tcpc, bool sw_reset);
 int tcpci_init_alert_mask(struct tcpc_device *tcpc);
 
@@ -360,6 +360,17 @@
 /* #define CONFIG_USB_PD_STOP_SEND_VDM_IF_RX_BUSY */
 #define CONFIG_USB_PD_STOP_REPLY_VDM_IF_RX_BUSY
 
+/*
+ * Depth of each per-producer PD event ring (power of 2)
+ * and size of the PD message pool (at most BITS_PER_LONG)
+ */
+#ifndef CONFIG_USB_PD_EVENT_RING_SIZE
+#define CONFIG_USB_PD_EVENT_RING_SIZE	32
+#endif	/* CONFIG_USB_PD_EVENT_RING_SIZE */
+#ifndef CONFIG_USB_PD_MSG_POOL_SIZE
+#define CONFIG_USB_PD_MSG_POOL_SIZE	16
+#endif	/* CONFIG_USB_PD_MSG_POOL_SIZE */
+
 /* #define CONFIG_USB_PD_SAFE0V_DELAY */
 /* #define CONFIG_USB_PD_SAFE0V_TIMEOUT */
 
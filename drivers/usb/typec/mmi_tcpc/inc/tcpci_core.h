@@ -16,6 +16,7 @@
 
 #include <linux/device.h>
 #include <linux/hrtimer.h>
+#include <linux/timerqueue.h>
 #include <linux/alarmtimer.h>
 #include <linux/workqueue.h>
 #include <linux/pm_wakeup.h>
@@ -217,6 +218,9 @@ struct tcpc_ops {
 	int (*get_alert_status)(struct tcpc_device *tcpc, uint32_t *alert);
 	int (*get_power_status)(struct tcpc_device *tcpc, uint16_t *pwr_status);
 	int (*get_fault_status)(struct tcpc_device *tcpc, uint8_t *status);
+	/* Optional, power and fault status in as few bus transfers as possible */
+	int (*get_power_fault_status)(struct tcpc_device *tcpc,
+			uint16_t *pwr_status, uint8_t *fault_status);
 	int (*get_cc)(struct tcpc_device *tcpc, int *cc1, int *cc2);
 	int (*set_cc)(struct tcpc_device *tcpc, int pull);
 	int (*set_polarity)(struct tcpc_device *tcpc, int polarity);
@@ -302,6 +306,25 @@ struct tcpc_ops {
 
 struct tcpc_managed_res;
 
+/* Expiry lateness of one timer, against its programmed deadline */
+struct tcpc_timer_stat {
+	uint32_t count;
+	uint32_t late_max_us;
+	uint64_t late_total_us;
+};
+
+/* Status fetched once per tcpci_alert() pass and used by its handlers */
+struct tcpc_alert_cache {
+	bool status_valid;
+	uint16_t power_status;
+	uint8_t fault_status;
+#ifdef CONFIG_USB_POWER_DELIVERY
+	bool rx_fetched;
+	int rx_ret;
+	struct pd_msg *rx_msg;
+#endif	/* CONFIG_USB_POWER_DELIVERY */
+};
+
 /*
  * tcpc device
  */
@@ -318,7 +341,13 @@ struct tcpc_device {
 
 	/* For tcpc timer & event */
 	uint32_t timer_handle_index;
-	struct hrtimer tcpc_timer[PD_TIMER_NR];
+	struct hrtimer timer_wheel;
+	struct timerqueue_head timer_queue;	/* protected by timer_tick_lock */
+	struct timerqueue_node timer_node[PD_TIMER_NR];
+	struct tcpc_timer_stat timer_stat[PD_TIMER_NR];
+	uint32_t timer_wheel_runs;
+	uint32_t timer_dispatches;
+	struct dentry *timer_dbgfs;
 
 	struct alarm wake_up_timer;
 	struct delayed_work wake_up_work;
@@ -413,6 +442,7 @@ struct tcpc_device {
 #endif	/* CONFIG_TCPC_SOURCE_VCONN */
 
 	uint32_t tcpc_flags;
+	struct tcpc_alert_cache alert_cache;	/* alert handler only */
 
 #ifdef CONFIG_DUAL_ROLE_USB_INTF
 	struct dual_role_phy_instance *dr_usb;
@@ -425,9 +455,14 @@ struct tcpc_device {
 
 #ifdef CONFIG_USB_POWER_DELIVERY
 	/* Event */
-	uint8_t pd_event_count;
-	uint8_t pd_event_head_index;
-	uint8_t pd_msg_buffer_allocated;
+	spinlock_t pd_event_put_lock;
+	atomic_t pd_event_seq;
+	atomic_t pd_event_gen;		/* bumped by each event buffer reset */
+	uint32_t pd_event_flushed;
+	unsigned long pd_msg_buffer_allocated;
+	uint32_t pd_msg_high_water;
+	uint32_t pd_msg_alloc_fail;
+	struct dentry *event_dbgfs;
 
 	uint8_t pd_last_vdm_msg_id;
 	bool pd_pending_vdm_event;
@@ -442,7 +477,7 @@ struct tcpc_device {
 	struct pd_event pd_vdm_event;
 
 	struct pd_msg pd_msg_buffer[PD_MSG_BUF_SIZE];
-	struct pd_event pd_event_ring_buffer[PD_EVENT_BUF_SIZE];
+	struct pd_event_ring pd_event_ring[PD_EVENT_RING_NR];
 
 	uint8_t tcp_event_count;
 	uint8_t tcp_event_head_index;
@@ -18,8 +18,8 @@
 #include "tcpm.h"
 
 
-#define PD_MSG_BUF_SIZE		(4*2)
-#define PD_EVENT_BUF_SIZE	(8*2)
+#define PD_MSG_BUF_SIZE		CONFIG_USB_PD_MSG_POOL_SIZE
+#define PD_EVENT_BUF_SIZE	CONFIG_USB_PD_EVENT_RING_SIZE
 #define TCP_EVENT_BUF_SIZE	(2*2)
 
 struct tcpc_device;
@@ -37,6 +37,34 @@ struct pd_event {
 	struct pd_msg *pd_msg;
 };
 
+/*
+ * Each producer class owns one single-producer/single-consumer ring:
+ * the timer thread, the event thread itself, and everybody else (alert
+ * handler, works, TCPM callers) serialized by pd_event_put_lock.
+ * The event thread is the only consumer and merges the rings by seq.
+ */
+enum pd_event_ring_id {
+	PD_EVENT_RING_ALERT = 0,
+	PD_EVENT_RING_TIMER,
+	PD_EVENT_RING_PE,
+	PD_EVENT_RING_NR,
+};
+
+struct pd_event_slot {
+	uint32_t seq;
+	uint32_t gen;		/* pd_event_gen when it was queued */
+	struct pd_event event;
+};
+
+struct pd_event_ring {
+	uint32_t head;		/* written by the consumer only */
+	uint32_t tail;		/* written by the producer only */
+	uint32_t put_count;
+	uint32_t high_water;
+	uint32_t overflow;
+	struct pd_event_slot slot[PD_EVENT_BUF_SIZE];
+};
+
 struct pd_msg *pd_alloc_msg(struct tcpc_device *tcpc);
 void pd_free_msg(struct tcpc_device *tcpc, struct pd_msg *pd_msg);
 
@@ -58,6 +86,14 @@ bool pd_put_deferred_tcp_event(
 
 extern int tcpci_event_init(struct tcpc_device *tcpc);
 extern int tcpci_event_deinit(struct tcpc_device *tcpc);
+
+#ifdef CONFIG_TCPC_EVENT_FLOOD
+extern void tcpci_event_flood_init(void);
+extern void tcpci_event_flood_exit(void);
+#else
+static inline void tcpci_event_flood_init(void) {}
+static inline void tcpci_event_flood_exit(void) {}
+#endif	/* CONFIG_TCPC_EVENT_FLOOD */
 extern void pd_event_buf_reset(struct tcpc_device *tcpc);
 
 bool __pd_put_cc_attached_event(struct tcpc_device *tcpc, uint8_t type);
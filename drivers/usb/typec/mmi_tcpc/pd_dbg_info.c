@@ -20,24 +20,68 @@
 #include <linux/sched/clock.h>
 #include <linux/mutex.h>
 #include <linux/kthread.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/log2.h>
+#include <linux/rcupdate.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
 #include "inc/pd_dbg_info.h"
 
 #ifdef CONFIG_PD_DBG_INFO
 
-#define PD_INFO_BUF_SIZE	(2048*256)
+/*
+ * Each CPU logs into its own ring with interrupts disabled, so the ring
+ * has a single producer and pd_dbg_info() can be called from IRQ and
+ * hrtimer context without locks or allocation. A record keeps the format
+ * pointer and the binary arguments (vbin_printf), the text is only built
+ * when a record is consumed, either by the print out thread or by a read
+ * of debugfs pd_dbg_info/log. Only formats of this module are kept that
+ * way, those of other modules (the tcpc drivers) would go away with them
+ * and are formatted right away. Lines whose arguments do not fit a record
+ * are kept as text over as many records as needed. When a ring is full
+ * new records are dropped and counted.
+ *
+ * The output is held off for a whole negotiation (pd_dbg_info_lock()), so
+ * a ring has to hold the lines of such a burst: by default 1024 records of
+ * 152 bytes, 152KiB per CPU. pd_dbg_ring_size raises it for longer traces.
+ */
+#define PD_DBG_RING_MIN		64
+#define PD_DBG_BIN_WORDS	32
 #define MSG_POLLING_MS		20
 
-#define OUT_BUF_MAX (128)
-static struct {
-	int used;
-	char buf[PD_INFO_BUF_SIZE + 1 + OUT_BUF_MAX];
-} pd_dbg_buffer[2];
+#define OUT_BUF_MAX (256)
+
+static unsigned int pd_dbg_ring_size = 1024;
+module_param(pd_dbg_ring_size, uint, 0444);
+MODULE_PARM_DESC(pd_dbg_ring_size,
+		 "pd_dbg_info records per CPU, rounded up to a power of 2");
+
+struct pd_dbg_rec {
+	u64 ts;
+	const char *fmt;	/* NULL when bin holds the formatted text */
+	unsigned int parts;	/* records of the line, in the first one */
+	u32 bin[PD_DBG_BIN_WORDS];
+};
+
+struct pd_dbg_ring {
+	unsigned int head;	/* written by the owner CPU only */
+	unsigned int tail;	/* written by the reader only */
+	unsigned int dropped;
+	unsigned int truncated;
+	struct pd_dbg_rec recs[];
+};
 
-static struct mutex buff_lock;
-static unsigned int using_buf;
+/* Indexed by CPU, cleared before the rings are freed */
+static struct pd_dbg_ring **pd_dbg_rings;
+static struct mutex read_lock;		/* serializes the readers */
+static char out_buf[OUT_BUF_MAX];	/* protected by read_lock */
 static wait_queue_head_t print_out_wait_que;
 static atomic_t pending_print_out;
 static atomic_t busy = ATOMIC_INIT(0);
+static bool print_out_en = true;
+static struct dentry *pd_dbg_dir;
 
 void pd_dbg_info_lock(void)
 {
@@ -46,42 +90,134 @@ void pd_dbg_info_lock(void)
 
 void pd_dbg_info_unlock(void)
 {
-	atomic_dec_if_positive(&busy);
+	if (atomic_dec_if_positive(&busy) == 0)
+		wake_up(&print_out_wait_que);
 }
 
-static inline bool pd_dbg_print_out(void)
+static inline struct pd_dbg_rec *pd_dbg_rec(struct pd_dbg_ring *ring,
+					     unsigned int idx)
 {
-	char temp;
-	int used;
-	unsigned int index, i;
+	return &ring->recs[idx & (pd_dbg_ring_size - 1)];
+}
 
-	mutex_lock(&buff_lock);
-	index = using_buf;
-	using_buf ^= 0x01; /* exchange buffer */
-	mutex_unlock(&buff_lock);
+/* The ring holding the oldest record, NULL when all are empty */
+static struct pd_dbg_ring *pd_dbg_oldest(void)
+{
+	struct pd_dbg_ring *ring, *oldest = NULL;
+	struct pd_dbg_rec *rec;
+	u64 ts = U64_MAX;
+	int cpu;
 
-	used = pd_dbg_buffer[index].used;
+	for_each_possible_cpu(cpu) {
+		ring = pd_dbg_rings[cpu];
+		if (ring->tail == smp_load_acquire(&ring->head))
+			continue;
+		rec = pd_dbg_rec(ring, ring->tail);
+		if (rec->ts < ts) {
+			ts = rec->ts;
+			oldest = ring;
+		}
+	}
+	return oldest;
+}
 
-	if (used == 0)
-		return false;
+/* Decode the oldest record into out_buf, with read_lock held */
+static int pd_dbg_decode(struct pd_dbg_ring *ring)
+{
+	struct pd_dbg_rec *rec = pd_dbg_rec(ring, ring->tail);
+	u64 ts = rec->ts;
+	unsigned long rem_usec;
+	unsigned int i;
+	int r;
 
-	pd_dbg_buffer[index].buf[used] = '\0';
+	rem_usec = do_div(ts, 1000000000) / 1000 / 1000;
+	r = scnprintf(out_buf, OUT_BUF_MAX, "<%5lu.%03lu>",
+		      (unsigned long)ts, rem_usec);
+#ifdef CONFIG_BINARY_PRINTF
+	if (rec->fmt) {
+		r += bstr_printf(out_buf + r, OUT_BUF_MAX - r, rec->fmt,
+				 rec->bin);
+		return min(r, OUT_BUF_MAX - 1);
+	}
+#endif	/* CONFIG_BINARY_PRINTF */
+	for (i = 0; i < rec->parts; i++)
+		r += scnprintf(out_buf + r, OUT_BUF_MAX - r, "%.*s",
+			       (int)sizeof(rec->bin),
+			       (const char *)pd_dbg_rec(ring,
+						ring->tail + i)->bin);
+	return r;
+}
 
-	pr_info("///PD dbg info %ud\n", used);
+static inline void pd_dbg_consume(struct pd_dbg_ring *ring)
+{
+	smp_store_release(&ring->tail,
+			  ring->tail + pd_dbg_rec(ring, ring->tail)->parts);
+}
 
-	for (i = 0; i < used; i += OUT_BUF_MAX) {
-		temp = pd_dbg_buffer[index].buf[OUT_BUF_MAX + i];
-		pd_dbg_buffer[index].buf[OUT_BUF_MAX + i] = '\0';
+/*
+ * The line as text over the records from head on, no records are used
+ * (parts is 0) when there is no room for all of them.
+ */
+static int pd_dbg_put_text(struct pd_dbg_ring *ring, unsigned int head,
+			   unsigned int room, const char *fmt, va_list args)
+{
+	struct pd_dbg_rec *rec = pd_dbg_rec(ring, head);
+	char text[OUT_BUF_MAX];
+	unsigned int parts, i;
+	int len;
+
+	len = vsnprintf(text, sizeof(text), fmt, args);
+	if (len >= sizeof(text)) {
+		ring->truncated++;
+		len = sizeof(text) - 1;
+	}
+
+	parts = DIV_ROUND_UP(len + 1, sizeof(rec->bin));
+	if (parts > room) {
+		rec->parts = 0;
+		return 0;
+	}
+
+	for (i = 0; i < parts; i++)
+		memcpy(pd_dbg_rec(ring, head + i)->bin,
+		       text + i * sizeof(rec->bin),
+		       min_t(size_t, sizeof(rec->bin),
+			     len + 1 - i * sizeof(rec->bin)));
+
+	rec->fmt = NULL;
+	rec->parts = parts;
+	return len;
+}
+
+/* Waits for busy without read_lock, debugfs readers go on meanwhile */
+static inline bool pd_dbg_print_out(void)
+{
+	struct pd_dbg_ring *ring;
+	int cnt = 0;
 
-		while (atomic_read(&busy))
-			usleep_range(1000, 2000);
+	while (print_out_en) {
+		wait_event_interruptible(print_out_wait_que,
+					 !atomic_read(&busy) ||
+					 kthread_should_stop());
+		if (kthread_should_stop())
+			break;
 
-		pr_notice("%s", pd_dbg_buffer[index].buf + i);
-		pd_dbg_buffer[index].buf[OUT_BUF_MAX + i] = temp;
+		mutex_lock(&read_lock);
+		ring = pd_dbg_oldest();
+		if (ring) {
+			pd_dbg_decode(ring);
+			pd_dbg_consume(ring);
+			pr_notice("%s", out_buf);
+		}
+		mutex_unlock(&read_lock);
+		if (!ring)
+			break;
+		cnt++;
 	}
 
-	/* pr_info("PD dbg info///\n"); */
-	pd_dbg_buffer[index].used = 0;
+	if (!cnt)
+		return false;
+
 	msleep(MSG_POLLING_MS);
 	return true;
 }
@@ -106,60 +242,218 @@ static int print_out_thread_fn(void *data)
 	return 0;
 }
 
+#ifdef CONFIG_BINARY_PRINTF
+/* Whether fmt stays valid until the record is consumed */
+static inline bool pd_dbg_fmt_kept(const char *fmt)
+{
+#ifdef MODULE
+	return within_module_core((unsigned long)fmt, THIS_MODULE);
+#else
+	return !is_module_address((unsigned long)fmt);
+#endif	/* MODULE */
+}
+#endif	/* CONFIG_BINARY_PRINTF */
+
+/*
+ * With interrupts disabled the rings cannot be freed under us,
+ * pd_dbg_info_exit() waits for it with synchronize_rcu().
+ */
 int pd_dbg_info(const char *fmt, ...)
 {
-	unsigned int index;
+	struct pd_dbg_ring **rings;
+	struct pd_dbg_ring *ring;
+	struct pd_dbg_rec *rec;
+	unsigned long flags;
+	unsigned int head, room;
 	va_list args;
-	int r;
-	int used;
-	u64 ts;
-	unsigned long rem_usec;
+	int r = 0;
 
-	ts = local_clock();
-	rem_usec = do_div(ts, 1000000000) / 1000 / 1000;
+	local_irq_save(flags);
+	rings = READ_ONCE(pd_dbg_rings);
+	if (!rings) {
+		local_irq_restore(flags);
+		return 0;
+	}
+
+	ring = rings[smp_processor_id()];
+	head = ring->head;
+	room = pd_dbg_ring_size - (head - smp_load_acquire(&ring->tail));
+	if (!room) {
+		ring->dropped++;
+		local_irq_restore(flags);
+		return 0;
+	}
+
+	rec = pd_dbg_rec(ring, head);
+	rec->ts = local_clock();
 	va_start(args, fmt);
-	mutex_lock(&buff_lock);
-	index = using_buf;
-	used = pd_dbg_buffer[index].used;
-	r = snprintf(pd_dbg_buffer[index].buf + used,
-		PD_INFO_BUF_SIZE - used, "<%5lu.%03lu>",
-		(unsigned long)ts, rem_usec);
-	if (r > 0)
-		used += r;
-	r = vsnprintf(pd_dbg_buffer[index].buf + used,
-			PD_INFO_BUF_SIZE - used, fmt, args);
-	if (r > 0)
-		used += r;
-
-	if (pd_dbg_buffer[index].used == 0) {
-		atomic_inc(&pending_print_out);
-		wake_up(&print_out_wait_que);
+#ifdef CONFIG_BINARY_PRINTF
+	if (!pd_dbg_fmt_kept(fmt)) {
+		r = pd_dbg_put_text(ring, head, room, fmt, args);
+		goto out;
 	}
 
-	pd_dbg_buffer[index].used = used;
-	mutex_unlock(&buff_lock);
+	rec->fmt = fmt;
+	rec->parts = 1;
+	r = vbin_printf(rec->bin, PD_DBG_BIN_WORDS, fmt, args);
+	if (r > PD_DBG_BIN_WORDS) {
+		/* bin is not usable, keep the line as text instead */
+		va_end(args);
+		va_start(args, fmt);
+		r = pd_dbg_put_text(ring, head, room, fmt, args);
+	}
+out:
+#else
+	r = pd_dbg_put_text(ring, head, room, fmt, args);
+#endif	/* CONFIG_BINARY_PRINTF */
 	va_end(args);
+	if (!rec->parts) {
+		ring->dropped++;
+		local_irq_restore(flags);
+		return 0;
+	}
+	smp_store_release(&ring->head, head + rec->parts);
+	local_irq_restore(flags);
+
+	if (print_out_en && !atomic_read(&pending_print_out)) {
+		atomic_inc(&pending_print_out);
+		wake_up(&print_out_wait_que);
+	}
 	return r;
 }
 EXPORT_SYMBOL(pd_dbg_info);
 
+/* Drains the rings, oldest first, like a pipe */
+static ssize_t pd_dbg_log_read(struct file *file, char __user *ubuf,
+			       size_t count, loff_t *ppos)
+{
+	struct pd_dbg_ring *ring;
+	size_t done = 0;
+	int len;
+
+	mutex_lock(&read_lock);
+	while ((ring = pd_dbg_oldest())) {
+		len = pd_dbg_decode(ring);
+		if (done + len > count)
+			break;
+		if (copy_to_user(ubuf + done, out_buf, len)) {
+			mutex_unlock(&read_lock);
+			return done ? done : -EFAULT;
+		}
+		pd_dbg_consume(ring);
+		done += len;
+	}
+	mutex_unlock(&read_lock);
+
+	return done;
+}
+
+static const struct file_operations pd_dbg_log_fops = {
+	.open = nonseekable_open,
+	.read = pd_dbg_log_read,
+	.llseek = no_llseek,
+};
+
+static int pd_dbg_stats_show(struct seq_file *s, void *unused)
+{
+	struct pd_dbg_ring *ring;
+	int cpu;
+
+	seq_printf(s, "%4s %10s %10s %10s\n",
+		   "cpu", "pending", "dropped", "truncated");
+	for_each_possible_cpu(cpu) {
+		ring = pd_dbg_rings[cpu];
+		seq_printf(s, "%4d %10u %10u %10u\n", cpu,
+			   READ_ONCE(ring->head) - READ_ONCE(ring->tail),
+			   READ_ONCE(ring->dropped),
+			   READ_ONCE(ring->truncated));
+	}
+	return 0;
+}
+
+static int pd_dbg_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, pd_dbg_stats_show, inode->i_private);
+}
+
+static const struct file_operations pd_dbg_stats_fops = {
+	.open = pd_dbg_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static struct task_struct *print_out_task;
 
+static void pd_dbg_rings_free(struct pd_dbg_ring **rings)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		vfree(rings[cpu]);
+	kfree(rings);
+}
+
+static struct pd_dbg_ring **pd_dbg_rings_alloc(void)
+{
+	struct pd_dbg_ring **rings;
+	int cpu;
+
+	rings = kcalloc(nr_cpu_ids, sizeof(*rings), GFP_KERNEL);
+	if (!rings)
+		return NULL;
+
+	for_each_possible_cpu(cpu) {
+		rings[cpu] = vzalloc_node(struct_size(rings[cpu], recs,
+						      pd_dbg_ring_size),
+					  cpu_to_node(cpu));
+		if (!rings[cpu]) {
+			pd_dbg_rings_free(rings);
+			return NULL;
+		}
+	}
+	return rings;
+}
+
 int pd_dbg_info_init(void)
 {
+	struct pd_dbg_ring **rings;
+
 	pr_info("%s\n", __func__);
-	mutex_init(&buff_lock);
+	pd_dbg_ring_size = roundup_pow_of_two(max_t(unsigned int,
+					pd_dbg_ring_size, PD_DBG_RING_MIN));
+	rings = pd_dbg_rings_alloc();
+	if (!rings)
+		return -ENOMEM;
+	mutex_init(&read_lock);
 	init_waitqueue_head(&print_out_wait_que);
 	atomic_set(&pending_print_out, 0);
 	print_out_task = kthread_run(print_out_thread_fn, NULL, "pd_dbg_info");
+	WRITE_ONCE(pd_dbg_rings, rings);
+
+	/* printk can be turned off to only read the log from debugfs */
+	pd_dbg_dir = debugfs_create_dir("pd_dbg_info", NULL);
+	debugfs_create_file("log", 0400, pd_dbg_dir, NULL, &pd_dbg_log_fops);
+	debugfs_create_file("stats", 0400, pd_dbg_dir, NULL,
+			    &pd_dbg_stats_fops);
+	debugfs_create_bool("printk", 0600, pd_dbg_dir, &print_out_en);
 
 	return 0;
 }
 
 void pd_dbg_info_exit(void)
 {
-	kthread_stop(print_out_task);
-	mutex_destroy(&buff_lock);
+	struct pd_dbg_ring **rings = pd_dbg_rings;
+
+	debugfs_remove_recursive(pd_dbg_dir);
+	if (!IS_ERR_OR_NULL(print_out_task))
+		kthread_stop(print_out_task);
+	mutex_destroy(&read_lock);
+
+	/* Wait for the loggers already past the check of pd_dbg_rings */
+	WRITE_ONCE(pd_dbg_rings, NULL);
+	synchronize_rcu();
+	pd_dbg_rings_free(rings);
 }
 
 MODULE_DESCRIPTION("PD Debug Info Module");
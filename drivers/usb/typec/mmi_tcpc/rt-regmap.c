@@ -25,6 +25,8 @@
 
 #define ERR_MSG_SIZE		128
 #define MAX_BYTE_SIZE		32
+/* Maps spanning up to this many addresses get a direct lookup table */
+#define RT_REGMAP_LUT_MAX	1024
 
 struct rt_regmap_ops {
 	int (*regmap_block_write)(struct rt_regmap_device *rd, u32 reg,
@@ -90,6 +92,11 @@ struct rt_regmap_device {
 	char *err_msg;
 	unsigned char error_occurred:1;
 	unsigned char regval[MAX_BYTE_SIZE];
+	/* address lookup, compiled at register time */
+	struct reg_index_offset *rio_lut;
+	u32 lut_base;
+	u32 lut_len;
+	int *sorted_idx;
 
 	int (*rt_block_write[4])(struct rt_regmap_device *rd,
 				 const struct rt_register *rm, int size,
@@ -105,7 +112,8 @@ struct rt_regmap_device {
 #endif /* CONFIG_DEBUG_FS */
 };
 
-static struct reg_index_offset find_register_index(
+/* reference scan, only used to compile the lookup table */
+static struct reg_index_offset __find_register_index(
 		const struct rt_regmap_device *rd, u32 reg)
 {
 	int i = 0, j = 0, unit = RT_1BYTE_MODE;
@@ -135,6 +143,87 @@ static struct reg_index_offset find_register_index(
 	return rio;
 }
 
+static int rt_regmap_unit(const struct rt_regmap_device *rd, u32 reg)
+{
+	int j = 0;
+
+	for (j = 0; rd->props.group[j].mode != RT_DUMMY_MODE; j++) {
+		if (reg >= rd->props.group[j].start &&
+		    reg <= rd->props.group[j].end)
+			return rd->props.group[j].mode;
+	}
+	return RT_1BYTE_MODE;
+}
+
+static struct reg_index_offset find_register_index(
+		const struct rt_regmap_device *rd, u32 reg)
+{
+	int lo = 0, hi = rd->props.register_num - 1, mid = 0, i = 0;
+	struct reg_index_offset rio = {-1, -1};
+	const rt_register_map_t *rm = rd->props.rm;
+
+	if (rd->rio_lut) {
+		if (reg >= rd->lut_base && reg - rd->lut_base < rd->lut_len)
+			rio = rd->rio_lut[reg - rd->lut_base];
+		return rio;
+	}
+
+	/* sparse map, binary search the registers sorted by address */
+	while (lo <= hi) {
+		mid = (lo + hi) / 2;
+		i = rd->sorted_idx[mid];
+		if (reg < rm[i]->addr)
+			hi = mid - 1;
+		else if (reg - rm[i]->addr >= rm[i]->size)
+			lo = mid + 1;
+		else {
+			rio.index = i;
+			rio.offset = reg == rm[i]->addr ? 0 :
+				(reg - rm[i]->addr) * rt_regmap_unit(rd, reg);
+			break;
+		}
+	}
+	return rio;
+}
+
+/* compile the register map into a direct table or a sorted index */
+static int rt_regmap_index_init(struct rt_regmap_device *rd)
+{
+	int i = 0, j = 0, idx = 0;
+	u32 reg = 0, lo = U32_MAX, hi = 0;
+	const rt_register_map_t *rm = rd->props.rm;
+
+	for (i = 0; i < rd->props.register_num; i++) {
+		lo = min(lo, rm[i]->addr);
+		hi = max(hi, rm[i]->addr + rm[i]->size);
+	}
+
+	if (hi - lo <= RT_REGMAP_LUT_MAX) {
+		rd->rio_lut = devm_kcalloc(&rd->dev, hi - lo,
+					   sizeof(*rd->rio_lut), GFP_KERNEL);
+		if (!rd->rio_lut)
+			return -ENOMEM;
+		for (reg = lo; reg < hi; reg++)
+			rd->rio_lut[reg - lo] = __find_register_index(rd, reg);
+		rd->lut_base = lo;
+		rd->lut_len = hi - lo;
+		return 0;
+	}
+
+	rd->sorted_idx = devm_kcalloc(&rd->dev, rd->props.register_num,
+				      sizeof(*rd->sorted_idx), GFP_KERNEL);
+	if (!rd->sorted_idx)
+		return -ENOMEM;
+	for (i = 0; i < rd->props.register_num; i++) {
+		idx = i;
+		for (j = i; j > 0 &&
+		     rm[rd->sorted_idx[j - 1]]->addr > rm[idx]->addr; j--)
+			rd->sorted_idx[j] = rd->sorted_idx[j - 1];
+		rd->sorted_idx[j] = idx;
+	}
+	return 0;
+}
+
 static int rt_chip_block_write(struct rt_regmap_device *rd, u32 reg,
 				int bytes, const void *src);
 
@@ -1537,6 +1626,12 @@ struct rt_regmap_device *rt_regmap_device_register_ex
 	if (!rd->err_msg)
 		goto err_msgalloc;
 
+	ret = rt_regmap_index_init(rd);
+	if (ret < 0) {
+		pr_notice("%s index init fail(%d)\n", __func__, ret);
+		goto err_msgalloc;
+	}
+
 	ret = rt_regmap_cache_init(rd);
 	if (ret < 0) {
 		pr_notice("%s init fail(%d)\n", __func__, ret);
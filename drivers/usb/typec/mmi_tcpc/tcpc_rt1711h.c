@@ -47,6 +47,10 @@
 
 #define RT1711H_IRQ_WAKE_TIME	(500) /* ms */
 
+/* RX_DATA holds up to 7 data objects, the first one comes with the header */
+#define RT1711_RX_DATA_MAX	(28)
+#define RT1711_RX_HEAD_DATA	(4)
+
 struct rt1711_chip {
 	struct i2c_client *client;
 	struct device *dev;
@@ -262,6 +266,22 @@ static int rt1711_block_read(struct i2c_client *i2c,
 	return ret;
 }
 
+/*
+ * For volatile registers only: going around the register cache is safe,
+ * and reads a range in one transfer where rt_regmap_block_read() splits it
+ * into one transfer per register.
+ */
+static int rt1711_volatile_read(struct rt1711_chip *chip,
+			u8 reg, int len, void *dst)
+{
+	int ret;
+
+	ret = rt1711_read_device(chip->client, reg, len, dst);
+	if (ret < 0)
+		dev_err(chip->dev, "rt1711 volatile read fail\n");
+	return ret;
+}
+
 static int rt1711_block_write(struct i2c_client *i2c,
 			u8 reg, int len, const void *src)
 {
@@ -854,18 +874,17 @@ int rt1711_get_alert_status(struct tcpc_device *tcpc, uint32_t *alert)
 	return 0;
 }
 
-static int rt1711_get_power_status(
-		struct tcpc_device *tcpc, uint16_t *pwr_status)
+/* Power status from the POWER_STATUS register value */
+static int rt1711_decode_power_status(struct tcpc_device *tcpc,
+	uint8_t power_status, uint16_t *pwr_status)
 {
+#ifdef CONFIG_TCPC_VSAFE0V_DETECT_IC
 	int ret;
-
-	ret = rt1711_i2c_read8(tcpc, TCPC_V10_REG_POWER_STATUS);
-	if (ret < 0)
-		return ret;
+#endif
 
 	*pwr_status = 0;
 
-	if (ret & TCPC_V10_REG_POWER_STATUS_VBUS_PRES)
+	if (power_status & TCPC_V10_REG_POWER_STATUS_VBUS_PRES)
 		*pwr_status |= TCPC_REG_POWER_STATUS_VBUS_PRES;
 
 #ifdef CONFIG_TCPC_VSAFE0V_DETECT_IC
@@ -879,6 +898,34 @@ static int rt1711_get_power_status(
 	return 0;
 }
 
+static int rt1711_get_power_status(
+		struct tcpc_device *tcpc, uint16_t *pwr_status)
+{
+	int ret;
+
+	ret = rt1711_i2c_read8(tcpc, TCPC_V10_REG_POWER_STATUS);
+	if (ret < 0)
+		return ret;
+
+	return rt1711_decode_power_status(tcpc, ret, pwr_status);
+}
+
+/* POWER_STATUS and FAULT_STATUS are adjacent, read them in one transfer */
+static int rt1711_get_power_fault_status(struct tcpc_device *tcpc,
+	uint16_t *pwr_status, uint8_t *fault_status)
+{
+	struct rt1711_chip *chip = tcpc_get_dev_data(tcpc);
+	uint8_t buf[2];
+	int ret;
+
+	ret = rt1711_volatile_read(chip, TCPC_V10_REG_POWER_STATUS, 2, buf);
+	if (ret < 0)
+		return ret;
+
+	*fault_status = buf[1];
+	return rt1711_decode_power_status(tcpc, buf[0], pwr_status);
+}
+
 int rt1711_get_fault_status(struct tcpc_device *tcpc, uint8_t *status)
 {
 	int ret;
@@ -1200,9 +1247,14 @@ static int rt1711_get_message(struct tcpc_device *tcpc, uint32_t *payload,
 	struct rt1711_chip *chip = tcpc_get_dev_data(tcpc);
 	int rv = 0;
 	uint8_t cnt = 0;
-	uint8_t buf[4];
+	uint8_t buf[4 + RT1711_RX_HEAD_DATA];
 
-	rv = rt1711_block_read(chip->client, TCPC_V10_REG_RX_BYTE_CNT, 4, buf);
+	/*
+	 * Byte count, frame type, header and the first data object in one
+	 * transfer, which covers control and single object messages.
+	 */
+	rv = rt1711_volatile_read(chip, TCPC_V10_REG_RX_BYTE_CNT,
+				  sizeof(buf), buf);
 	if (rv < 0)
 		return rv;
 
@@ -1211,13 +1263,18 @@ static int rt1711_get_message(struct tcpc_device *tcpc, uint32_t *payload,
 	*msg_head = le16_to_cpu(*(uint16_t *)&buf[2]);
 
 	/* TCPC 1.0 ==> no need to subtract the size of msg_head */
-	if (cnt > 3) {
-		cnt -= 3; /* MSG_HDR */
-		rv = rt1711_block_read(chip->client, TCPC_V10_REG_RX_DATA, cnt,
-				       payload);
-	}
+	if (cnt <= 3)
+		return 0;
 
-	return rv;
+	cnt = min_t(uint8_t, cnt - 3, RT1711_RX_DATA_MAX); /* MSG_HDR */
+	memcpy(payload, &buf[4], min_t(uint8_t, cnt, RT1711_RX_HEAD_DATA));
+	if (cnt > RT1711_RX_HEAD_DATA)
+		rv = rt1711_volatile_read(chip,
+			TCPC_V10_REG_RX_DATA + RT1711_RX_HEAD_DATA,
+			cnt - RT1711_RX_HEAD_DATA,
+			(uint8_t *)payload + RT1711_RX_HEAD_DATA);
+
+	return rv < 0 ? rv : 0;
 }
 
 static int rt1711_set_bist_carrier_mode(
@@ -1300,6 +1357,7 @@ static struct tcpc_ops rt1711_tcpc_ops = {
 	.get_alert_status = rt1711_get_alert_status,
 	.get_power_status = rt1711_get_power_status,
 	.get_fault_status = rt1711_get_fault_status,
+	.get_power_fault_status = rt1711_get_power_fault_status,
 	.get_cc = rt1711_get_cc,
 	.set_cc = rt1711_set_cc,
 	.set_polarity = rt1711_set_polarity,
@@ -195,6 +195,15 @@ int tcpci_get_power_status(
 	return 0;
 }
 
+int tcpci_get_power_fault_status(
+	struct tcpc_device *tcpc, uint16_t *pw_status, uint8_t *fault)
+{
+	if (tcpc->ops->get_power_fault_status)
+		return tcpc->ops->get_power_fault_status(tcpc, pw_status, fault);
+
+	return -ENOTSUPP;
+}
+
 int tcpci_init(struct tcpc_device *tcpc, bool sw_reset)
 {
 	int ret;
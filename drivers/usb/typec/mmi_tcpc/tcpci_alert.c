@@ -123,9 +123,14 @@ static int tcpci_alert_power_status_changed(struct tcpc_device *tcpc)
 	int rv = 0;
 	uint16_t power_status = 0;
 
-	rv = tcpci_get_power_status(tcpc, &power_status);
-	if (rv < 0)
-		return rv;
+	if (tcpc->alert_cache.status_valid) {
+		power_status = tcpc->alert_cache.power_status;
+		tcpci_vbus_level_init(tcpc, power_status);
+	} else {
+		rv = tcpci_get_power_status(tcpc, &power_status);
+		if (rv < 0)
+			return rv;
+	}
 
 	if (tcpc->tcpc_flags & TCPC_FLAGS_ALERT_V10)
 		return tcpci_vbus_level_changed(tcpc);
@@ -204,11 +209,47 @@ static int tcpci_alert_tx_discard(struct tcpc_device *tcpc)
 	return 0;
 }
 
+/* Called before the alert clear, so that RX is cleared with the rest */
+static void tcpci_alert_fetch_msg(struct tcpc_device *tcpc)
+{
+	struct tcpc_alert_cache *cache = &tcpc->alert_cache;
+	struct pd_msg *pd_msg = NULL;
+	enum tcpm_transmit_type type = TCPC_TX_SOP;
+
+	cache->rx_fetched = true;
+
+	pd_msg = pd_alloc_msg(tcpc);
+	if (pd_msg == NULL) {
+		cache->rx_ret = -EINVAL;
+		return;
+	}
+
+	cache->rx_ret = tcpci_get_message(tcpc,
+		pd_msg->payload, &pd_msg->msg_hdr, &type);
+	if (cache->rx_ret < 0) {
+		TCPC_INFO("recv_msg failed: %d\n", cache->rx_ret);
+		pd_free_msg(tcpc, pd_msg);
+		return;
+	}
+
+	pd_msg->frame_type = type;
+	cache->rx_msg = pd_msg;
+}
+
 static int tcpci_alert_recv_msg(struct tcpc_device *tcpc)
 {
 	int rv = 0;
 	struct pd_msg *pd_msg = NULL;
 	enum tcpm_transmit_type type = TCPC_TX_SOP;
+	struct tcpc_alert_cache *cache = &tcpc->alert_cache;
+
+	if (cache->rx_fetched) {
+		pd_msg = cache->rx_msg;
+		cache->rx_msg = NULL;
+		if (pd_msg)
+			pd_put_pd_msg_event(tcpc, pd_msg);
+		return cache->rx_ret;
+	}
 
 	pd_msg = pd_alloc_msg(tcpc);
 	if (pd_msg == NULL) {
@@ -254,7 +295,10 @@ static int tcpci_alert_fault(struct tcpc_device *tcpc)
 {
 	uint8_t fault_status = 0;
 
-	tcpci_get_fault_status(tcpc, &fault_status);
+	if (tcpc->alert_cache.status_valid)
+		fault_status = tcpc->alert_cache.fault_status;
+	else
+		tcpci_get_fault_status(tcpc, &fault_status);
 	TCPC_INFO("FaultAlert=0x%02x\n", fault_status);
 	tcpci_fault_status_clear(tcpc, fault_status);
 	return 0;
@@ -345,10 +389,13 @@ static inline bool tcpci_check_hard_reset_complete(
 int tcpci_alert(struct tcpc_device *tcpc)
 {
 	int rv = 0, i = 0;
-	uint32_t alert_status = 0, alert_mask = 0;
+	uint32_t alert_status = 0, alert_mask = 0, clear_mask = 0;
 	const uint8_t typec_role = tcpc->typec_role;
+	struct tcpc_alert_cache *cache = &tcpc->alert_cache;
 	uint32_t chip_id;
 
+	memset(cache, 0, sizeof(*cache));
+
 	rv = tcpci_get_alert_status(tcpc, &alert_status);
 	if (rv < 0)
 		return rv;
@@ -379,12 +426,26 @@ int tcpci_alert(struct tcpc_device *tcpc)
 		return rv;
 	}
 
-	tcpci_alert_status_clear(tcpc, alert_status & ~TCPC_REG_ALERT_RX_MASK);
+	clear_mask = alert_status & ~TCPC_REG_ALERT_RX_MASK;
+#ifdef CONFIG_USB_POWER_DELIVERY
+	if (alert_status & TCPC_REG_ALERT_RX_MASK) {
+		tcpci_alert_fetch_msg(tcpc);
+		clear_mask = alert_status;
+	}
+#endif	/* CONFIG_USB_POWER_DELIVERY */
+	tcpci_alert_status_clear(tcpc, clear_mask);
 
 	if ((tcpc->tcpc_flags & TCPC_FLAGS_ALERT_V10) &&
 	    (alert_status & TCPC_REG_ALERT_EXT_VBUS_80))
 		alert_status |= TCPC_REG_ALERT_POWER_STATUS;
 
+	/* Read after the clear, a later change raises a new alert */
+	if ((alert_status & (TCPC_REG_ALERT_POWER_STATUS |
+			     TCPC_REG_ALERT_FAULT)) &&
+	    tcpci_get_power_fault_status(tcpc, &cache->power_status,
+					 &cache->fault_status) == 0)
+		cache->status_valid = true;
+
 #ifdef CONFIG_USB_POWER_DELIVERY
 	if (tcpc->pd_transmit_state == PD_TX_STATE_WAIT_HARD_RESET) {
 		tcpci_check_hard_reset_complete(tcpc, alert_status);
@@ -401,6 +462,13 @@ int tcpci_alert(struct tcpc_device *tcpc)
 	}
 #endif /* CONFIG_USB_PD_DBG_SKIP_ALERT_HANDLER */
 
+#ifdef CONFIG_USB_POWER_DELIVERY
+	if (cache->rx_msg) {
+		pd_free_msg(tcpc, cache->rx_msg);
+		cache->rx_msg = NULL;
+	}
+#endif	/* CONFIG_USB_POWER_DELIVERY */
+
 	/* unmask alert */
 	rv = tcpci_set_alert_mask(tcpc, alert_mask);
 
@@ -385,6 +385,9 @@ struct tcpc_device *tcpc_device_register(struct device *parent,
 	mutex_init(&tcpc->mr_lock);
 	sema_init(&tcpc->timer_enable_mask_lock, 1);
 	spin_lock_init(&tcpc->timer_tick_lock);
+#ifdef CONFIG_USB_POWER_DELIVERY
+	spin_lock_init(&tcpc->pd_event_put_lock);
+#endif /* CONFIG_USB_POWER_DELIVERY */
 
 	tcpc->dev.class = tcpc_class;
 	tcpc->dev.type = &tcpc_dev_type;
@@ -860,6 +863,9 @@ static int __init tcpc_class_init(void)
 
 	pd_dbg_info_init();
 	regmap_plat_init();
+#ifdef CONFIG_USB_POWER_DELIVERY
+	tcpci_event_flood_init();
+#endif	/* CONFIG_USB_POWER_DELIVERY */
 
 	pr_info("TCPC class init OK\n");
 	return 0;
@@ -867,6 +873,9 @@ static int __init tcpc_class_init(void)
 
 static void __exit tcpc_class_exit(void)
 {
+#ifdef CONFIG_USB_POWER_DELIVERY
+	tcpci_event_flood_exit();
+#endif	/* CONFIG_USB_POWER_DELIVERY */
 	regmap_plat_exit();
 	pd_dbg_info_exit();
 
@@ -15,6 +15,10 @@
 
 #include <linux/kthread.h>
 #include <linux/atomic.h>
+#include <linux/bitops.h>
+#include <linux/debugfs.h>
+#include <linux/log2.h>
+#include <linux/seq_file.h>
 #include <linux/delay.h>
 #include <linux/sched.h>
 #include <linux/jiffies.h>
@@ -48,40 +52,39 @@ static void postpone_vdm_event(struct tcpc_device *tcpc)
 
 struct pd_msg *__pd_alloc_msg(struct tcpc_device *tcpc)
 {
+	unsigned long *allocated = &tcpc->pd_msg_buffer_allocated;
+	uint32_t used;
 	int i;
-	uint8_t mask;
 
-	for (i = 0, mask = 1; i < PD_MSG_BUF_SIZE; i++, mask <<= 1) {
-		if ((mask & tcpc->pd_msg_buffer_allocated) == 0) {
-			tcpc->pd_msg_buffer_allocated |= mask;
-			return tcpc->pd_msg_buffer + i;
+	do {
+		i = find_first_zero_bit(allocated, PD_MSG_BUF_SIZE);
+		if (i >= PD_MSG_BUF_SIZE) {
+			tcpc->pd_msg_alloc_fail++;
+			PD_ERR("pd_alloc_msg failed\n");
+			PD_BUG_ON(true);
+			return (struct pd_msg *)NULL;
 		}
-	}
+	} while (test_and_set_bit(i, allocated));
 
-	PD_ERR("pd_alloc_msg failed\n");
-	PD_BUG_ON(true);
+	used = hweight_long(READ_ONCE(*allocated));
+	if (used > READ_ONCE(tcpc->pd_msg_high_water))
+		WRITE_ONCE(tcpc->pd_msg_high_water, used);
 
-	return (struct pd_msg *)NULL;
+	return tcpc->pd_msg_buffer + i;
 }
 
 struct pd_msg *pd_alloc_msg(struct tcpc_device *tcpc)
 {
-	struct pd_msg *pd_msg = NULL;
-
-	mutex_lock(&tcpc->access_lock);
-	pd_msg = __pd_alloc_msg(tcpc);
-	mutex_unlock(&tcpc->access_lock);
-
-	return pd_msg;
+	return __pd_alloc_msg(tcpc);
 }
 
 static void __pd_free_msg(struct tcpc_device *tcpc, struct pd_msg *pd_msg)
 {
 	int index = pd_msg - tcpc->pd_msg_buffer;
-	uint8_t mask = 1 << index;
+	bool allocated;
 
-	PD_BUG_ON((mask & tcpc->pd_msg_buffer_allocated) == 0);
-	tcpc->pd_msg_buffer_allocated &= (~mask);
+	allocated = test_and_clear_bit(index, &tcpc->pd_msg_buffer_allocated);
+	PD_BUG_ON(!allocated);
 }
 
 static void __pd_free_event(
@@ -95,71 +98,146 @@ static void __pd_free_event(
 
 void pd_free_msg(struct tcpc_device *tcpc, struct pd_msg *pd_msg)
 {
-	mutex_lock(&tcpc->access_lock);
 	__pd_free_msg(tcpc, pd_msg);
-	mutex_unlock(&tcpc->access_lock);
 }
 
 void pd_free_event(struct tcpc_device *tcpc, struct pd_event *pd_event)
 {
-	mutex_lock(&tcpc->access_lock);
 	__pd_free_event(tcpc, pd_event);
-	mutex_unlock(&tcpc->access_lock);
 }
 
 /*----------------------------------------------------------------------------*/
 
+static const char * const pd_event_ring_name[PD_EVENT_RING_NR] = {
+	"alert", "timer", "pe",
+};
+
+static inline bool pd_event_seq_before_eq(uint32_t a, uint32_t b)
+{
+	return (int32_t)(a - b) <= 0;
+}
+
+/* Producer side, only one context may use a given ring at a time */
+static bool pd_event_ring_put(struct pd_event_ring *ring,
+	const struct pd_event *pd_event, uint32_t seq, uint32_t gen)
+{
+	struct pd_event_slot *slot;
+	uint32_t tail = ring->tail;
+	uint32_t used = tail - smp_load_acquire(&ring->head);
+
+	if (used >= PD_EVENT_BUF_SIZE) {
+		ring->overflow++;
+		return false;
+	}
+
+	slot = &ring->slot[tail & (PD_EVENT_BUF_SIZE - 1)];
+	slot->seq = seq;
+	slot->gen = gen;
+	slot->event = *pd_event;
+	smp_store_release(&ring->tail, tail + 1);
+
+	ring->put_count++;
+	if (++used > ring->high_water)
+		ring->high_water = used;
+	return true;
+}
+
+/* Consumer side, event thread only */
+static struct pd_event_slot *pd_event_ring_peek(struct pd_event_ring *ring)
+{
+	if (ring->head == smp_load_acquire(&ring->tail))
+		return NULL;
+
+	return &ring->slot[ring->head & (PD_EVENT_BUF_SIZE - 1)];
+}
+
 static bool __pd_get_event(
 	struct tcpc_device *tcpc, struct pd_event *pd_event)
 {
-	int index = 0;
+	struct pd_event_ring *ring = NULL;
+	struct pd_event_slot *slot, *oldest;
+	uint32_t gen;
+	int i;
 
-	if (tcpc->pd_event_count <= 0)
-		return false;
+	do {
+		oldest = NULL;
+		for (i = 0; i < PD_EVENT_RING_NR; i++) {
+			slot = pd_event_ring_peek(&tcpc->pd_event_ring[i]);
+			if (slot && (!oldest ||
+				!pd_event_seq_before_eq(oldest->seq, slot->seq))) {
+				oldest = slot;
+				ring = &tcpc->pd_event_ring[i];
+			}
+		}
 
-	tcpc->pd_event_count--;
+		if (!oldest)
+			return false;
 
-	*pd_event =
-		tcpc->pd_event_ring_buffer[tcpc->pd_event_head_index];
+		gen = oldest->gen;
+		*pd_event = oldest->event;
+		smp_store_release(&ring->head, ring->head + 1);
 
-	if (tcpc->pd_event_count) {
-		index = tcpc->pd_event_head_index + 1;
-		index %= PD_EVENT_BUF_SIZE;
-	}
-	tcpc->pd_event_head_index = index;
-	return true;
+		/*
+		 * Queued before the last buffer reset, drop it. A generation
+		 * rather than a seq bound, which would go stale once the seq
+		 * wraps past it without a reset.
+		 */
+		if (gen == atomic_read(&tcpc->pd_event_gen))
+			return true;
+
+		tcpc->pd_event_flushed++;
+		__pd_free_event(tcpc, pd_event);
+	} while (true);
 }
 
 bool pd_get_event(struct tcpc_device *tcpc, struct pd_event *pd_event)
 {
-	bool ret;
-
-	mutex_lock(&tcpc->access_lock);
-	ret = __pd_get_event(tcpc, pd_event);
-	mutex_unlock(&tcpc->access_lock);
-	return ret;
+	return __pd_get_event(tcpc, pd_event);
 }
 
 static bool __pd_put_event(struct tcpc_device *tcpc,
 	const struct pd_event *pd_event, bool from_port_partner)
 {
-	int index;
+	struct pd_event_ring *ring;
+	unsigned long flags;
+	uint32_t seq, gen;
+	bool ret;
+	int id;
 
 #ifdef CONFIG_USB_PD_POSTPONE_OTHER_VDM
 	if (from_port_partner)
 		postpone_vdm_event(tcpc);
 #endif	/* CONFIG_USB_PD_POSTPONE_OTHER_VDM */
 
-	if (tcpc->pd_event_count >= PD_EVENT_BUF_SIZE) {
-		PD_ERR("pd_put_event failed\n");
-		return false;
+	/*
+	 * current only tells the producer in task context, an interrupt or
+	 * hrtimer may run on top of the timer or event thread and goes to
+	 * the locked ring.
+	 */
+	if (in_task() && current == tcpc->timer_task)
+		id = PD_EVENT_RING_TIMER;
+	else if (in_task() && current == tcpc->event_task)
+		id = PD_EVENT_RING_PE;
+	else
+		id = PD_EVENT_RING_ALERT;
+	ring = &tcpc->pd_event_ring[id];
+
+	if (id == PD_EVENT_RING_ALERT) {
+		spin_lock_irqsave(&tcpc->pd_event_put_lock, flags);
+		seq = atomic_inc_return(&tcpc->pd_event_seq);
+		gen = atomic_read(&tcpc->pd_event_gen);
+		ret = pd_event_ring_put(ring, pd_event, seq, gen);
+		spin_unlock_irqrestore(&tcpc->pd_event_put_lock, flags);
+	} else {
+		seq = atomic_inc_return(&tcpc->pd_event_seq);
+		gen = atomic_read(&tcpc->pd_event_gen);
+		ret = pd_event_ring_put(ring, pd_event, seq, gen);
 	}
 
-	index = (tcpc->pd_event_head_index + tcpc->pd_event_count);
-	index %= PD_EVENT_BUF_SIZE;
-
-	tcpc->pd_event_count++;
-	tcpc->pd_event_ring_buffer[index] = *pd_event;
+	if (!ret) {
+		PD_ERR("pd_put_event failed (%s)\n", pd_event_ring_name[id]);
+		return false;
+	}
 
 	atomic_inc(&tcpc->pending_event);
 	wake_up(&tcpc->event_wait_que);
@@ -171,6 +249,10 @@ bool pd_put_event(struct tcpc_device *tcpc, const struct pd_event *pd_event,
 {
 	bool ret;
 
+	/* Only the VDM postpone needs the port state */
+	if (!from_port_partner)
+		return __pd_put_event(tcpc, pd_event, false);
+
 	mutex_lock(&tcpc->access_lock);
 	ret = __pd_put_event(tcpc, pd_event, from_port_partner);
 	mutex_unlock(&tcpc->access_lock);
@@ -648,11 +730,9 @@ void pd_notify_tcp_event_buf_reset(struct pd_port *pd_port, uint8_t reason)
 
 static void __pd_event_buf_reset(struct tcpc_device *tcpc, uint8_t reason)
 {
-	struct pd_event pd_event;
-
 	tcpc->pd_hard_reset_event_pending = false;
-	while (__pd_get_event(tcpc, &pd_event))
-		__pd_free_event(tcpc, &pd_event);
+	/* The event thread drops everything queued up to here */
+	atomic_inc(&tcpc->pd_event_gen);
 
 	if (tcpc->pd_pending_vdm_event) {
 		__pd_free_event(tcpc, &tcpc->pd_vdm_event);
@@ -1331,18 +1411,88 @@ static int tcpc_event_thread_fn(void *data)
 	return 0;
 }
 
+static int tcpc_event_stat_show(struct seq_file *s, void *unused)
+{
+	struct tcpc_device *tcpc = s->private;
+	struct pd_event_ring *ring;
+	int i;
+
+	seq_printf(s, "%-8s %8s %8s %10s %10s\n",
+		   "ring", "depth", "put", "high_water", "overflow");
+	for (i = 0; i < PD_EVENT_RING_NR; i++) {
+		ring = &tcpc->pd_event_ring[i];
+		seq_printf(s, "%-8s %8u %8u %10u %10u\n", pd_event_ring_name[i],
+			   PD_EVENT_BUF_SIZE, READ_ONCE(ring->put_count),
+			   READ_ONCE(ring->high_water),
+			   READ_ONCE(ring->overflow));
+	}
+	seq_printf(s, "flushed %u\n", READ_ONCE(tcpc->pd_event_flushed));
+	seq_printf(s, "msg pool %u, in use %u, high_water %u, alloc_fail %u\n",
+		   PD_MSG_BUF_SIZE,
+		   (unsigned int)hweight_long(
+				READ_ONCE(tcpc->pd_msg_buffer_allocated)),
+		   READ_ONCE(tcpc->pd_msg_high_water),
+		   READ_ONCE(tcpc->pd_msg_alloc_fail));
+
+	return 0;
+}
+
+static int tcpc_event_stat_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, tcpc_event_stat_show, inode->i_private);
+}
+
+/* Any write resets the statistics */
+static ssize_t tcpc_event_stat_write(struct file *file,
+	const char __user *ubuf, size_t count, loff_t *ppos)
+{
+	struct tcpc_device *tcpc =
+		((struct seq_file *)file->private_data)->private;
+	struct pd_event_ring *ring;
+	int i;
+
+	for (i = 0; i < PD_EVENT_RING_NR; i++) {
+		ring = &tcpc->pd_event_ring[i];
+		WRITE_ONCE(ring->put_count, 0);
+		WRITE_ONCE(ring->high_water, 0);
+		WRITE_ONCE(ring->overflow, 0);
+	}
+	WRITE_ONCE(tcpc->pd_event_flushed, 0);
+	WRITE_ONCE(tcpc->pd_msg_high_water, 0);
+	WRITE_ONCE(tcpc->pd_msg_alloc_fail, 0);
+
+	return count;
+}
+
+static const struct file_operations tcpc_event_stat_fops = {
+	.open = tcpc_event_stat_open,
+	.read = seq_read,
+	.write = tcpc_event_stat_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 int tcpci_event_init(struct tcpc_device *tcpc)
 {
+	char name[32];
+
+	BUILD_BUG_ON(!is_power_of_2(PD_EVENT_BUF_SIZE));
+	BUILD_BUG_ON(PD_MSG_BUF_SIZE > BITS_PER_LONG);
+
 	init_waitqueue_head(&tcpc->event_wait_que);
 	atomic_set(&tcpc->pending_event, 0);
 	tcpc->event_task = kthread_run(tcpc_event_thread_fn, tcpc,
 				       "tcpc_event_%s", tcpc->desc.name);
+	snprintf(name, sizeof(name), "tcpc_event_%s", tcpc->desc.name);
+	tcpc->event_dbgfs = debugfs_create_file(name, 0644, NULL, tcpc,
+						&tcpc_event_stat_fops);
 
 	return 0;
 }
 
 int tcpci_event_deinit(struct tcpc_device *tcpc)
 {
+	debugfs_remove(tcpc->event_dbgfs);
 	if (tcpc->event_task != NULL)
 		kthread_stop(tcpc->event_task);
 
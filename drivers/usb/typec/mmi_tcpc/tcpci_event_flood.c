@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) 2026 Motorola Mobility, LLC.
+ *
+ * PD event queue flooder
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Floods the PD event rings of a private tcpc device from all producer
+ * contexts at once: a thread and an hrtimer in the alert ring, a thread
+ * registered as the timer thread and the event thread itself, which also
+ * consumes like the policy engine does. Reading debugfs
+ * tcpc_event_flood/run does a run and checks that:
+ * - each producer's events come out in order, none lost or repeated,
+ * - the overflow count of each ring matches the puts that failed,
+ * - every message allocated with an event is freed.
+ * No real port sees these events.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/delay.h>
+#include <linux/hrtimer.h>
+#include <linux/kthread.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+
+#include "inc/tcpci.h"
+#include "inc/tcpci_event.h"
+
+#define FLOOD_EVT_TYPE		0xf0	/* not a PD_EVT_*, tags the producer */
+#define FLOOD_MSG_EVERY		4	/* alert thread events carrying a msg */
+#define FLOOD_PE_BURST		4
+#define FLOOD_IRQ_PERIOD_NS	(50 * NSEC_PER_USEC)
+
+enum flood_producer_id {
+	FLOOD_ALERT_THREAD,
+	FLOOD_ALERT_IRQ,
+	FLOOD_TIMER,
+	FLOOD_PE,
+	FLOOD_PRODUCER_NR,
+};
+
+static const char * const flood_producer_name[FLOOD_PRODUCER_NR] = {
+	"alert", "alert_irq", "timer", "pe",
+};
+
+static const int flood_producer_ring[FLOOD_PRODUCER_NR] = {
+	PD_EVENT_RING_ALERT, PD_EVENT_RING_ALERT,
+	PD_EVENT_RING_TIMER, PD_EVENT_RING_PE,
+};
+
+static const char * const flood_ring_name[PD_EVENT_RING_NR] = {
+	"alert", "timer", "pe",
+};
+
+struct flood_producer {
+	uint32_t sent;		/* also the tag of the next event */
+	uint32_t failed;
+	uint32_t recv;		/* low bits are the tag expected next */
+	uint32_t order_err;
+	uint32_t msg_err;
+};
+
+struct tcpc_event_flood {
+	struct tcpc_device *tcpc;
+	struct hrtimer irq_timer;
+	bool done;
+	uint32_t msgs;
+	struct flood_producer producer[FLOOD_PRODUCER_NR];
+};
+
+static DEFINE_MUTEX(flood_lock);
+static struct dentry *flood_dbgfs;
+static u32 flood_duration_ms = 1000;
+static u32 flood_stall_us = 200;
+
+static bool flood_put(struct tcpc_event_flood *flood, int id,
+	struct pd_msg *pd_msg)
+{
+	struct flood_producer *p = &flood->producer[id];
+	struct pd_event evt = {
+		.event_type = FLOOD_EVT_TYPE | id,
+		.msg = p->sent & 0xff,
+		.msg_sec = (p->sent >> 8) & 0xff,
+		.pd_msg = pd_msg,
+	};
+
+	if (pd_msg)
+		pd_msg->payload[0] = p->sent;
+
+	if (!pd_put_event(flood->tcpc, &evt, false)) {
+		p->failed++;
+		return false;
+	}
+
+	p->sent++;
+	return true;
+}
+
+static void flood_check(struct tcpc_event_flood *flood,
+	struct pd_event *evt)
+{
+	struct flood_producer *p;
+	uint16_t tag;
+	int id = evt->event_type & ~FLOOD_EVT_TYPE;
+
+	if ((evt->event_type & FLOOD_EVT_TYPE) != FLOOD_EVT_TYPE ||
+		id >= FLOOD_PRODUCER_NR) {
+		flood->producer[FLOOD_PE].order_err++;
+		goto out;
+	}
+
+	p = &flood->producer[id];
+	tag = evt->msg | (evt->msg_sec << 8);
+	if (tag != (uint16_t)p->recv)
+		p->order_err++;
+	if (evt->pd_msg && (uint16_t)evt->pd_msg->payload[0] != tag)
+		p->msg_err++;
+	p->recv++;
+out:
+	pd_free_event(flood->tcpc, evt);
+}
+
+static enum hrtimer_restart flood_irq_fn(struct hrtimer *timer)
+{
+	struct tcpc_event_flood *flood =
+		container_of(timer, struct tcpc_event_flood, irq_timer);
+
+	if (READ_ONCE(flood->done))
+		return HRTIMER_NORESTART;
+
+	flood_put(flood, FLOOD_ALERT_IRQ, NULL);
+	hrtimer_forward_now(timer, ns_to_ktime(FLOOD_IRQ_PERIOD_NS));
+	return HRTIMER_RESTART;
+}
+
+/* The only thread allocating, so the pool check cannot race */
+static int flood_alert_fn(void *data)
+{
+	struct tcpc_event_flood *flood = data;
+	struct tcpc_device *tcpc = flood->tcpc;
+	struct pd_msg *pd_msg;
+	uint32_t n = 0;
+
+	while (!kthread_should_stop()) {
+		pd_msg = NULL;
+		if (!(n++ % FLOOD_MSG_EVERY) &&
+			hweight_long(READ_ONCE(tcpc->pd_msg_buffer_allocated))
+				< PD_MSG_BUF_SIZE) {
+			pd_msg = pd_alloc_msg(tcpc);
+			if (pd_msg)
+				flood->msgs++;
+		}
+		if (!flood_put(flood, FLOOD_ALERT_THREAD, pd_msg) && pd_msg)
+			pd_free_msg(tcpc, pd_msg);
+		cond_resched();
+	}
+
+	return 0;
+}
+
+static int flood_timer_fn(void *data)
+{
+	struct tcpc_event_flood *flood = data;
+
+	while (!kthread_should_stop()) {
+		flood_put(flood, FLOOD_TIMER, NULL);
+		cond_resched();
+	}
+
+	return 0;
+}
+
+/* Producer of the PE ring and consumer of all of them, as the PE thread */
+static int flood_event_fn(void *data)
+{
+	struct tcpc_event_flood *flood = data;
+	struct pd_event evt;
+	int i;
+
+	while (!kthread_should_stop()) {
+		for (i = 0; i < FLOOD_PE_BURST; i++)
+			flood_put(flood, FLOOD_PE, NULL);
+
+		/* Let the rings fill up, to run into overflows */
+		if (flood_stall_us)
+			usleep_range(flood_stall_us, flood_stall_us + 50);
+
+		while (pd_get_event(flood->tcpc, &evt))
+			flood_check(flood, &evt);
+	}
+
+	/* The other producers are stopped by now */
+	while (pd_get_event(flood->tcpc, &evt))
+		flood_check(flood, &evt);
+
+	return 0;
+}
+
+static struct task_struct *flood_thread(struct tcpc_event_flood *flood,
+	int (*fn)(void *data), int id)
+{
+	return kthread_create(fn, flood, "tcpc_flood_%s",
+			      flood_producer_name[id]);
+}
+
+static int flood_run(struct seq_file *s, struct tcpc_event_flood *flood)
+{
+	struct tcpc_device *tcpc = flood->tcpc;
+	struct task_struct *alert, *timer, *event;
+	struct pd_event_ring *ring;
+	struct flood_producer *p;
+	uint32_t sent[PD_EVENT_RING_NR] = { 0 };
+	uint32_t failed[PD_EVENT_RING_NR] = { 0 };
+	bool pass = true;
+	int i;
+
+	spin_lock_init(&tcpc->pd_event_put_lock);
+	init_waitqueue_head(&tcpc->event_wait_que);
+	atomic_set(&tcpc->pending_event, 0);
+	atomic_set(&tcpc->pd_event_seq, 0);
+	atomic_set(&tcpc->pd_event_gen, 0);
+
+	alert = flood_thread(flood, flood_alert_fn, FLOOD_ALERT_THREAD);
+	timer = flood_thread(flood, flood_timer_fn, FLOOD_TIMER);
+	event = flood_thread(flood, flood_event_fn, FLOOD_PE);
+	if (IS_ERR(alert) || IS_ERR(timer) || IS_ERR(event)) {
+		if (!IS_ERR(alert))
+			kthread_stop(alert);
+		if (!IS_ERR(timer))
+			kthread_stop(timer);
+		if (!IS_ERR(event))
+			kthread_stop(event);
+		return -ENOMEM;
+	}
+
+	/* The rings are picked by current, as for the real threads */
+	tcpc->timer_task = timer;
+	tcpc->event_task = event;
+	hrtimer_init(&flood->irq_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	flood->irq_timer.function = flood_irq_fn;
+
+	wake_up_process(event);
+	wake_up_process(timer);
+	wake_up_process(alert);
+	hrtimer_start(&flood->irq_timer, ns_to_ktime(FLOOD_IRQ_PERIOD_NS),
+		      HRTIMER_MODE_REL);
+
+	msleep(flood_duration_ms);
+
+	WRITE_ONCE(flood->done, true);
+	hrtimer_cancel(&flood->irq_timer);
+	kthread_stop(alert);
+	kthread_stop(timer);
+	kthread_stop(event);
+
+	seq_printf(s, "%-10s %10s %10s %10s %10s %10s\n", "producer",
+		   "sent", "failed", "received", "order_err", "msg_err");
+	for (i = 0; i < FLOOD_PRODUCER_NR; i++) {
+		p = &flood->producer[i];
+		seq_printf(s, "%-10s %10u %10u %10u %10u %10u\n",
+			   flood_producer_name[i], p->sent, p->failed,
+			   p->recv, p->order_err, p->msg_err);
+		sent[flood_producer_ring[i]] += p->sent;
+		failed[flood_producer_ring[i]] += p->failed;
+		if (p->recv != p->sent ||
+			p->order_err || p->msg_err)
+			pass = false;
+	}
+
+	seq_printf(s, "%-10s %10s %10s %10s\n",
+		   "ring", "put", "overflow", "high_water");
+	for (i = 0; i < PD_EVENT_RING_NR; i++) {
+		ring = &tcpc->pd_event_ring[i];
+		seq_printf(s, "%-10s %10u %10u %10u\n", flood_ring_name[i],
+			   ring->put_count, ring->overflow, ring->high_water);
+		if (ring->put_count != sent[i] ||
+			ring->overflow != failed[i])
+			pass = false;
+	}
+
+	seq_printf(s, "msgs %u, in use %u, alloc_fail %u\n", flood->msgs,
+		   (unsigned int)hweight_long(tcpc->pd_msg_buffer_allocated),
+		   tcpc->pd_msg_alloc_fail);
+	if (tcpc->pd_msg_buffer_allocated || tcpc->pd_msg_alloc_fail)
+		pass = false;
+
+	seq_printf(s, "result: %s\n", pass ? "pass" : "FAIL");
+	return 0;
+}
+
+static int flood_show(struct seq_file *s, void *unused)
+{
+	struct tcpc_event_flood *flood;
+	int ret;
+
+	flood = kzalloc(sizeof(*flood), GFP_KERNEL);
+	if (!flood)
+		return -ENOMEM;
+
+	/* Large, and only the event queue part of it is used */
+	flood->tcpc = vzalloc(sizeof(*flood->tcpc));
+	if (!flood->tcpc) {
+		kfree(flood);
+		return -ENOMEM;
+	}
+
+	mutex_lock(&flood_lock);
+	ret = flood_run(s, flood);
+	mutex_unlock(&flood_lock);
+
+	vfree(flood->tcpc);
+	kfree(flood);
+	return ret;
+}
+
+static int flood_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, flood_show, inode->i_private);
+}
+
+static const struct file_operations flood_fops = {
+	.open = flood_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+void tcpci_event_flood_init(void)
+{
+	flood_dbgfs = debugfs_create_dir("tcpc_event_flood", NULL);
+	debugfs_create_u32("duration_ms", 0600, flood_dbgfs,
+			   &flood_duration_ms);
+	debugfs_create_u32("stall_us", 0600, flood_dbgfs, &flood_stall_us);
+	debugfs_create_file("run", 0400, flood_dbgfs, NULL, &flood_fops);
+}
+
+void tcpci_event_flood_exit(void)
+{
+	debugfs_remove_recursive(flood_dbgfs);
+}
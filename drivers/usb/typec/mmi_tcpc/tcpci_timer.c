@@ -19,6 +19,9 @@
 #include <linux/atomic.h>
 #include <linux/kthread.h>
 #include <linux/hrtimer.h>
+#include <linux/timerqueue.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <linux/version.h>
 
 #include <linux/sched/rt.h>
@@ -128,7 +131,6 @@ static inline void tcpc_set_timer_tick(struct tcpc_device *tcpc, int nr)
 	spin_unlock_irqrestore(&tcpc->timer_tick_lock, flags);
 }
 
-#if TCPC_TIMER_DBG_EN || TCPC_TIMER_INFO_EN
 static const char *const tcpc_timer_name[] = {
 #ifdef CONFIG_USB_POWER_DELIVERY
 	"PD_TIMER_DISCOVER_ID",
@@ -221,7 +223,6 @@ static const char *const tcpc_timer_name[] = {
 	"TYPEC_TIMER_NORP_SRC",
 #endif	/* CONFIG_TYPEC_CAP_NORP_SRC */
 };
-#endif /* TCPC_TIMER_DBG_EN || TCPC_TIMER_INFO_EN */
 /* CONFIG_USB_PD_SAFE0V_DELAY */
 #ifdef CONFIG_TCPC_VSAFE0V_DETECT
 #define PD_TIMER_VSAFE0V_DLY_TOUT		50
@@ -362,8 +363,6 @@ DECL_TCPC_TIMEOUT(TYPEC_TIMER_NORP_SRC, 300),
 #endif	/* CONFIG_TYPEC_CAP_NORP_SRC */
 };
 
-typedef enum hrtimer_restart (*tcpc_hrtimer_call)(struct hrtimer *timer);
-
 #ifdef CONFIG_USB_POWER_DELIVERY
 static inline void on_pe_timer_timeout(
 		struct tcpc_device *tcpc, uint32_t timer_id)
@@ -442,744 +441,182 @@ static inline void on_pe_timer_timeout(
 }
 #endif	/* CONFIG_USB_POWER_DELIVERY */
 
-#define TCPC_TIMER_TRIGGER()	do \
-{				\
-	tcpc_set_timer_tick(tcpc, index);	\
-	wake_up(&tcpc->timer_wait_que);	\
-} while (0)
-
-#ifdef CONFIG_USB_POWER_DELIVERY
-static enum hrtimer_restart tcpc_timer_bist_cont_mode(struct hrtimer *timer)
-{
-	int index = PD_TIMER_BIST_CONT_MODE;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_discover_id(struct hrtimer *timer)
-{
-	int index = PD_TIMER_DISCOVER_ID;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart
-	tcpc_timer_hard_reset_complete(struct hrtimer *timer)
-{
-	int index = PD_TIMER_HARD_RESET_COMPLETE;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_no_response(struct hrtimer *timer)
-{
-	int index = PD_TIMER_NO_RESPONSE;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_ps_hard_reset(struct hrtimer *timer)
-{
-	int index = PD_TIMER_PS_HARD_RESET;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_ps_source_off(struct hrtimer *timer)
-{
-	int index = PD_TIMER_PS_SOURCE_OFF;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_ps_source_on(struct hrtimer *timer)
-{
-	int index = PD_TIMER_PS_SOURCE_ON;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_ps_transition(struct hrtimer *timer)
-{
-	int index = PD_TIMER_PS_TRANSITION;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_sender_response(struct hrtimer *timer)
-{
-	int index = PD_TIMER_SENDER_RESPONSE;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_sink_request(struct hrtimer *timer)
-{
-	int index = PD_TIMER_SINK_REQUEST;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_sink_wait_cap(struct hrtimer *timer)
-{
-	int index = PD_TIMER_SINK_WAIT_CAP;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_source_capability(struct hrtimer *timer)
-{
-	int index = PD_TIMER_SOURCE_CAPABILITY;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_source_start(struct hrtimer *timer)
-{
-	int index = PD_TIMER_SOURCE_START;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_vconn_on(struct hrtimer *timer)
-{
-	int index = PD_TIMER_VCONN_ON;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-#ifdef CONFIG_USB_PD_VCONN_STABLE_DELAY
-static enum hrtimer_restart tcpc_timer_vconn_stable(struct hrtimer *timer)
-{
-	int index = PD_TIMER_VCONN_STABLE;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-#endif	/* CONFIG_USB_PD_VCONN_STABLE_DELAY */
-
-static enum hrtimer_restart tcpc_timer_vdm_mode_entry(struct hrtimer *timer)
-{
-	int index = PD_TIMER_VDM_MODE_ENTRY;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_vdm_mode_exit(struct hrtimer *timer)
-{
-	int index = PD_TIMER_VDM_MODE_EXIT;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_vdm_response(struct hrtimer *timer)
-{
-	int index = PD_TIMER_VDM_RESPONSE;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_source_transition(struct hrtimer *timer)
-{
-	int index = PD_TIMER_SOURCE_TRANSITION;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_src_recover(struct hrtimer *timer)
-{
-	int index = PD_TIMER_SRC_RECOVER;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-#ifdef CONFIG_USB_PD_REV30
-static enum hrtimer_restart tcpc_timer_ck_no_support(struct hrtimer *timer)
-{
-	int index = PD_TIMER_CK_NOT_SUPPORTED;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-#ifdef CONFIG_USB_PD_REV30_COLLISION_AVOID
-static enum hrtimer_restart tcpc_timer_sink_tx(struct hrtimer *timer)
-{
-	int index = PD_TIMER_SINK_TX;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-#endif	/* CONFIG_USB_PD_REV30_COLLISION_AVOID */
-
-#ifdef CONFIG_USB_PD_REV30_PPS_SOURCE
-static enum hrtimer_restart tcpc_timer_source_pps(struct hrtimer *timer)
-{
-	int index = PD_TIMER_SOURCE_PPS_TIMEOUT;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-#endif	/* CONFIG_USB_PD_REV30_PPS_SOURCE */
-
-#endif	/* CONFIG_USB_PD_REV30 */
-
-/* PD_TIMER (out of spec )*/
-static enum hrtimer_restart tcpc_timer_vsafe0v_delay(struct hrtimer *timer)
-{
-	int index = PD_TIMER_VSAFE0V_DELAY;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_vsafe0v_tout(struct hrtimer *timer)
-{
-	int index = PD_TIMER_VSAFE0V_TOUT;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_pd_discard(struct hrtimer *timer)
-{
-	int index = PD_TIMER_DISCARD;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_vbus_stable(struct hrtimer *timer)
-{
-	int index = PD_TIMER_VBUS_STABLE;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_vbus_present(struct hrtimer *timer)
-{
-	int index = PD_TIMER_VBUS_PRESENT;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_uvdm_response(struct hrtimer *timer)
-{
-	int index = PD_TIMER_UVDM_RESPONSE;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_dfp_flow_delay(struct hrtimer *timer)
-{
-	int index = PD_TIMER_DFP_FLOW_DELAY;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_ufp_flow_delay(struct hrtimer *timer)
-{
-	int index = PD_TIMER_UFP_FLOW_DELAY;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_vconn_ready(struct hrtimer *timer)
-{
-	int index = PD_TIMER_VCONN_READY;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_vdm_postpone(struct hrtimer *timer)
-{
-	int index = PD_PE_VDM_POSTPONE;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-#ifdef CONFIG_USB_PD_REV30
-#ifdef CONFIG_USB_PD_REV30_COLLISION_AVOID
-static enum hrtimer_restart tcpc_timer_deferred_evt(struct hrtimer *timer)
-{
-	int index = PD_TIMER_DEFERRED_EVT;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-#ifdef CONFIG_USB_PD_REV30_SNK_FLOW_DELAY_STARTUP
-static enum hrtimer_restart tcpc_timer_snk_flow_delay(struct hrtimer *timer)
-{
-	int index = PD_TIMER_SNK_FLOW_DELAY;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-#endif	/* CONFIG_USB_PD_REV30_SNK_FLOW_DELAY_STARTUP */
-#endif	/* CONFIG_USB_PD_REV30_COLLISION_AVOID */
-#endif	/* CONFIG_USB_PD_REV30 */
-
-static enum hrtimer_restart tcpc_timer_pe_idle_tout(struct hrtimer *timer)
-{
-	int index = PD_TIMER_PE_IDLE_TOUT;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-#endif /* CONFIG_USB_POWER_DELIVERY */
-
-/* TYPEC_RT_TIMER (out of spec ) */
-
-static enum hrtimer_restart tcpc_timer_rt_vsafe0v_delay(struct hrtimer *timer)
-{
-	int index = TYPEC_RT_TIMER_SAFE0V_DELAY;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_rt_vsafe0v_tout(struct hrtimer *timer)
-{
-	int index = TYPEC_RT_TIMER_SAFE0V_TOUT;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_rt_role_swap_start(struct hrtimer *timer)
-{
-	int index = TYPEC_RT_TIMER_ROLE_SWAP_START;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_rt_role_swap_stop(struct hrtimer *timer)
-{
-	int index = TYPEC_RT_TIMER_ROLE_SWAP_STOP;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_rt_legacy(struct hrtimer *timer)
-{
-	int index = TYPEC_RT_TIMER_STATE_CHANGE;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_rt_not_legacy(struct hrtimer *timer)
-{
-	int index = TYPEC_RT_TIMER_NOT_LEGACY;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_rt_legacy_stable(struct hrtimer *timer)
-{
-	int index = TYPEC_RT_TIMER_LEGACY_STABLE;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_rt_legacy_recycle(struct hrtimer *timer)
-{
-	int index = TYPEC_RT_TIMER_LEGACY_RECYCLE;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-static enum hrtimer_restart tcpc_timer_rt_discharge(struct hrtimer *timer)
+static void wake_up_work_func(struct work_struct *work)
 {
-	int index = TYPEC_RT_TIMER_DISCHARGE;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
+	struct tcpc_device *tcpc = container_of(
+			work, struct tcpc_device, wake_up_work.work);
 
-static enum hrtimer_restart tcpc_timer_rt_low_power_mode(struct hrtimer *timer)
-{
-	int index = TYPEC_RT_TIMER_LOW_POWER_MODE;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
+	mutex_lock(&tcpc->typec_lock);
 
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
+	TCPC_INFO("%s\n", __func__);
+#ifdef CONFIG_TYPEC_WAKEUP_ONCE_LOW_DUTY
+	tcpc->typec_wakeup_once = true;
+#endif	/* CONFIG_TYPEC_WAKEUP_ONCE_LOW_DUTY */
 
-#ifdef CONFIG_USB_POWER_DELIVERY
-static enum hrtimer_restart tcpc_timer_rt_pe_idle(struct hrtimer *timer)
-{
-	int index = TYPEC_RT_TIMER_PE_IDLE;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
+	tcpc_typec_enter_lpm_again(tcpc);
 
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
+	mutex_unlock(&tcpc->typec_lock);
+	__pm_relax(tcpc->wakeup_wake_lock);
 }
 
-#ifdef CONFIG_USB_PD_WAIT_BC12
-static enum hrtimer_restart tcpc_timer_rt_pd_wait_bc12(struct hrtimer *timer)
+static enum alarmtimer_restart
+	tcpc_timer_wakeup(struct alarm *alarm, ktime_t now)
 {
-	int index = TYPEC_RT_TIMER_PD_WAIT_BC12;
 	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
+		container_of(alarm, struct tcpc_device, wake_up_timer);
 
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
+	__pm_wakeup_event(tcpc->wakeup_wake_lock, 1000);
+	schedule_delayed_work(&tcpc->wake_up_work, 0);
+	return ALARMTIMER_NORESTART;
 }
-#endif /* CONFIG_USB_PD_WAIT_BC12 */
-#endif	/* CONFIG_USB_POWER_DELIVERY */
 
-/* TYPEC-TRY-TIMER */
-static enum hrtimer_restart tcpc_timer_try_drp_try(struct hrtimer *timer)
-{
-	int index = TYPEC_TRY_TIMER_DRP_TRY;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
+/*
+ * All timers share one hrtimer, programmed for the earliest deadline of
+ * timer_queue. A run hands every timer already due to the timer thread,
+ * none of them before its deadline: PD timeouts are minimums.
+ */
 
-static enum hrtimer_restart tcpc_timer_try_drp_trywait(struct hrtimer *timer)
+static inline void tcpc_timer_stat_expired(
+	struct tcpc_timer_stat *stat, ktime_t now, ktime_t expires)
 {
-	int index = TYPEC_TRY_TIMER_DRP_TRYWAIT;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
+	s64 late_us = ktime_us_delta(now, expires);
 
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-
-/* TYPEC-DEBOUNCE-TIMER */
-static enum hrtimer_restart tcpc_timer_ccdebounce(struct hrtimer *timer)
-{
-	int index = TYPEC_TIMER_CCDEBOUNCE;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
+	if (late_us < 0)
+		late_us = 0;
 
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
+	stat->count++;
+	stat->late_total_us += late_us;
+	if (late_us > stat->late_max_us)
+		stat->late_max_us = late_us;
 }
 
-static enum hrtimer_restart tcpc_timer_pddebounce(struct hrtimer *timer)
+static enum hrtimer_restart tcpc_timer_wheel_fn(struct hrtimer *timer)
 {
-	int index = TYPEC_TIMER_PDDEBOUNCE;
 	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
+		container_of(timer, struct tcpc_device, timer_wheel);
+	struct timerqueue_node *node;
+	ktime_t now = ktime_get();
+	enum hrtimer_restart ret = HRTIMER_NORESTART;
+	unsigned long flags;
+	uint64_t tick = 0;
+	int index;
 
-#ifdef CONFIG_COMPATIBLE_APPLE_TA
-static enum hrtimer_restart tcpc_timer_apple_cc_open(struct hrtimer *timer)
-{
-	int index = TYPEC_TIMER_APPLE_CC_OPEN;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
+	spin_lock_irqsave(&tcpc->timer_tick_lock, flags);
+	tcpc->timer_wheel_runs++;
+	while ((node = timerqueue_getnext(&tcpc->timer_queue)) &&
+	       !ktime_after(node->expires, now)) {
+		index = node - tcpc->timer_node;
+		timerqueue_del(&tcpc->timer_queue, node);
+		timerqueue_init(node);
+		tcpc_timer_stat_expired(&tcpc->timer_stat[index],
+					now, node->expires);
+		tick |= RT_MASK64(index);
+	}
 
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
-#endif /* CONFIG_COMPATIBLE_APPLE_TA */
+	/*
+	 * tcpc_timer_queue() may have started the timer again from another
+	 * CPU while this ran, for a deadline no later than node. It is queued
+	 * then, and its expiry must not be touched.
+	 */
+	if (node && !hrtimer_is_queued(timer)) {
+		hrtimer_set_expires(timer, node->expires);
+		ret = HRTIMER_RESTART;
+	}
+	tcpc->timer_tick |= tick;
+	spin_unlock_irqrestore(&tcpc->timer_tick_lock, flags);
 
-static enum hrtimer_restart tcpc_timer_tryccdebounce(struct hrtimer *timer)
-{
-	int index = TYPEC_TIMER_TRYCCDEBOUNCE;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
+	if (tick)
+		wake_up(&tcpc->timer_wait_que);
 
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
+	return ret;
 }
 
-static enum hrtimer_restart tcpc_timer_srcdisconnect(struct hrtimer *timer)
+static void tcpc_timer_queue(struct tcpc_device *tcpc, int nr, ktime_t expires)
 {
-	int index = TYPEC_TIMER_SRCDISCONNECT;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
+	struct timerqueue_node *node = &tcpc->timer_node[nr];
+	unsigned long flags;
 
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
+	spin_lock_irqsave(&tcpc->timer_tick_lock, flags);
+	if (!RB_EMPTY_NODE(&node->node)) {
+		timerqueue_del(&tcpc->timer_queue, node);
+		timerqueue_init(node);
+	}
+	node->expires = expires;
+	/* Reprogram only when this is the new earliest deadline */
+	if (timerqueue_add(&tcpc->timer_queue, node))
+		hrtimer_start(&tcpc->timer_wheel, expires, HRTIMER_MODE_ABS);
+	spin_unlock_irqrestore(&tcpc->timer_tick_lock, flags);
 }
 
-static enum hrtimer_restart tcpc_timer_error_recovery(struct hrtimer *timer)
+static void tcpc_timer_dequeue(struct tcpc_device *tcpc, int nr)
 {
-	int index = TYPEC_TIMER_ERROR_RECOVERY;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
+	struct timerqueue_node *node = &tcpc->timer_node[nr];
+	unsigned long flags;
 
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
+	spin_lock_irqsave(&tcpc->timer_tick_lock, flags);
+	if (!RB_EMPTY_NODE(&node->node)) {
+		timerqueue_del(&tcpc->timer_queue, node);
+		timerqueue_init(node);
+		/* A later deadline just costs one empty run, unless none is left */
+		if (!timerqueue_getnext(&tcpc->timer_queue))
+			hrtimer_try_to_cancel(&tcpc->timer_wheel);
+	}
+	spin_unlock_irqrestore(&tcpc->timer_tick_lock, flags);
 }
 
-static void wake_up_work_func(struct work_struct *work)
+static int tcpc_timer_stat_show(struct seq_file *s, void *unused)
 {
-	struct tcpc_device *tcpc = container_of(
-			work, struct tcpc_device, wake_up_work.work);
-
-	mutex_lock(&tcpc->typec_lock);
-
-	TCPC_INFO("%s\n", __func__);
-#ifdef CONFIG_TYPEC_WAKEUP_ONCE_LOW_DUTY
-	tcpc->typec_wakeup_once = true;
-#endif	/* CONFIG_TYPEC_WAKEUP_ONCE_LOW_DUTY */
+	struct tcpc_device *tcpc = s->private;
+	struct tcpc_timer_stat *stat;
+	unsigned long flags;
+	int i;
 
-	tcpc_typec_enter_lpm_again(tcpc);
+	spin_lock_irqsave(&tcpc->timer_tick_lock, flags);
+	seq_printf(s, "wheel runs %u, thread dispatches %u\n",
+		   tcpc->timer_wheel_runs, tcpc->timer_dispatches);
+	seq_printf(s, "%-36s %8s %10s %10s\n",
+		   "timer", "count", "late(us)", "max(us)");
+	for (i = 0; i < PD_TIMER_NR; i++) {
+		stat = &tcpc->timer_stat[i];
+		if (!stat->count)
+			continue;
+		seq_printf(s, "%-36s %8u %10llu %10u\n", tcpc_timer_name[i],
+			   stat->count, div_u64(stat->late_total_us, stat->count),
+			   stat->late_max_us);
+	}
+	spin_unlock_irqrestore(&tcpc->timer_tick_lock, flags);
 
-	mutex_unlock(&tcpc->typec_lock);
-	__pm_relax(tcpc->wakeup_wake_lock);
+	return 0;
 }
 
-static enum alarmtimer_restart
-	tcpc_timer_wakeup(struct alarm *alarm, ktime_t now)
+static int tcpc_timer_stat_open(struct inode *inode, struct file *file)
 {
-	struct tcpc_device *tcpc =
-		container_of(alarm, struct tcpc_device, wake_up_timer);
-
-	__pm_wakeup_event(tcpc->wakeup_wake_lock, 1000);
-	schedule_delayed_work(&tcpc->wake_up_work, 0);
-	return ALARMTIMER_NORESTART;
+	return single_open(file, tcpc_timer_stat_show, inode->i_private);
 }
 
-static enum hrtimer_restart tcpc_timer_drp_src_toggle(struct hrtimer *timer)
+/* Any write resets the statistics */
+static ssize_t tcpc_timer_stat_write(struct file *file,
+	const char __user *ubuf, size_t count, loff_t *ppos)
 {
-	int index = TYPEC_TIMER_DRP_SRC_TOGGLE;
 	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
-
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
-}
+		((struct seq_file *)file->private_data)->private;
+	unsigned long flags;
 
-#ifdef CONFIG_TYPEC_CAP_NORP_SRC
-static enum hrtimer_restart tcpc_timer_norp_src(struct hrtimer *timer)
-{
-	int index = TYPEC_TIMER_NORP_SRC;
-	struct tcpc_device *tcpc =
-		container_of(timer, struct tcpc_device, tcpc_timer[index]);
+	spin_lock_irqsave(&tcpc->timer_tick_lock, flags);
+	memset(tcpc->timer_stat, 0, sizeof(tcpc->timer_stat));
+	tcpc->timer_wheel_runs = 0;
+	tcpc->timer_dispatches = 0;
+	spin_unlock_irqrestore(&tcpc->timer_tick_lock, flags);
 
-	TCPC_TIMER_TRIGGER();
-	return HRTIMER_NORESTART;
+	return count;
 }
-#endif	/* CONFIG_TYPEC_CAP_NORP_SRC */
-
-static tcpc_hrtimer_call tcpc_timer_call[PD_TIMER_NR] = {
-#ifdef CONFIG_USB_POWER_DELIVERY
-	tcpc_timer_discover_id,
-	tcpc_timer_bist_cont_mode,
-	tcpc_timer_hard_reset_complete,
-	tcpc_timer_no_response,
-	tcpc_timer_ps_hard_reset,
-	tcpc_timer_ps_source_off,
-	tcpc_timer_ps_source_on,
-	tcpc_timer_ps_transition,
-	tcpc_timer_sender_response,
-	tcpc_timer_sink_request,
-	tcpc_timer_sink_wait_cap,
-	tcpc_timer_source_capability,
-	tcpc_timer_source_start,
-	tcpc_timer_vconn_on,
-#ifdef CONFIG_USB_PD_VCONN_STABLE_DELAY
-	tcpc_timer_vconn_stable,
-#endif	/* CONFIG_USB_PD_VCONN_STABLE_DELAY */
-	tcpc_timer_vdm_mode_entry,
-	tcpc_timer_vdm_mode_exit,
-	tcpc_timer_vdm_response,
-	tcpc_timer_source_transition,
-	tcpc_timer_src_recover,
-#ifdef CONFIG_USB_PD_REV30
-	tcpc_timer_ck_no_support,
-#ifdef CONFIG_USB_PD_REV30_COLLISION_AVOID
-	tcpc_timer_sink_tx,
-#endif	/* CONFIG_USB_PD_REV30_COLLISION_AVOID */
-#ifdef CONFIG_USB_PD_REV30_PPS_SOURCE
-	tcpc_timer_source_pps,
-#endif	/* CONFIG_USB_PD_REV30_PPS_SOURCE */
-#endif	/* CONFIG_USB_PD_REV30 */
 
-/* PD_TIMER (out of spec )*/
-	tcpc_timer_vsafe0v_delay,
-	tcpc_timer_vsafe0v_tout,
-	tcpc_timer_pd_discard,
-	tcpc_timer_vbus_stable,
-	tcpc_timer_vbus_present,
-	tcpc_timer_uvdm_response,
-	tcpc_timer_dfp_flow_delay,
-	tcpc_timer_ufp_flow_delay,
-	tcpc_timer_vconn_ready,
-	tcpc_timer_vdm_postpone,
-
-#ifdef CONFIG_USB_PD_REV30
-#ifdef CONFIG_USB_PD_REV30_COLLISION_AVOID
-	tcpc_timer_deferred_evt,
-#ifdef CONFIG_USB_PD_REV30_SNK_FLOW_DELAY_STARTUP
-	tcpc_timer_snk_flow_delay,
-#endif	/* CONFIG_USB_PD_REV30_SNK_FLOW_DELAY_STARTUP */
-#endif	/* CONFIG_USB_PD_REV30_COLLISION_AVOID */
-#endif	/* CONFIG_USB_PD_REV30 */
-
-	tcpc_timer_pe_idle_tout,
-#endif /* CONFIG_USB_POWER_DELIVERY */
-
-/* TYPEC_RT_TIMER (out of spec )*/
-	tcpc_timer_rt_vsafe0v_delay,
-	tcpc_timer_rt_vsafe0v_tout,
-	tcpc_timer_rt_role_swap_start,
-	tcpc_timer_rt_role_swap_stop,
-	tcpc_timer_rt_legacy,
-	tcpc_timer_rt_not_legacy,
-	tcpc_timer_rt_legacy_stable,
-	tcpc_timer_rt_legacy_recycle,
-	tcpc_timer_rt_discharge,
-	tcpc_timer_rt_low_power_mode,
-#ifdef CONFIG_USB_POWER_DELIVERY
-	tcpc_timer_rt_pe_idle,
-#ifdef CONFIG_USB_PD_WAIT_BC12
-	tcpc_timer_rt_pd_wait_bc12,
-#endif /* CONFIG_USB_PD_WAIT_BC12 */
-#endif	/* CONFIG_USB_POWER_DELIVERY */
-	tcpc_timer_error_recovery,
-/* TYPEC-TRY-TIMER */
-	tcpc_timer_try_drp_try,
-	tcpc_timer_try_drp_trywait,
-/* TYPEC-DEBOUNCE-TIMER */
-	tcpc_timer_ccdebounce,
-	tcpc_timer_pddebounce,
-#ifdef CONFIG_COMPATIBLE_APPLE_TA
-	tcpc_timer_apple_cc_open,
-#endif /* CONFIG_COMPATIBLE_APPLE_TA */
-	tcpc_timer_tryccdebounce,
-	tcpc_timer_srcdisconnect,
-	tcpc_timer_drp_src_toggle,
-#ifdef CONFIG_TYPEC_CAP_NORP_SRC
-	tcpc_timer_norp_src,
-#endif
+static const struct file_operations tcpc_timer_stat_fops = {
+	.open = tcpc_timer_stat_open,
+	.read = seq_read,
+	.write = tcpc_timer_stat_write,
+	.llseek = seq_lseek,
+	.release = single_release,
 };
 
 /*
@@ -1217,7 +654,7 @@ static inline void tcpc_reset_timer_range(
 
 	for (i = start; i < end; i++) {
 		if (mask & RT_MASK64(i)) {
-			hrtimer_try_to_cancel(&tcpc->tcpc_timer[i]);
+			tcpc_timer_dequeue(tcpc, i);
 			tcpc_clear_timer_enable_mask(tcpc, i);
 		}
 	}
@@ -1241,7 +678,7 @@ void tcpc_enable_wakeup_timer(struct tcpc_device *tcpc, bool en)
 
 void tcpc_enable_timer(struct tcpc_device *tcpc, uint32_t timer_id)
 {
-	uint32_t r, mod, tout;
+	uint32_t tout;
 
 	TCPC_TIMER_EN_DBG(tcpc, timer_id);
 	if (timer_id >= PD_TIMER_NR) {
@@ -1262,12 +699,8 @@ void tcpc_enable_timer(struct tcpc_device *tcpc, uint32_t timer_id)
 		tout += TIMEOUT_VAL(jiffies & 0x07);
 #endif	/* CONFIG_USB_PD_RANDOM_FLOW_DELAY */
 
-	r =  tout / 1000000;
-	mod = tout % 1000000;
-
 	mutex_unlock(&tcpc->timer_lock);
-	hrtimer_start(&tcpc->tcpc_timer[timer_id],
-				ktime_set(r, mod*1000), HRTIMER_MODE_REL);
+	tcpc_timer_queue(tcpc, timer_id, ktime_add_us(ktime_get(), tout));
 }
 
 void tcpc_disable_timer(struct tcpc_device *tcpc, uint32_t timer_id)
@@ -1281,7 +714,7 @@ void tcpc_disable_timer(struct tcpc_device *tcpc, uint32_t timer_id)
 		return;
 	}
 	if (mask & RT_MASK64(timer_id)) {
-		hrtimer_try_to_cancel(&tcpc->tcpc_timer[timer_id]);
+		tcpc_timer_dequeue(tcpc, timer_id);
 		tcpc_clear_timer_enable_mask(tcpc, timer_id);
 	}
 }
@@ -1358,6 +791,7 @@ static int tcpc_timer_thread_fn(void *data)
 			dev_notice(&tcpc->dev, "%s exits(%d)\n", __func__, ret);
 			break;
 		}
+		tcpc->timer_dispatches++;
 		tcpc_handle_timer_triggered(tcpc);
 	}
 
@@ -1366,6 +800,7 @@ static int tcpc_timer_thread_fn(void *data)
 
 int tcpci_timer_init(struct tcpc_device *tcpc)
 {
+	char name[32];
 	int i;
 
 	pr_info("PD Timer number = %d\n", PD_TIMER_NR);
@@ -1375,11 +810,14 @@ int tcpci_timer_init(struct tcpc_device *tcpc)
 	tcpc->timer_enable_mask = 0;
 	tcpc->timer_task = kthread_run(tcpc_timer_thread_fn, tcpc,
 				       "tcpc_timer_%s", tcpc->desc.name);
-	for (i = 0; i < PD_TIMER_NR; i++) {
-		hrtimer_init(&tcpc->tcpc_timer[i],
-					CLOCK_MONOTONIC, HRTIMER_MODE_REL);
-		tcpc->tcpc_timer[i].function = tcpc_timer_call[i];
-	}
+	timerqueue_init_head(&tcpc->timer_queue);
+	for (i = 0; i < PD_TIMER_NR; i++)
+		timerqueue_init(&tcpc->timer_node[i]);
+	hrtimer_init(&tcpc->timer_wheel, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	tcpc->timer_wheel.function = tcpc_timer_wheel_fn;
+	snprintf(name, sizeof(name), "tcpc_timer_%s", tcpc->desc.name);
+	tcpc->timer_dbgfs = debugfs_create_file(name, 0644, NULL, tcpc,
+						&tcpc_timer_stat_fops);
 	tcpc->wakeup_wake_lock =
 		wakeup_source_register(&tcpc->dev, "tcpc_wakeup_wake_lock");
 	INIT_DELAYED_WORK(&tcpc->wake_up_work, wake_up_work_func);
@@ -1395,6 +833,8 @@ int tcpci_timer_deinit(struct tcpc_device *tcpc)
 	mutex_lock(&tcpc->timer_lock);
 	tcpc_reset_timer_range(tcpc, 0, PD_TIMER_NR);
 	mutex_unlock(&tcpc->timer_lock);
+	hrtimer_cancel(&tcpc->timer_wheel);
+	debugfs_remove(tcpc->timer_dbgfs);
 	cancel_delayed_work_sync(&tcpc->wake_up_work);
 	wakeup_source_unregister(tcpc->wakeup_wake_lock);
 
@@ -447,6 +447,10 @@ struct sx937x_platform_data
 #ifdef CONFIG_CAPSENSE_USB_CAL
 	struct work_struct ps_notify_work;
 	struct notifier_block ps_notif;
+#ifdef CONFIG_CAPSENSE_PSY_RELAY
+	struct relay_psy_client ps_relay;
+#endif
+	bool is_ps_relay;
 	bool ps_is_present;
 #ifdef CONFIG_CAPSENSE_ATTACH_CAL
 	bool phone_is_present;
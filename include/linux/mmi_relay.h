@@ -1,6 +1,7 @@
 #ifndef __MMI_RELAY_H__
 #define __MMI_RELAY_H__
 
+#include <linux/list.h>
 #include <linux/notifier.h>
 
 typedef enum notifier_type {
@@ -25,4 +26,57 @@ extern int relay_notifier_fire(notifier_t type, notifier_d dev, unsigned long va
 extern int relay_register_action(notifier_t type, notifier_d dev, struct notifier_block * nb);
 extern int relay_unregister_action(notifier_t type, notifier_d dev, struct notifier_block * nb);
 
+/*
+ * Power supply snapshot: the relay listens to the power supply class once,
+ * reads the properties its clients are interested in once per change and
+ * calls only the clients for which one of those properties changed.
+ */
+typedef enum relay_psy_supply {
+    RELAY_PSY_USB,
+    RELAY_PSY_BATTERY,
+    RELAY_PSY_WIRELESS,
+    RELAY_PSY_NUM,
+}relay_psy_s;
+
+typedef enum relay_psy_prop {
+    RELAY_PSY_ONLINE,
+    RELAY_PSY_PRESENT,
+    RELAY_PSY_STATUS,
+    RELAY_PSY_CAPACITY,
+    RELAY_PSY_TEMP,
+    RELAY_PSY_VOLTAGE_NOW,
+    RELAY_PSY_CURRENT_NOW,
+    RELAY_PSY_PROP_NUM,
+}relay_psy_p;
+
+#define RELAY_PSY_BIT(prop) (1UL << (prop))
+/* Props the supplies report a change for, relay_psy_get() caches these */
+#define RELAY_PSY_EVENT_PROPS (RELAY_PSY_BIT(RELAY_PSY_ONLINE) | \
+                               RELAY_PSY_BIT(RELAY_PSY_PRESENT) | \
+                               RELAY_PSY_BIT(RELAY_PSY_STATUS) | \
+                               RELAY_PSY_BIT(RELAY_PSY_CAPACITY))
+
+struct relay_psy_event {
+    relay_psy_s supply;
+    unsigned long changed;  /* props which changed since the last event */
+    unsigned long valid;    /* props which were read successfully */
+    int val[RELAY_PSY_PROP_NUM];
+};
+
+struct relay_psy_client {
+    struct list_head list;
+    /* RELAY_PSY_BIT() of the props of interest, per supply */
+    unsigned long mask[RELAY_PSY_NUM];
+    /*
+     * Called from a work, and once from relay_psy_register() with the
+     * current values. Must not (un)register clients
+     */
+    void (*changed)(struct relay_psy_client *client,
+                    const struct relay_psy_event *ev);
+};
+
+extern int relay_psy_register(struct relay_psy_client *client);
+extern int relay_psy_unregister(struct relay_psy_client *client);
+extern int relay_psy_get(relay_psy_s supply, relay_psy_p prop, int *val);
+
 #endif
@@ -75,6 +75,10 @@ int bm_ulog_get_mask_log(enum bm_ulog_category_bitmap categories,
 		    enum bm_ulog_level_type level,
 		    char *buf, u32 size);
 
+/*
+ * The print APIs only queue the fetch, the log is then printed and streamed
+ * to the bm_ulog/stream debugfs file from a worker.
+ */
 int bm_ulog_print_log(u32 size);
 int bm_ulog_print_mask_log(enum bm_ulog_category_bitmap categories,
 		    enum bm_ulog_level_type level, u32 size);
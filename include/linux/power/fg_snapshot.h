@@ -0,0 +1,93 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Copyright (C) 2021 Motorola Mobility LLC
+ *
+ * Snapshot of a fuel gauge standard command window.
+ *
+ * Discrete gauges expose voltage, current, temperature, capacity and
+ * flags as consecutive little endian words. Instead of one bus transfer
+ * per word, the whole window is read in one block transfer and the
+ * property reads are served from that copy while it is younger than
+ * max_age_ms. Reads outside the window, or with max_age_ms set to 0,
+ * return -ERANGE so that the caller falls back to a direct read.
+ */
+
+#ifndef __FG_SNAPSHOT_H__
+#define __FG_SNAPSHOT_H__
+
+#include <linux/jiffies.h>
+#include <linux/mutex.h>
+#include <linux/types.h>
+#include <asm/unaligned.h>
+
+#define FG_SNAPSHOT_MAX_LEN	64
+
+struct fg_snapshot {
+	struct mutex	lock;		/* Protects all below */
+	/* Reads len bytes from reg in one transfer, returns < 0 on error */
+	int		(*read)(void *priv, u8 reg, u8 *buf, int len);
+	void		*priv;
+	u8		base;
+	u8		len;
+	u32		max_age_ms;
+	unsigned long	stamp;
+	bool		valid;
+	/* Statistics */
+	u32		reads;
+	u32		hits;
+	u8		data[FG_SNAPSHOT_MAX_LEN];
+};
+
+static inline void fg_snapshot_init(struct fg_snapshot *snap, u8 base, u8 len,
+				    u32 max_age_ms,
+				    int (*read)(void *, u8, u8 *, int),
+				    void *priv)
+{
+	mutex_init(&snap->lock);
+	snap->read = read;
+	snap->priv = priv;
+	snap->base = base;
+	snap->len = min_t(u8, len, FG_SNAPSHOT_MAX_LEN);
+	snap->max_age_ms = max_age_ms;
+	snap->valid = false;
+	snap->reads = 0;
+	snap->hits = 0;
+}
+
+/* Forces the next read to go to the device, e.g. on a gauge interrupt */
+static inline void fg_snapshot_invalidate(struct fg_snapshot *snap)
+{
+	mutex_lock(&snap->lock);
+	snap->valid = false;
+	mutex_unlock(&snap->lock);
+}
+
+static inline int fg_snapshot_read_word(struct fg_snapshot *snap, u8 reg,
+					u16 *val)
+{
+	int ret = 0;
+
+	if (!snap->max_age_ms || reg < snap->base ||
+	    reg + 2 > snap->base + snap->len)
+		return -ERANGE;
+
+	mutex_lock(&snap->lock);
+	if (!snap->valid || time_after(jiffies, snap->stamp +
+				       msecs_to_jiffies(snap->max_age_ms))) {
+		ret = snap->read(snap->priv, snap->base, snap->data,
+				 snap->len);
+		snap->valid = ret >= 0;
+		snap->stamp = jiffies;
+		snap->reads++;
+	} else {
+		snap->hits++;
+	}
+
+	if (snap->valid)
+		*val = get_unaligned_le16(&snap->data[reg - snap->base]);
+	mutex_unlock(&snap->lock);
+
+	return ret < 0 ? ret : 0;
+}
+
+#endif /* __FG_SNAPSHOT_H__ */
@@ -21,6 +21,7 @@
 #include <linux/kernel.h>
 #include <linux/input.h>
 #include <linux/mmi_kernel_common.h>
+#include <linux/mmi_relay.h>
 
 #if defined(CONFIG_PANEL_NOTIFICATIONS)
 
@@ -458,6 +459,8 @@ struct ts_mmi_dev {
 
 	struct work_struct	ps_notify_work;
 	struct notifier_block	ps_notif;
+	struct relay_psy_client	ps_relay;
+	bool			is_ps_relay;
 	bool			ps_is_present;
 
 	struct notifier_block	fps_notif;